@@ -1,5 +1,5 @@
 #!/bin/sh
-# Build the MPI only and the hybrid version.
+# Build the MPI only, the hybrid and the shared memory threads version.
 
 # Cleanup bin dir
 rm -rf bin/*
@@ -10,26 +10,84 @@ mkdir -p bin
 #  -DDEBUG to enable debug output
 #  -DWITH_OMP -fopenmp to enable OpenMP hybrid support
 #  -DWITH_X11 -lX11 result will be drawn using a X11 window
-#  -DWITH_PBM enable PBM creation after the mandlebrot set has been created
+#  -DWITH_PBM enable binary PBM creation, rows are streamed to the file as they are computed
+#  -DWITH_MPIIO together with WITH_PBM the workers write their rows into the PBM file with MPI-IO instead of rank 0
+#  -DWITH_COUNTS compute escape counts (uint8 up to 255 iterations, uint16 above) instead of 0/1 pixels, with WITH_PBM
+#     the master (or the OpenCL host) writes a histogram equalized out.pgm. Not for the Mariani-Silver and gather strategies.
+#  -DCOUNT_PALETTE together with WITH_COUNTS write a colour out.ppm through a palette instead of the grey out.pgm
+#  -DMS_BAND_ROWS set the rows per work item of the Mariani-Silver strategy. By default 32.
+#  -DDYNAMIC_PREFETCH set the work items queued at each worker by the dynamic strategies. By default 2, 1 waits for every reply.
+#  -DRMA_CHUNK_ROWS set the rows a worker claims at once in the RMA strategy. By default 4.
+#  -DROW_SEND_BUFFERS set the row messages a worker keeps in flight while computing. By default 2.
+#  -DGATHER_CHUNK_ROWS set the rows per worker collected by each MPI_Gatherv round of the gather strategy. By default 64.
+#  -DCOST_PREVIEW_SIZE and -DCOST_PREVIEW_ITERS set the preview of the cost model strategy. By default 128x128 points and 64 iterations.
+#  -DTHREAD_TILE set the edge length of the tiles of the threads version. By default 64.
+#  -DRESUME_CHUNK set the points a thread of the threads version continues at once from a state file. By default 4096.
+#  -DPBM_WINDOW set the number of out of order rows buffered by the PBM writer. By default 256.
 #  -DWITH_BENCHMARK if set no PBM files or X11 output will be generated. Use this for benchmarking.
-#  -DSET_OMP_MODE set the OpenMP schedule mode. 0 for static, 1 for dynamic and 2 guided
-#  -DOMP_CHUNK set the OpenMP chunk size. By default 1.
+#  -DOMP_TILE_ROWS and -DOMP_TILE_COLS set the tiles the OpenMP team shares out. By default 4x64.
+#     Every worker keeps one team for its whole assignment, the tiles are tasks (taskloop). OMP_SCHEDULE picks the
+#     tasks at runtime: static one task per thread, dynamic,N or guided,N tasks of N tiles (1 without N).
+#  -DWORKER_BAND_ROWS set the rows the static strategies compute at once. By default 16.
+#  -DWITH_CACHE keep rendered tiles in an on-disk cache of memory mapped files and reuse them when a view is rendered
+#     again, for the dynamic strategy and the OpenCL host. The cache lives in CACHE_DIR (mandle_cache), MANDLE_CACHE=dir
+#     overrides it. Tiles are keyed by their position to 1/CACHE_SUBPIXELS (256) of a pixel, the pixel spacing, the
+#     iterations and the precision, so a pan by whole tiles reuses what the views share.
+#  -DWITH_STREAM together with WITH_PBM the master maps out.pbm (or the count image in a temporary file) and copies
+#     tiles straight to their place, for images larger than the memory. STREAM_WORKING_SET sets the megabytes written
+#     before they are flushed and dropped from memory, by default 256. Not with WITH_MPIIO, WITH_X11 or the progressive strategy.
+#  -DCL_BAND_PIXELS set the points the OpenCL device renders at once, the image is rendered in bands of whole rows
+#     of that size. By default 16M.
+#     Every work item computes 4 or 8 pixels of a row in vector types, by the preferred vector width of the device.
+#     MANDLE_CL_VEC=1|2|4|8|16 forces the pixels per work item, 1 runs the old kernel of one pixel per work item.
+#  -DCL_PIPELINE set the bands in flight on each OpenCL device, each on its own queue. The device computes the next band
+#     while one is read back. By default 2, 1 waits for every band.
+#  -DCL_ZERO_COPY=1 allocate the OpenCL pixel buffers in host visible memory and map them instead of reading them back,
+#     for CPU and integrated devices.
+#  The OpenCL host renders on every device of the context, MANDLE_CL_DEVICES=n keeps the first n. Bands go to the
+#     devices as they have free slots, the last bands only to the device expected to finish them first.
+#  -DCL_NUMA_DEVICES=1 split every OpenCL CPU device into one device per NUMA domain (clCreateSubDevices).
+#  The OpenCL host keeps the built kernel program in the cache directory (CACHE_DIR or MANDLE_CACHE=dir) as <hash>.clbin,
+#     keyed by the kernel source, the build options and the devices, and loads it instead of compiling it again.
+#     -DCL_BINARY_CACHE=0 always builds the kernel from source.
+#  -DPROGRESSIVE_LEVELS and -DPROGRESSIVE_FACTOR set the levels of the progressive strategy and the resolution step
+#     between them on each axis, a power of two. By default 3 levels of every 16th, every 4th and every point.
+#  -DWITH_PERIODICITY detect periodic orbits and stop iterating them early (CPU and OpenCL kernels)
+#  -DPRECISION_ULPS set how many ulps of a type the pixel spacing must span for the type to be picked. By default 1024.
+#     The CPU kernels run in float, double, double-double or perturbation, whichever is the cheapest fine enough for
+#     the view, MANDLE_PRECISION=float|double|dd|perturb forces one.
+#  -DPERTURB_LIMBS set the 32 bit limbs of the fixed point reference orbit of the deep zoom mode. By default 8 (about 1e-67).
+#  -DPERTURB_DOUBLE=1 let the OpenCL perturbation kernel iterate the deltas in double instead of float (needs fp64)
+#  -DWITH_SIMD=0 disable the SSE2/AVX2/AVX-512 row kernels (selected at runtime, MANDLE_SIMD=scalar|sse2|avx2|avx512 forces one)
+#
+# Run as: mpirun -np N bin/mandle.o iterations [strategy sizeX sizeY [tileX tileY [centerReal centerImag radius]]]
+#  With a tile size the static, round-robin, dynamic and RMA strategies hand out tileX x tileY tiles in
+#  Morton order instead of rows, tileX is rounded up to a multiple of 8. Pass 0 0 to keep rows.
+#  Strategies: 0 static, 1 round-robin, 2 dynamic, 3 Mariani-Silver, 4 RMA, 5 gather, 6 cost model, 7 progressive.
+#  The progressive strategy renders coarse to fine, every coarse level is written to out_levelN.pbm once complete and
+#  the finer levels only compute the points the coarser ones do not have. Not with WITH_COUNTS, WITH_MPIIO or WITH_STREAM.
+#  With a center and a radius (imaginary half height) past double-double the image is rendered by perturbation
+#  around a reference orbit that rank 0 computes in fixed point from the decimal center, e.g. -0.743643887037151 0.13182590420533 1e-20
+#
+# Run as: bin/mandle_threads.o iterations [threads sizeX sizeY [stateFile]]
+#  With a state file the points that did not escape are saved with their z, a later run of the same view with more
+#  iterations only continues those. Iterates in double, the result matches MANDLE_PRECISION=double.
 
 echo "Create MPI only binary"
-mpicxx -g mandle.cpp mandle_utils.cpp -o bin/mandle.o -DWITH_PBM -DWITH_BENCHMARK
+mpicxx -g -O2 mandle.cpp mandle_utils.cpp mandle_simd.cpp mandle_msg.cpp mandle_pbm.cpp mandle_ms.cpp mandle_tiles.cpp mandle_counts.cpp mandle_perturb.cpp mandle_precision.cpp mandle_progressive.cpp mandle_cache.cpp mandle_stream.cpp -o bin/mandle.o -DWITH_PBM -DWITH_BENCHMARK
 
-echo "Create MPI-OpenMP hybrid binary (static)"
-mpicxx -g mandle.cpp mandle_utils.cpp -o bin/mandle_hybrid_static.o -DWITH_OMP -fopenmp -DWITH_PBM=1 -DWITH_BENCHMARK -DSET_OMP_MODE=0
+echo "Create MPI-OpenMP hybrid binary"
+mpicxx -g -O2 mandle.cpp mandle_utils.cpp mandle_simd.cpp mandle_msg.cpp mandle_pbm.cpp mandle_ms.cpp mandle_tiles.cpp mandle_counts.cpp mandle_perturb.cpp mandle_precision.cpp mandle_progressive.cpp mandle_cache.cpp mandle_stream.cpp -o bin/mandle_hybrid.o -DWITH_OMP -fopenmp -DWITH_PBM=1 -DWITH_BENCHMARK
 
-echo "Create MPI-OpenMP hybrid binary (dynamic)"
-mpicxx -g mandle.cpp mandle_utils.cpp -o bin/mandle_hybrid_dynamic.o -DWITH_OMP -fopenmp -DWITH_PBM=1 -DWITH_BENCHMARK -DSET_OMP_MODE=1
+echo "Create MPI escape count binary, writes a shaded out.pgm"
+mpicxx -g -O2 mandle.cpp mandle_utils.cpp mandle_simd.cpp mandle_msg.cpp mandle_pbm.cpp mandle_ms.cpp mandle_tiles.cpp mandle_counts.cpp mandle_perturb.cpp mandle_precision.cpp mandle_progressive.cpp mandle_cache.cpp mandle_stream.cpp -o bin/mandle_counts.o -DWITH_PBM -DWITH_COUNTS
 
-echo "Create MPI-OpenMP hybrid binary (guided)"
-mpicxx -g mandle.cpp mandle_utils.cpp -o bin/mandle_hybrid_guided.o -DWITH_OMP -fopenmp -DWITH_PBM=1 -DWITH_BENCHMARK -DSET_OMP_MODE=2
+echo "Create shared memory threads binary"
+g++ -g -O2 -pthread mandle_threads.cpp mandle_utils.cpp mandle_simd.cpp mandle_msg.cpp mandle_pbm.cpp mandle_precision.cpp mandle_resume.cpp mandle_stream.cpp -o bin/mandle_threads.o -DWITH_MPI=0 -DWITH_PBM -DWITH_BENCHMARK
 
 # Build OpenCL mandle sample. Change the location of your local AMD SDK installation
 echo "Create OpenCL"
 AMD_SDK=/opt/AMDAPP
 export LD_LIBRARY_PATH=$AMD_SDK/lib/x86_64/
 gcc -O3 -msse2 -mfpmath=sse -ftree-vectorize -funroll-loops -Wall -I $AMD_SDK/include -L $AMD_SDK/lib/x86_64 -DWITH_MPI=0 -DWITH_PBM=1 \
-	mandle_cl.cpp mandle_utils.cpp mandle_cl_utils.cpp -o bin/mandle_cl.o -lOpenCL
\ No newline at end of file
+	mandle_cl.cpp mandle_utils.cpp mandle_simd.cpp mandle_msg.cpp mandle_pbm.cpp mandle_counts.cpp mandle_perturb.cpp mandle_precision.cpp mandle_cache.cpp mandle_stream.cpp mandle_cl_utils.cpp -o bin/mandle_cl.o -lOpenCL
\ No newline at end of file
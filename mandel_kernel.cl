@@ -28,43 +28,304 @@
  * 
  */
  
+// Brent style cycle detection, enabled by the host with -DWITH_PERIODICITY=1
+#ifndef WITH_PERIODICITY
+#define WITH_PERIODICITY 0
+#endif
+
+#ifndef PERIODICITY_EPS
+#define PERIODICITY_EPS 1e-6f
+#endif
+
+// Escape counts instead of 0/1 values, enabled by the host with -DWITH_COUNTS=1 -DCOUNT_TYPE=uchar or ushort
+#ifndef WITH_COUNTS
+#define WITH_COUNTS 0
+#endif
+
+#if WITH_COUNTS
+#ifndef COUNT_TYPE
+#define COUNT_TYPE ushort
+#endif
+#define COUNT_MAX 0xFFFF
+#endif
+
+// Double coordinates, the host builds with -DMANDEL_DOUBLE=1 once floats no longer resolve the pixels (needs cl_khr_fp64)
+#ifndef MANDEL_DOUBLE
+#define MANDEL_DOUBLE 0
+#endif
+
+#if MANDEL_DOUBLE
+#pragma OPENCL EXTENSION cl_khr_fp64 : enable
+#define MANDEL_SCALAR double
+#define MANDEL_MASK long
+#else
+#define MANDEL_SCALAR float
+#define MANDEL_MASK int
+#endif
+typedef MANDEL_SCALAR MANDEL_REAL;
+
 __kernel void mandel_kernel (
+#if WITH_COUNTS
+  __global COUNT_TYPE * mandleset,
+#else
   __global char * mandleset,
+#endif
   const int width,
   const int height,
-  const float scale,
-  const float offsetX,
-  const float offsetY,
-  const int iterations
+  const MANDEL_REAL scale,
+  const MANDEL_REAL offsetX,
+  const MANDEL_REAL offsetY,
+  const int iterations,
+  const int firstRow,
+  const int numRows
   )
 {
+    // The host renders bands of 'numRows' rows starting at 'firstRow', 'mandleset' holds one band
     int tid = get_global_id(0);
+    if ( tid >= width * numRows )
+        return;
    
     int i = tid%width;
-    int j = tid/height;
+    int j = firstRow + tid/width;
    
-    float x0 = ((i*scale) - ((scale/2)*width))/width + offsetX;
-    float y0 = ((j*scale) - ((scale/2)*height))/height + offsetY;
+    // Row 0 is the top of the image like in the CPU renderers and mandel_perturb_kernel
+    MANDEL_REAL x0 = ((i*scale) - ((scale/2)*width))/width + offsetX;
+    MANDEL_REAL y0 = (((height-1-j)*scale) - ((scale/2)*height))/height + offsetY;
    
-    float x = x0;
-    float y = y0;
+    MANDEL_REAL x = x0;
+    MANDEL_REAL y = y0;
    
-    float x2 = x*x;
-    float y2 = y*y;
+    MANDEL_REAL x2 = x*x;
+    MANDEL_REAL y2 = y*y;
    
-    float scaleSquare = scale * scale;
+    MANDEL_REAL scaleSquare = scale * scale;
    
     uint iter=0;
-    for(iter=0; (x2+y2 <= scaleSquare) && (iter < iterations); ++iter)
+
+    // Points in the main cardioid or the period-2 bulb never escape
+    MANDEL_REAL xq = x0 - 0.25f;
+    MANDEL_REAL q = xq*xq + y0*y0;
+    if ( (q * (q + xq) <= 0.25f * y0*y0) || ((x0+1)*(x0+1) + y0*y0 <= 0.0625f) )
+        iter = iterations;
+
+#if WITH_PERIODICITY
+    MANDEL_REAL check_x = x;
+    MANDEL_REAL check_y = y;
+    uint check_at = 1;
+#endif
+
+    for(; (x2+y2 <= scaleSquare) && (iter < iterations); ++iter)
     {
         y = 2 * x * y + y0;
         x = x2 - y2   + x0;
        
         x2 = x*x;
         y2 = y*y;
+
+#if WITH_PERIODICITY
+        // Back at the saved orbit point, the orbit is periodic
+        if ( fabs(x - check_x) < PERIODICITY_EPS && fabs(y - check_y) < PERIODICITY_EPS ) {
+            iter = iterations;
+            break;
+        }
+        if ( iter+1 == check_at ) {
+            check_x = x;
+            check_y = y;
+            check_at <<= 1;
+        }
+#endif
     }
+#if WITH_COUNTS
+    mandleset[tid] = (COUNT_TYPE) min(iter, (uint) COUNT_MAX);
+#else
     if ( iter == iterations)
   mandleset[tid] = 1;
     else
       mandleset[tid] = 0; 
+#endif
+}
+
+// Pixels of a row one work item of mandel_vec_kernel computes, the host picks 2, 4, 8 or 16 with -DVEC_WIDTH
+#ifndef VEC_WIDTH
+#define VEC_WIDTH 4
+#endif
+
+#define VEC_NAME(type, n) type##n
+#define VEC_OF(type, n) VEC_NAME(type, n)
+#define VEC_STORE(n) VEC_NAME(vstore, n)
+
+// Comparisons of MANDEL_VEC give -1 in the lanes where they hold
+typedef VEC_OF(MANDEL_SCALAR, VEC_WIDTH) MANDEL_VEC;
+typedef VEC_OF(MANDEL_MASK, VEC_WIDTH) MANDEL_VEC_MASK;
+
+#if VEC_WIDTH == 2
+#define VEC_LANES (MANDEL_VEC)(0, 1)
+#elif VEC_WIDTH == 4
+#define VEC_LANES (MANDEL_VEC)(0, 1, 2, 3)
+#elif VEC_WIDTH == 8
+#define VEC_LANES (MANDEL_VEC)(0, 1, 2, 3, 4, 5, 6, 7)
+#elif VEC_WIDTH == 16
+#define VEC_LANES (MANDEL_VEC)(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15)
+#else
+#error "VEC_WIDTH has to be 2, 4, 8 or 16"
+#endif
+
+// Same view as mandel_kernel on a 2D range, work item (x, y) computes the VEC_WIDTH pixels starting at column
+// x*VEC_WIDTH of row y of the band, one pixel per lane. Points escape once |z|^2 > 4.
+__kernel void mandel_vec_kernel (
+#if WITH_COUNTS
+  __global COUNT_TYPE * mandleset,
+#else
+  __global char * mandleset,
+#endif
+  const int width,
+  const int height,
+  const MANDEL_REAL scale,
+  const MANDEL_REAL offsetX,
+  const MANDEL_REAL offsetY,
+  const int iterations,
+  const int firstRow,
+  const int numRows
+  )
+{
+    int first_col = get_global_id(0) * VEC_WIDTH;
+    int row = get_global_id(1);
+    if ( first_col >= width || row >= numRows )
+        return;
+    int j = firstRow + row;
+
+    MANDEL_VEC i = (MANDEL_VEC) first_col + VEC_LANES;
+    MANDEL_VEC x0 = ((i*scale) - ((scale/2)*width))/width + offsetX;
+    MANDEL_REAL y0 = (((height-1-j)*scale) - ((scale/2)*height))/height + offsetY;
+
+    MANDEL_VEC x = x0;
+    MANDEL_VEC y = (MANDEL_VEC) y0;
+    MANDEL_VEC x2 = x*x;
+    MANDEL_VEC y2 = y*y;
+
+    // Points in the main cardioid or the period-2 bulb never escape
+    MANDEL_VEC xq = x0 - (MANDEL_REAL) 0.25;
+    MANDEL_VEC q = xq*xq + y0*y0;
+    MANDEL_VEC_MASK inside = (q * (q + xq) <= (MANDEL_REAL) 0.25 * y0*y0) | ((x0+1)*(x0+1) + y0*y0 <= (MANDEL_REAL) 0.0625);
+    MANDEL_VEC_MASK iter = select((MANDEL_VEC_MASK) 0, (MANDEL_VEC_MASK) iterations, inside);
+    MANDEL_VEC_MASK active = ~inside & (x2 + y2 <= 4);
+
+#if WITH_PERIODICITY
+    MANDEL_VEC check_x = x;
+    MANDEL_VEC check_y = y;
+    int check_at = 1;
+#endif
+
+    // The lanes iterate in lockstep, escaped lanes stop counting until all of them escaped
+    for (int k = 0; k < iterations && any(active); ++k)
+    {
+        y = 2 * x * y + y0;
+        x = x2 - y2 + x0;
+
+        x2 = x*x;
+        y2 = y*y;
+        iter -= active;
+
+#if WITH_PERIODICITY
+        // Back at the saved orbit point, the orbit is periodic
+        MANDEL_VEC_MASK periodic = active & (fabs(x - check_x) < PERIODICITY_EPS) & (fabs(y - check_y) < PERIODICITY_EPS);
+        iter = select(iter, (MANDEL_VEC_MASK) iterations, periodic);
+        active &= ~periodic;
+        if ( k+1 == check_at ) {
+            check_x = x;
+            check_y = y;
+            check_at <<= 1;
+        }
+#endif
+        active &= (x2 + y2 <= 4);
+    }
+
+    MANDEL_MASK lanes[VEC_WIDTH];
+    VEC_STORE(VEC_WIDTH)(iter, 0, lanes);
+    int base = row * width + first_col;
+    for (int l = 0; l < VEC_WIDTH && first_col + l < width; ++l)
+    {
+#if WITH_COUNTS
+        mandleset[base + l] = (COUNT_TYPE) min(lanes[l], (MANDEL_MASK) COUNT_MAX);
+#else
+        mandleset[base + l] = (lanes[l] == iterations) ? 1 : 0;
+#endif
+    }
+}
+
+// Deep zoom, every pixel iterates its offset to a reference orbit computed by the host (see mandle_perturb.h).
+// The host builds with -DPERTURB_DOUBLE=1 for devices with cl_khr_fp64, float offsets underflow at about 1e-38.
+#ifndef PERTURB_DOUBLE
+#define PERTURB_DOUBLE 0
+#endif
+
+#if PERTURB_DOUBLE
+#pragma OPENCL EXTENSION cl_khr_fp64 : enable
+typedef double REAL;
+#else
+typedef float REAL;
+#endif
+
+__kernel void mandel_perturb_kernel (
+#if WITH_COUNTS
+  __global COUNT_TYPE * mandleset,
+#else
+  __global char * mandleset,
+#endif
+  __global const REAL * orbit,
+  const int orbit_length,
+  const int width,
+  const int height,
+  const REAL scale,
+  const REAL real_min,
+  const REAL imag_min,
+  const int iterations,
+  const int firstRow,
+  const int numRows
+  )
+{
+    int tid = get_global_id(0);
+    if ( tid >= width * numRows )
+        return;
+
+    int i = tid%width;
+    int j = firstRow + tid/width;
+
+    // Offset of the pixel from the reference point, the orbit holds real and imag of Z_0 .. Z_{orbit_length-1}
+    REAL dc_x = real_min + i*scale;
+    REAL dc_y = imag_min + (height-1-j)*scale;
+    REAL dx = 0;
+    REAL dy = 0;
+    int m = 0;
+
+    uint iter = 0;
+    while ( iter < iterations )
+    {
+        // d' = (2 Z + d) d + dc
+        REAL tx = 2*orbit[2*m] + dx;
+        REAL ty = 2*orbit[2*m+1] + dy;
+        REAL temp = tx*dx - ty*dy + dc_x;
+        dy = tx*dy + ty*dx + dc_y;
+        dx = temp;
+        ++m;
+        ++iter;
+
+        REAL x = orbit[2*m] + dx;
+        REAL y = orbit[2*m+1] + dy;
+        REAL lengthsq = x*x + y*y;
+        if ( lengthsq >= 4 )
+            break;
+
+        // Glitch, closer to 0 than to the reference (or the reference ended): rebase onto Z_0
+        if ( lengthsq < dx*dx + dy*dy || m == orbit_length-1 ) {
+            dx = x;
+            dy = y;
+            m = 0;
+        }
+    }
+#if WITH_COUNTS
+    mandleset[tid] = (COUNT_TYPE) min(iter, (uint) COUNT_MAX);
+#else
+    mandleset[tid] = (iter == iterations) ? 1 : 0;
+#endif
 }
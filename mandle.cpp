@@ -31,6 +31,15 @@
 /** Our main header */
 #include "mandle.h"
 
+/** The master receives the pixels and writes or draws them itself */
+#define MASTER_DRAWS ((WITH_PBM && !WITH_MPIIO && !WITH_COUNTS) || WITH_X11)
+
+/** The master collects the escape counts of the whole image and writes them as a PGM/PPM at the end */
+#define MASTER_COUNTS (WITH_PBM && WITH_COUNTS)
+
+/** The master has the points of every tile, so it can keep them in the tile cache */
+#define MASTER_CACHES (WITH_CACHE && !WITH_MPIIO && (MASTER_DRAWS || MASTER_COUNTS))
+
 /**
  * The strategy name, used for the CSV and the window name in case of a X11 enabled build 
  */
@@ -39,9 +48,328 @@ const char* get_strategy_name(int strategy) {
         return "MPI-Static";
     else if ( strategy == STRATEGY_STATIC_RR )
         return "MPI-Static-RoundRobin";
+    else if ( strategy == STRATEGY_MARIANI_SILVER )
+        return "MPI-Dynamic-MarianiSilver";
+    else if ( strategy == STRATEGY_RMA )
+        return "MPI-RMA";
+    else if ( strategy == STRATEGY_STATIC_GATHER )
+        return "MPI-Static-Gatherv";
+    else if ( strategy == STRATEGY_STATIC_COST )
+        return "MPI-Static-CostModel";
+    else if ( strategy == STRATEGY_PROGRESSIVE )
+        return "MPI-Dynamic-Progressive";
     return "MPI-Dynamic"; 
 }
 
+/**
+ * Contiguous block of rows of a worker (0 based) in the static strategies, the first
+ * height % num_processes workers get one row more
+ */
+static void getStaticRows(int process, int num_processes, int height, int* initial_row, int* num_rows) {
+    int rows_per_worker = height / num_processes;
+    int rows_per_worker_left = height % num_processes;
+    *num_rows = rows_per_worker + ((process < rows_per_worker_left) ? 1 : 0);
+    *initial_row = process * rows_per_worker + ((process < rows_per_worker_left) ? process : rows_per_worker_left);
+}
+
+/**
+ * Split the rows into contiguous blocks of about the same cost, 'first_rows' gets num_processes+1 entries.
+ * The cost of the rows is estimated from a low resolution preview with at most COST_PREVIEW_ITERS
+ * iterations, points that do not escape in the preview are charged the full iteration count.
+ */
+static void getCostRows(int* first_rows, int num_processes, int width, int height, double scale_real, double scale_imag, int iters, double real_min, double imag_min) {
+    // With many workers every block is only a few rows high, keep at least 8 preview rows per worker
+    int preview_rows = (8 * num_processes > COST_PREVIEW_SIZE) ? 8 * num_processes : COST_PREVIEW_SIZE;
+    preview_rows = (height < preview_rows) ? height : preview_rows;
+    int preview_cols = (width < COST_PREVIEW_SIZE) ? width : COST_PREVIEW_SIZE;
+    int preview_iters = (iters < COST_PREVIEW_ITERS) ? iters : COST_PREVIEW_ITERS;
+    double* costs = (double*)malloc(preview_rows * sizeof(*costs));
+    double total = 0, cost = 0;
+
+    // Preview row i stands for the rows [i*height/preview_rows, (i+1)*height/preview_rows), we sample the middle one
+    for (int i = 0; i < preview_rows; ++i) {
+        int row = (int) ((long long) (2*i+1) * height / (2*preview_rows));
+        double imag = imag_min + ((double) (height-1-row) * scale_imag);
+        costs[i] = 0;
+        for (int j = 0; j < preview_cols; ++j) {
+            double real = real_min + ((double) ((long long) (2*j+1) * width / (2*preview_cols)) * scale_real);
+            int k;
+            if ( getPerturbReference() != NULL ) {
+                // Deep zoom, real and imag are offsets from the reference point
+                k = computePerturbIterations(getPerturbReference(), real, imag, preview_iters);
+            } else if ( getPrecision() == PRECISION_DD ) {
+                // Offsets from the origin of the double-double kernels
+                k = computePrecisionIterations(real, imag, preview_iters);
+            } else {
+                k = inMainCardioidOrBulb(real, imag) ? 0 : computeMandleIterations(real, imag, preview_iters);
+            }
+            costs[i] += 1 + ((k == preview_iters) ? iters : k);
+        }
+    }
+    for (int row = 0; row < height; ++row) {
+        total += costs[(long long) row * preview_rows / height];
+    }
+
+    // Cut whenever the accumulated cost passes the next share of the total
+    int process = 1;
+    first_rows[0] = 0;
+    for (int row = 0; row < height && process < num_processes; ++row) {
+        cost += costs[(long long) row * preview_rows / height];
+        while ( process < num_processes && cost >= total * process / num_processes ) {
+            first_rows[process++] = row + 1;
+        }
+    }
+    while ( process <= num_processes ) {
+        first_rows[process++] = height;
+    }
+    free(costs);
+}
+
+/**
+ * Queue work items at a dynamic worker until it holds DYNAMIC_PREFETCH of them. Once all rows are handed
+ * out the worker gets its stop message right behind its last item, so it does not need to ask for it.
+ * With 'items' the n-th item handed out is items[n] instead of n.
+ */
+static void refillWorker(int id, int* next_row, int height, int band_rows, int* rows_left, char* stop_sent, const int* items) {
+    while ( !stop_sent[id] && rows_left[id] <= (DYNAMIC_PREFETCH-1) * band_rows ) {
+        if (*next_row < height) {
+            MPI_Send((items != NULL) ? &items[*next_row] : next_row, 1, MPI_INT, id, MSG_FROM_MASTER_WORK, MPI_COMM_WORLD);
+            rows_left[id] += (height - *next_row < band_rows) ? height - *next_row : band_rows;
+            *next_row += band_rows;
+        } else {
+            MPI_Send(next_row, 0, MPI_INT, id, MSG_FROM_MASTER_STOP, MPI_COMM_WORLD);
+            stop_sent[id] = 1;
+        }
+    }
+}
+
+#if MASTER_DRAWS || MASTER_CACHES
+/**
+ * Whether a decoded tile is one of the layout
+ */
+static bool isLayoutTile(const TILE_LAYOUT* layout, int col, int row, int num_cols, int num_rows) {
+    int width = layout->width;
+    int height = layout->height;
+    return row >= 0 && row < height && col >= 0 && col < width && row % layout->tile_height == 0 && col % layout->tile_width == 0
+           && num_rows == ((height - row < layout->tile_height) ? height - row : layout->tile_height)
+           && num_cols == ((width - col < layout->tile_width) ? width - col : layout->tile_width);
+}
+#endif
+
+#if MASTER_DRAWS
+/**
+ * Hand a decoded row to the PBM writer and/or draw it into the X11 window
+ */
+static void drawRow(PBM_WRITER* pbm, char* row_data, const unsigned char* row_bits, int cur_row, int width, int height) {
+    if ( cur_row < 0 || cur_row >= height ) {
+        ERROR("Dropping corrupt row message\n");
+        return;
+    }
+#if WITH_PBM
+    pbmWriteRow(pbm, cur_row, row_bits);
+#endif
+#if !WITH_X11
+    (void) row_data;
+    (void) width;
+#endif
+#if WITH_X11
+    unpackRowBits(row_data, row_bits, width);
+    for (int col = 0; col < width; ++col) {
+        if ( row_data[col] == 1 ) {
+            drawPoint(col, cur_row);
+        }
+    }
+#endif
+}
+
+/**
+ * Draw a decoded tile. Tiles covering whole rows are drawn right away, other tiles are collected in the
+ * packed rows of their row of tiles, which is drawn once all of its tiles arrived.
+ */
+static void drawTile(PBM_WRITER* pbm, const TILE_LAYOUT* layout, unsigned char** band_bits, int* band_tiles, char* row_data, const unsigned char* tile_bits, int col, int row, int num_cols, int num_rows) {
+    if ( !isLayoutTile(layout, col, row, num_cols, num_rows) ) {
+        ERROR("Dropping corrupt tile message\n");
+        return;
+    }
+#if WITH_STREAM
+    // The PBM file is mapped, every tile goes straight to its place
+    (void) band_bits;
+    (void) band_tiles;
+    (void) row_data;
+    pbmWriteTile(pbm, col, row, num_cols, num_rows, tile_bits);
+#else
+    int width = layout->width;
+    int height = layout->height;
+    int row_size = rowBitsSize(width);
+    int tile_row_size = rowBitsSize(num_cols);
+    if ( layout->tile_cols == 1 ) {
+        for (int i = 0; i < num_rows; ++i) {
+            drawRow(pbm, row_data, tile_bits + (long long) i * row_size, row + i, width, height);
+        }
+        return;
+    }
+
+    // Tiles start at a multiple of 8 columns, so every tile row is a run of whole bytes of the image row
+    int band = row / layout->tile_height;
+    if ( band_bits[band] == NULL ) {
+        band_bits[band] = (unsigned char*)calloc((long long) num_rows * row_size, sizeof(unsigned char));
+        band_tiles[band] = layout->tile_cols;
+    }
+    for (int i = 0; i < num_rows; ++i) {
+        memcpy(band_bits[band] + (long long) i * row_size + col / 8, tile_bits + (long long) i * tile_row_size, tile_row_size);
+    }
+    if ( --band_tiles[band] == 0 ) {
+        for (int i = 0; i < num_rows; ++i) {
+            drawRow(pbm, row_data, band_bits[band] + (long long) i * row_size, row + i, width, height);
+        }
+        free(band_bits[band]);
+        band_bits[band] = NULL;
+    }
+#endif
+}
+
+/**
+ * Show a complete level of the progressive strategy. Coarse levels are written to their own PBM file and
+ * replace the window content, the full image goes through the PBM writer like the other strategies.
+ */
+static void drawLevel(PBM_WRITER* pbm, const PROGRESSIVE* progressive, int level, char* preview, char* row_data, unsigned char* row_bits) {
+    int width = progressive->width;
+    int height = progressive->height;
+    LOG("Level %d of %d complete, every %d. point\n", level+1, PROGRESSIVE_LEVELS, progressiveStep(level));
+#if WITH_X11
+    clearX11();
+#endif
+    if ( level == PROGRESSIVE_LEVELS-1 ) {
+        for (int row = 0; row < height; ++row) {
+            packRowBits(row_bits, progressive->image + (long long) row * width, width);
+            drawRow(pbm, row_data, row_bits, row, width, height);
+        }
+        return;
+    }
+
+    progressivePreview(progressive, level, preview);
+#if WITH_PBM
+    char filename[32];
+    snprintf(filename, sizeof(filename), "out_level%d.pbm", level);
+    createPBMFile(filename, preview, width, height);
+#endif
+#if WITH_X11
+    for (int row = 0; row < height; ++row) {
+        for (int col = 0; col < width; ++col) {
+            if ( preview[(long long) row * width + col] == 1 ) {
+                drawPoint(col, row);
+            }
+        }
+    }
+    XFlush(display);
+#endif
+}
+
+/**
+ * Store a decoded work item of the progressive strategy and show every level it completes
+ */
+static void drawProgressive(PBM_WRITER* pbm, PROGRESSIVE* progressive, char* preview, char* row_data, unsigned char* item_bits, int item, int num_samples) {
+    int level;
+    if ( item < 0 ) {
+        ERROR("Dropping corrupt progressive message\n");
+        return;
+    }
+    unpackRowBits(row_data, item_bits, num_samples);
+    if ( !progressiveStore(progressive, item, row_data, num_samples) ) {
+        ERROR("Dropping corrupt progressive message\n");
+        return;
+    }
+    while ( (level = progressiveNextLevel(progressive)) >= 0 ) {
+        drawLevel(pbm, progressive, level, preview, row_data, item_bits);
+    }
+}
+#endif
+
+#if MASTER_COUNTS
+/**
+ * Copy a decoded tile of escape counts into the count image, 'counts_file' is the file the image is mapped from or NULL
+ */
+static void storeCountTile(unsigned char* image, STREAM_FILE* counts_file, int count_bytes, const TILE_LAYOUT* layout, const unsigned char* tile_counts, int col, int row, int num_cols, int num_rows) {
+    if ( row < 0 || row > layout->height - num_rows || col < 0 || col > layout->width - num_cols ) {
+        ERROR("Dropping corrupt tile message\n");
+        return;
+    }
+    for (int i = 0; i < num_rows; ++i) {
+        memcpy(image + ((long long) (row + i) * layout->width + col) * count_bytes, tile_counts + (long long) i * num_cols * count_bytes, (long long) num_cols * count_bytes);
+    }
+    if ( counts_file != NULL ) {
+        streamWrote(counts_file, (long long) num_rows * num_cols * count_bytes);
+    }
+}
+#endif
+
+#if MASTER_CACHES
+/**
+ * Bytes of a decoded tile as the master keeps it, escape counts of 'point_bytes' each or packed 0/1 points
+ */
+static long long decodedTileSize(int num_cols, int num_rows, int point_bytes) {
+    return (point_bytes > 0) ? (long long) num_cols * num_rows * point_bytes : tileBitsSize(num_cols, num_rows);
+}
+#endif
+
+/**
+ * Hand a computed tile, or a row as a tile of 'width' x 1 points, to the master. With MPI-IO the tile
+ * goes straight into the file and the master only learns that it is done.
+ */
+static void sendTile(ROW_SENDER* sender, PBM_MPI_FILE* pbm_file, const char* data, int col, int row, int num_cols, int num_rows) {
+#if WITH_MPIIO
+    pbmMpiWriteTileData(pbm_file, col, row, num_cols, num_rows, data);
+    rowSenderSendHeader(sender, col, row, num_cols, num_rows);
+#else
+    (void) pbm_file;
+    rowSenderSendTile(sender, data, col, row, num_cols, num_rows);
+#endif
+}
+
+/**
+ * Compute and send the work items first_item, first_item+item_step, ... of the layout. Plain rows
+ * are computed WORKER_BAND_ROWS at a time, tiles one by one.
+ */
+static void workTiles(ROW_SENDER* sender, PBM_MPI_FILE* pbm_file, const TILE_LAYOUT* layout, char* data, int first_item, int item_step, int num_items, double scale_real, double scale_imag, int iters, double real_min, double imag_min) {
+    int width = layout->width;
+    int height = layout->height;
+    int first_col, first_row, num_cols, num_rows;
+#if WITH_COUNTS
+    // Escape counts of countBytes(iters) bytes each instead of 0/1 values, they never go to the file with MPI-IO
+    int count_bytes = countBytes(iters);
+    unsigned char* counts = (unsigned char*) data;
+    (void) pbm_file;
+#endif
+    if ( layout->tile_cols == 1 && layout->tile_height == 1 ) {
+        for (int k = 0; k < num_items; k += WORKER_BAND_ROWS) {
+            first_row = first_item + k * item_step;
+            num_rows = (num_items - k < WORKER_BAND_ROWS) ? num_items - k : WORKER_BAND_ROWS;
+#if WITH_COUNTS
+            computeMandleCountRows(counts, count_bytes, width, first_row, item_step, num_rows, scale_real, scale_imag, iters, height, real_min, imag_min);
+            for (int i = 0; i < num_rows; ++i) {
+                rowSenderSendCounts(sender, counts + (long long) i * width * count_bytes, 0, first_row + i * item_step, width, 1);
+            }
+#else
+            computeMandleRows(data, width, first_row, item_step, num_rows, scale_real, scale_imag, iters, height, real_min, imag_min);
+            for (int i = 0; i < num_rows; ++i) {
+                sendTile(sender, pbm_file, data + (long long) i * width, 0, first_row + i * item_step, width, 1);
+            }
+#endif
+        }
+    } else {
+        for (int k = 0; k < num_items; ++k) {
+            tileLayoutGet(layout, first_item + k * item_step, &first_col, &first_row, &num_cols, &num_rows);
+#if WITH_COUNTS
+            computeMandleCountTile(counts, count_bytes, first_col, first_row, num_cols, num_rows, scale_real, scale_imag, iters, height, real_min, imag_min);
+            rowSenderSendCounts(sender, counts, first_col, first_row, num_cols, num_rows);
+#else
+            computeMandleTile(data, first_col, first_row, num_cols, num_rows, scale_real, scale_imag, iters, height, real_min, imag_min);
+            sendTile(sender, pbm_file, data, first_col, first_row, num_cols, num_rows);
+#endif
+        }
+    }
+}
+
 /**
  * Main entry point
  */
@@ -58,14 +386,37 @@ int main (int argc, char *argv[]) {
     int width = X_PIX;
     int height = Y_PIX;
     int strategy = STRATEGY_STATIC;
+    int tile_width = 0;
+    int tile_height = 0;
+    const char* center_real = NULL;
+    const char* center_imag = NULL;
+    DD_REAL origin_real = { 0, 0 };
+    DD_REAL origin_imag = { 0, 0 };
+    int precision;
+    REF_ORBIT* orbit = NULL;
 
     // Initialize and check for commands
+#if WITH_OMP
+    // Only the main thread talks to MPI, outside of the parallel regions
+    int thread_level;
+    if (MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &thread_level) != MPI_SUCCESS) {
+#else
     if (MPI_Init(&argc, &argv) != MPI_SUCCESS) {
+#endif
         ERROR("MPI initialization error\n");
         exit(EXIT_FAILURE);
     }
     MPI_Comm_size(MPI_COMM_WORLD, &nProcs);
     MPI_Comm_rank(MPI_COMM_WORLD, &myID);
+#if WITH_OMP
+    // Without MPI_THREAD_FUNNELED the library does not allow other threads next to the MPI calls, run without a team
+    if (thread_level < MPI_THREAD_FUNNELED) {
+        if (myID == 0) {
+            ERROR("MPI does not provide MPI_THREAD_FUNNELED, running with a single OpenMP thread\n");
+        }
+        omp_set_num_threads(1);
+    }
+#endif
     if (nProcs < 2) {
         if (myID == 0) {
             ERROR("Number of processes must be at least 2\n");
@@ -77,7 +428,7 @@ int main (int argc, char *argv[]) {
     // Sanity checks
     if ( argc < 2 ) {
         if (myID == 0) {
-            ERROR("Usage: %s iterations [strategy sizeY sizeY] %d\n", argv[0], argc);
+            ERROR("Usage: %s iterations [strategy sizeX sizeY [tileX tileY [centerReal centerImag radius]]] %d\n", argv[0], argc);
         }
         MPI_Finalize();
         exit(EXIT_FAILURE);
@@ -91,9 +442,46 @@ int main (int argc, char *argv[]) {
         width = atof(argv[3]);
         height = atof(argv[4]);
     }
+    if (argc > 6) {
+        tile_width = atoi(argv[5]);
+        tile_height = atoi(argv[6]);
+    }
+    if (argc > 9) {
+        // Deep zoom, the view is given by its center as decimal strings of any length and the
+        // distance from the center to the top edge. The bounds are offsets from the center for now.
+        double radius = atof(argv[9]);
+        center_real = argv[7];
+        center_imag = argv[8];
+        real_max = radius * width / height;
+        real_min = -real_max;
+        imag_max = radius;
+        imag_min = -radius;
+        if ( !ddParse(&origin_real, center_real) || !ddParse(&origin_imag, center_imag) ) {
+            if (myID == 0) {
+                ERROR("Center '%s' '%s' is not a number\n", center_real, center_imag);
+            }
+            MPI_Finalize();
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // Iterate in the cheapest precision that still resolves the pixels, only a deep zoom can go on to perturbation
+    double spacing = fmin((real_max - real_min) / width, (imag_max - imag_min) / height);
+    double magnitude = fmax(fabs(origin_real.hi) + fmax(fabs(real_min), fabs(real_max)), fabs(origin_imag.hi) + fmax(fabs(imag_min), fabs(imag_max)));
+    precision = choosePrecision(spacing, magnitude, (center_real != NULL) ? PRECISION_PERTURB : PRECISION_DD);
+    if ( precision < PRECISION_DD ) {
+        // Plain coordinates resolve the view, move it back onto the center
+        real_min += origin_real.hi;
+        real_max += origin_real.hi;
+        imag_min += origin_imag.hi;
+        imag_max += origin_imag.hi;
+    }
+    if (myID == 0) {
+        LOG("Iterating in '%s'\n", getPrecisionName(precision));
+    }
 
     // Make sure we got a valid strategy
-    if ( strategy != STRATEGY_STATIC && strategy != STRATEGY_STATIC_RR && strategy != STRATEGY_DYNAMIC ) {
+    if ( strategy != STRATEGY_STATIC && strategy != STRATEGY_STATIC_RR && strategy != STRATEGY_DYNAMIC && strategy != STRATEGY_MARIANI_SILVER && strategy != STRATEGY_RMA && strategy != STRATEGY_STATIC_GATHER && strategy != STRATEGY_STATIC_COST && strategy != STRATEGY_PROGRESSIVE ) {
         if (myID == 0) {
             ERROR("Strategy '%d' not valid\n", strategy);
         }
@@ -101,19 +489,112 @@ int main (int argc, char *argv[]) {
         exit(EXIT_FAILURE);
     }
 
+#if WITH_COUNTS
+    // The Mariani-Silver, gather and progressive strategies only know 0/1 pixels
+    if ( strategy == STRATEGY_MARIANI_SILVER || strategy == STRATEGY_STATIC_GATHER || strategy == STRATEGY_PROGRESSIVE ) {
+        if (myID == 0) {
+            ERROR("Strategy '%s' does not support escape counts\n", get_strategy_name(strategy));
+        }
+        MPI_Finalize();
+        exit(EXIT_FAILURE);
+    }
+#endif
+
+#if WITH_MPIIO
+    // The samples of the coarse levels are spread over the whole image, the master has to collect them
+    if ( strategy == STRATEGY_PROGRESSIVE ) {
+        if (myID == 0) {
+            ERROR("Strategy '%s' does not support MPI-IO\n", get_strategy_name(strategy));
+        }
+        MPI_Finalize();
+        exit(EXIT_FAILURE);
+    }
+#endif
+
+#if WITH_STREAM
+    // The levels are kept in memory as whole images, which is what streaming avoids
+    if ( strategy == STRATEGY_PROGRESSIVE ) {
+        if (myID == 0) {
+            ERROR("Strategy '%s' does not support WITH_STREAM\n", get_strategy_name(strategy));
+        }
+        MPI_Finalize();
+        exit(EXIT_FAILURE);
+    }
+#endif
+
+    // The static, round-robin, dynamic and RMA strategies hand out tiles in Morton order, the others work on rows
+    if ( tile_width > 0 && strategy != STRATEGY_STATIC && strategy != STRATEGY_STATIC_RR && strategy != STRATEGY_DYNAMIC && strategy != STRATEGY_RMA ) {
+        if (myID == 0) {
+            ERROR("Strategy '%s' works on rows, ignoring the tile size\n", get_strategy_name(strategy));
+        }
+        tile_width = tile_height = 0;
+    }
+    TILE_LAYOUT* layout = tileLayoutCreate(width, height, tile_width, tile_height);
+
+    // The reference orbit of a deep zoom is computed once by the master and shared with the workers
+    if ( precision == PRECISION_PERTURB ) {
+        if (myID == 0) {
+            orbit = refOrbitCreate(center_real, center_imag, iterations);
+        }
+        refOrbitBcast(&orbit, 0, MPI_COMM_WORLD);
+        if ( orbit == NULL ) {
+            MPI_Finalize();
+            exit(EXIT_FAILURE);
+        }
+        setPerturbReference(orbit);
+    } else {
+        setPrecisionOrigin(&origin_real, &origin_imag);
+        setPrecision(precision);
+    }
+
+    // Repeated renders of a view take its tiles from the cache, the dynamic strategy hands out the others
+    TILE_CACHE* cache = NULL;
+#if MASTER_CACHES
+    if ( myID == 0 && strategy == STRATEGY_DYNAMIC ) {
+        CACHE_VIEW view;
+        memset(&view, 0, sizeof(view));
+        view.real_min = real_min;
+        view.imag_min = imag_min;
+        view.scale_real = (double) (real_max - real_min) / (double) width;
+        view.scale_imag = (double) (imag_max - imag_min) / (double) height;
+        view.height = height;
+        view.iters = iterations;
+        view.precision = precision;
+#if WITH_COUNTS
+        view.point_bytes = countBytes(iterations);
+#endif
+        view.renderer = CACHE_RENDERER_CPU;
+        if ( precision >= PRECISION_DD ) {
+            // The bounds are offsets from the center
+            view.origin_real = origin_real;
+            view.origin_imag = origin_imag;
+        }
+        if ( precision == PRECISION_PERTURB ) {
+            view.center = cacheHash(cacheHash(0, center_real, strlen(center_real)), center_imag, strlen(center_imag));
+        }
+        cache = tileCacheOpen(&view);
+    } else if ( myID == 0 ) {
+        ERROR("Strategy '%s' does not use the tile cache\n", get_strategy_name(strategy));
+    }
+#endif
+
     // Now call a master or a slave process
     if (myID == 0) {
 #if WITH_X11
         initX11(get_strategy_name(strategy), width, height, 0, 0);
 #endif
-        master_proc(strategy, nProcs-1, width, height, real_min, real_max, imag_min, imag_max, iterations);
+        master_proc(strategy, nProcs-1, layout, width, height, real_min, real_max, imag_min, imag_max, iterations, cache);
 #if WITH_X11
         flushX11AndWait(30);
 #endif
     }
     else {
-        worker_proc(strategy, myID, nProcs-1, width, height, real_min, real_max, imag_min, imag_max, iterations);
+        worker_proc(strategy, myID, nProcs-1, layout, width, height, real_min, real_max, imag_min, imag_max, iterations);
     }
+    tileCacheClose(cache);
+    tileLayoutFree(layout);
+    setPerturbReference(NULL);
+    refOrbitFree(orbit);
 
     // We are donw :D
     MPI_Finalize();
@@ -123,19 +604,72 @@ int main (int argc, char *argv[]) {
 /**
  * The master process, will distribute the work to the worker processes and wait for them to finish.
  */
-void master_proc(int strategy, int num_processes, int width, int height, double real_min, double real_max, double imag_min, double imag_max, int iters) {
+void master_proc(int strategy, int num_processes, const TILE_LAYOUT* layout, int width, int height, double real_min, double real_max, double imag_min, double imag_max, int iters, TILE_CACHE* cache) {
     LOG("Master Process\n");
+#if !MASTER_CACHES
+    // Only a master that has the points of the tiles keeps them in the cache
+    (void) cache;
+#endif
     // Basic values for our process, this is used byt both version,
     // the static and the round-robin version.
     long color_min = 0;
     long color_max = 0;
     long initial_msg[MSG_FROM_MASTER_LEN];
-    int initial_row, cur_row, next_row;
-    int num_rows, rows_per_worker, rows_per_worker_left;
-    int id, workers_active;
+    int initial_row, next_row;
+    int num_rows;
+    int id, workers_active = 0;
+    int band_rows = 1;
+    int* rows_left = NULL;
+    char* stop_sent = NULL;
+    int* items = NULL;
+    int msg_length;
+    int row_counter = 0;
+    MPI_Win counter_win;
     MPI_Status mpi_status;
 
-    long* recv_msg = (long*)malloc((width+1) * sizeof(*recv_msg));
+    // Rows and tiles arrive encoded (see mandle_msg.h) and are decoded into a bitmap, unpacked only for drawing.
+    // Tiles narrower than the image wait in the packed rows of their row of tiles until it is complete.
+#if WITH_COUNTS
+    // In count mode the tiles carry escape counts, collected into the count image of the whole image
+    int count_bytes = countBytes(iters);
+    int recv_size = countTileMsgMaxSize(layout->tile_width, layout->tile_height, count_bytes);
+    int tile_size = layout->tile_width * layout->tile_height * count_bytes;
+#else
+    int recv_size = tileMsgMaxSize(layout->tile_width, layout->tile_height);
+    int tile_size = tileBitsSize(layout->tile_width, layout->tile_height);
+#endif
+#if MASTER_COUNTS && WITH_STREAM
+    // Gigapixel count images do not fit into memory, they are collected in a mapped temporary file
+    STREAM_FILE* counts_file = streamOpen("out.counts", "", (long long) width * height * count_bytes, true);
+    if ( counts_file == NULL ) {
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+    unsigned char* image_counts = streamData(counts_file);
+#elif MASTER_COUNTS
+    STREAM_FILE* counts_file = NULL;
+    unsigned char* image_counts = (unsigned char*)calloc((long long) width * height, count_bytes);
+#endif
+    // The progressive strategy hands out rows and columns of samples of its levels instead of tiles,
+    // the samples are collected until a level is complete
+    int num_items = layout->num_tiles;
+    int row_cols = width;
+    PROGRESSIVE* progressive = NULL;
+    char* preview = NULL;
+    if ( strategy == STRATEGY_PROGRESSIVE ) {
+        progressive = progressiveCreate(width, height, MASTER_DRAWS);
+        num_items = progressiveNumItems(progressive);
+        row_cols = progressiveMaxSamples(width, height);
+        recv_size = tileMsgMaxSize(row_cols, 1);
+        tile_size = tileBitsSize(row_cols, 1);
+#if MASTER_DRAWS
+        preview = (char*)malloc((long long) width * height * sizeof(*preview));
+#endif
+    }
+    unsigned char* recv_msg = (unsigned char*)malloc(recv_size);
+    unsigned char* tile_bits = (unsigned char*)malloc(tile_size);
+    char* row_data = (char*)malloc(row_cols * sizeof(*row_data));
+    unsigned char** band_bits = (unsigned char**)calloc(layout->tile_rows, sizeof(*band_bits));
+    int* band_tiles = (int*)calloc(layout->tile_rows, sizeof(*band_tiles));
 
     // The following vars are used for timing stuff
     double start_time, end_time;
@@ -144,104 +678,200 @@ void master_proc(int strategy, int num_processes, int width, int height, double
     MPI_Bcast(&color_max, 1, MPI_LONG, 0, MPI_COMM_WORLD);
     MPI_Bcast(&color_min, 1, MPI_LONG, 0, MPI_COMM_WORLD);
 
+#if WITH_MPIIO
+    // The workers write their rows themselves, we take part in creating the file and write its header
+    PBM_MPI_FILE* pbm_file = pbmMpiOpen("out.pbm", width, height, MPI_COMM_WORLD);
+    if ( pbm_file == NULL ) {
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+#endif
+
     // Start
     start_time = MPI_Wtime();
 
-    if ( strategy == STRATEGY_STATIC ) {
-        // Calculate the number of roww per worker and send them the
-        // required data to start (start row and number of rows)
-        initial_row = 0;
-        rows_per_worker = height / num_processes;
-        rows_per_worker_left = height % num_processes;
+#if WITH_PBM && !WITH_MPIIO && !WITH_COUNTS
+    // Rows are streamed into the PBM file as they arrive, or copied into the mapped file with WITH_STREAM
+#if WITH_STREAM
+    PBM_WRITER* pbm = pbmOpenMapped("out.pbm", width, height);
+#else
+    PBM_WRITER* pbm = pbmOpen("out.pbm", width, height, PBM_WINDOW);
+#endif
+    if ( pbm == NULL ) {
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+#elif MASTER_DRAWS
+    PBM_WRITER* pbm = NULL;
+#endif
 
-        // Send work to worker processed
+    if ( strategy == STRATEGY_STATIC || strategy == STRATEGY_STATIC_COST ) {
+        // The cost model strategy balances the blocks by the estimated cost instead of the row count
+        int* first_rows = NULL;
+        if ( strategy == STRATEGY_STATIC_COST ) {
+            first_rows = (int*)malloc((num_processes+1) * sizeof(*first_rows));
+            getCostRows(first_rows, num_processes, width, height, (real_max - real_min) / (double) width,
+                        (imag_max - imag_min) / (double) height, iters, real_min, imag_min);
+        }
+
+        // Send every worker the required data to start (start row and number of rows)
         for (int process = 0; process < num_processes; ++process) {
-            // Accum row number
-            if ( process < rows_per_worker_left )
-                num_rows = rows_per_worker + 1;
-            else
-                num_rows = rows_per_worker;
+            if ( first_rows != NULL ) {
+                initial_row = first_rows[process];
+                num_rows = first_rows[process+1] - first_rows[process];
+            } else {
+                getStaticRows(process, num_processes, layout->num_tiles, &initial_row, &num_rows);
+            }
 
-            // Send to the prcess the start row and the number of rows to be processed
+            // Send to the prcess the start row (or tile) and the number of rows (or tiles) to be processed
             initial_msg[0] = initial_row;
             initial_msg[1] = num_rows;
             MPI_Send(initial_msg, MSG_FROM_MASTER_LEN, MPI_LONG, process+1, MSG_FROM_MASTER, MPI_COMM_WORLD);
-
-            // Shift initial_rows by num_rows to prepare next process
-            initial_row += num_rows;
         }
-    } else if ( strategy == STRATEGY_DYNAMIC ) {
-        // Send each worker a starting row
+        free(first_rows);
+    } else if ( strategy == STRATEGY_DYNAMIC || strategy == STRATEGY_MARIANI_SILVER || strategy == STRATEGY_PROGRESSIVE ) {
+        // Work is handed out in bands of rows, a single row, tile or progressive item for the other strategies. Each
+        // worker holds up to DYNAMIC_PREFETCH bands, we keep track of the rows it still owes us to refill it.
+        band_rows = (strategy == STRATEGY_MARIANI_SILVER) ? MS_BAND_ROWS : 1;
+        rows_left = (int*)calloc(num_processes+1, sizeof(*rows_left));
+        stop_sent = (char*)calloc(num_processes+1, sizeof(*stop_sent));
         next_row = 0;
-        workers_active = 0;
+
+#if MASTER_CACHES
+        // Tiles the cache has are drawn right away, only the others are handed out
+        if ( cache != NULL ) {
+            int misses = 0;
+            items = (int*)malloc(num_items * sizeof(*items));
+            for (int item = 0; item < num_items; ++item) {
+                int cur_col, cur_row, num_cols;
+                tileLayoutGet(layout, item, &cur_col, &cur_row, &num_cols, &num_rows);
+                if ( !tileCacheLoad(cache, cur_col, cur_row, num_cols, num_rows, tile_bits, decodedTileSize(num_cols, num_rows, cache->view.point_bytes)) ) {
+                    items[misses++] = item;
+                    continue;
+                }
+#if MASTER_COUNTS
+                storeCountTile(image_counts, counts_file, count_bytes, layout, tile_bits, cur_col, cur_row, num_cols, num_rows);
+#else
+                drawTile(pbm, layout, band_bits, band_tiles, row_data, tile_bits, cur_col, cur_row, num_cols, num_rows);
+#endif
+            }
+            num_items = misses;
+        }
+#endif
+
+        // First deal out a single band per worker, so the first bands get spread over all of them
+        for (int process = 0; process < num_processes; ++process) {
+            if (next_row < num_items) {
+                MPI_Send((items != NULL) ? &items[next_row] : &next_row, 1, MPI_INT, process+1, MSG_FROM_MASTER_WORK, MPI_COMM_WORLD);
+                rows_left[process+1] = (num_items - next_row < band_rows) ? num_items - next_row : band_rows;
+                next_row += band_rows;
+                ++workers_active;
+            }
+        }
         for (int process = 0; process < num_processes; ++process) {
-            MPI_Send(&next_row, 1, MPI_INT, process+1, MSG_FROM_MASTER_WORK, MPI_COMM_WORLD);
-            ++next_row;
-            ++workers_active;
+            refillWorker(process+1, &next_row, num_items, band_rows, rows_left, stop_sent, items);
         }
+    } else if ( strategy == STRATEGY_RMA ) {
+        // We only expose the shared row counter, the workers claim their rows from it on their own
+        MPI_Win_create(&row_counter, sizeof(row_counter), sizeof(row_counter), MPI_INFO_NULL, MPI_COMM_WORLD, &counter_win);
     }
 
-#if WITH_PBM
-    // Allocate enough for the final image
-    char* mandleData = (char*) calloc(width * height, sizeof(char));
-#endif
-
-    if ( strategy == STRATEGY_STATIC || strategy == STRATEGY_STATIC_RR ) {
+    if ( strategy == STRATEGY_STATIC || strategy == STRATEGY_STATIC_RR || strategy == STRATEGY_RMA || strategy == STRATEGY_STATIC_COST ) {
         // Wait for work to be completed
-        for (int row = 0; row < height; ++row) {
-            MPI_Recv(recv_msg, width+1, MPI_LONG, MPI_ANY_SOURCE, MSG_FROM_WORKER, MPI_COMM_WORLD, &mpi_status);
-#if WITH_PBM || WITH_X11
-            cur_row = recv_msg[0];
-            for (int col = 0; col < width; ++col) {
-#if WITH_PBM
-                mandleData[(cur_row*height)+col] = 0;
-#endif
-                if ( recv_msg[col+1] == 1 ) {
-#if WITH_PBM
-                    mandleData[(cur_row*height)+col] = 1;
-#endif
-#if WITH_X11
-                    drawPoint(col, cur_row);
-#endif
-                }
-            }
+        for (int tile = 0; tile < layout->num_tiles; ++tile) {
+            MPI_Recv(recv_msg, recv_size, MPI_BYTE, MPI_ANY_SOURCE, MSG_FROM_WORKER, MPI_COMM_WORLD, &mpi_status);
+            MPI_Get_count(&mpi_status, MPI_BYTE, &msg_length);
+#if MASTER_COUNTS
+            int cur_col, num_cols;
+            int cur_row = decodeCountTileMsg(recv_msg, msg_length, tile_bits, count_bytes, tile_size, &cur_col, &num_cols, &num_rows);
+            storeCountTile(image_counts, counts_file, count_bytes, layout, tile_bits, cur_col, cur_row, num_cols, num_rows);
+#elif MASTER_DRAWS
+            int cur_col, num_cols;
+            int cur_row = decodeTileMsg(recv_msg, msg_length, tile_bits, tile_size, &cur_col, &num_cols, &num_rows);
+            drawTile(pbm, layout, band_bits, band_tiles, row_data, tile_bits, cur_col, cur_row, num_cols, num_rows);
 #endif
         }
-    } else if ( strategy == STRATEGY_DYNAMIC ) {
+    } else if ( strategy == STRATEGY_DYNAMIC || strategy == STRATEGY_MARIANI_SILVER || strategy == STRATEGY_PROGRESSIVE ) {
         // If we got workers active go on!
         while (workers_active > 0) {
-            MPI_Recv(recv_msg, width+1, MPI_LONG, MPI_ANY_SOURCE, MSG_FROM_WORKER, MPI_COMM_WORLD, &mpi_status);
+            MPI_Recv(recv_msg, recv_size, MPI_BYTE, MPI_ANY_SOURCE, MSG_FROM_WORKER, MPI_COMM_WORLD, &mpi_status);
+            MPI_Get_count(&mpi_status, MPI_BYTE, &msg_length);
 
-            --workers_active;
             id = mpi_status.MPI_SOURCE;
 
-            // Check for work left
-            if (next_row < height) {
-                MPI_Send(&next_row, 1, MPI_INT, id, MSG_FROM_MASTER_WORK, MPI_COMM_WORLD);
-                ++next_row;
-                ++workers_active;
-            } else {
-                MPI_Send(&next_row, 0, MPI_INT, id, MSG_FROM_MASTER_STOP, MPI_COMM_WORLD);
+            // Keep the worker's queue filled, it is done once it owes us no more rows
+            --rows_left[id];
+            refillWorker(id, &next_row, num_items, band_rows, rows_left, stop_sent, items);
+            if (rows_left[id] == 0) {
+                --workers_active;
             }
 
-#if WITH_PBM || WITH_X11
+#if MASTER_COUNTS
+            // Keep the counts for the image
+            int cur_col, num_cols;
+            int cur_row = decodeCountTileMsg(recv_msg, msg_length, tile_bits, count_bytes, tile_size, &cur_col, &num_cols, &num_rows);
+            storeCountTile(image_counts, counts_file, count_bytes, layout, tile_bits, cur_col, cur_row, num_cols, num_rows);
+#elif MASTER_DRAWS
             // Draw what we have
-            cur_row = recv_msg[0];
-            for (int col = 0; col < width; ++col) {
-#if WITH_PBM
-                mandleData[(cur_row*height)+col] = 0;
+            int cur_col, num_cols;
+            int cur_row = decodeTileMsg(recv_msg, msg_length, tile_bits, tile_size, &cur_col, &num_cols, &num_rows);
+            if ( progressive != NULL ) {
+                drawProgressive(pbm, progressive, preview, row_data, tile_bits, cur_row, num_cols);
+            } else {
+                drawTile(pbm, layout, band_bits, band_tiles, row_data, tile_bits, cur_col, cur_row, num_cols, num_rows);
+            }
 #endif
-                if ( recv_msg[col+1] == 1 ) {
-#if WITH_PBM
-                    mandleData[(cur_row*height)+col] = 1;
+#if MASTER_CACHES
+            // Keep the tile for the next render of the view
+            if ( cache != NULL && isLayoutTile(layout, cur_col, cur_row, num_cols, num_rows) ) {
+                tileCacheStore(cache, cur_col, cur_row, num_cols, num_rows, tile_bits, decodedTileSize(num_cols, num_rows, cache->view.point_bytes));
+            }
 #endif
-#if WITH_X11
-                    drawPoint(col, cur_row);
+        }
+    } else if ( strategy == STRATEGY_STATIC_GATHER ) {
+        // Both sides know the static row blocks, so the image is collected in rounds where every
+        // worker contributes up to GATHER_CHUNK_ROWS packed rows of its block with one MPI_Gatherv
+        int bits_size = rowBitsSize(width);
+        int max_rows = (height + num_processes - 1) / num_processes;
+        int rounds = (max_rows + GATHER_CHUNK_ROWS - 1) / GATHER_CHUNK_ROWS;
+        int* counts = (int*)calloc(num_processes+1, sizeof(*counts));
+        int* displs = (int*)calloc(num_processes+1, sizeof(*displs));
+        unsigned char* gather_bits = (unsigned char*)malloc((long long) num_processes * GATHER_CHUNK_ROWS * bits_size);
+
+        for (int round = 0; round < rounds; ++round) {
+            int offset = 0;
+            for (int process = 0; process < num_processes; ++process) {
+                getStaticRows(process, num_processes, height, &initial_row, &num_rows);
+                num_rows -= round * GATHER_CHUNK_ROWS;
+                num_rows = (num_rows < 0) ? 0 : (num_rows > GATHER_CHUNK_ROWS) ? GATHER_CHUNK_ROWS : num_rows;
+                counts[process+1] = num_rows * bits_size;
+                displs[process+1] = offset;
+                offset += counts[process+1];
+            }
+#if WITH_MPIIO
+            // The workers write their chunks with one collective write instead
+            pbmMpiWriteRowsAll(pbm_file, 0, 0, NULL);
+#else
+            MPI_Gatherv(NULL, 0, MPI_BYTE, gather_bits, counts, displs, MPI_BYTE, 0, MPI_COMM_WORLD);
 #endif
+
+#if MASTER_DRAWS
+            for (int process = 0; process < num_processes; ++process) {
+                getStaticRows(process, num_processes, height, &initial_row, &num_rows);
+                for (int i = 0; i < counts[process+1] / bits_size; ++i) {
+                    int cur_row = initial_row + round * GATHER_CHUNK_ROWS + i;
+                    drawRow(pbm, row_data, gather_bits + displs[process+1] + (long long) i * bits_size, cur_row, width, height);
                 }
             }
 #endif
         }
+
+        free(gather_bits);
+        free(displs);
+        free(counts);
+    }
+
+    if ( strategy == STRATEGY_RMA ) {
+        // All rows arrived, so no worker will touch the counter anymore
+        MPI_Win_free(&counter_win);
     }
 
     // Finished
@@ -251,25 +881,50 @@ void master_proc(int strategy, int num_processes, int width, int height, double
     FILE* output;
     output = fopen ( "output.csv" , "a+" );
 #if WITH_OMP
-    fprintf(output, "%s,%d,%d,%d,%g\n", get_strategy_name(strategy), num_processes, omp_get_max_threads(), (width*height), end_time - start_time);
+    fprintf(output, "%s,%d,%d,%lld,%g\n", get_strategy_name(strategy), num_processes, omp_get_max_threads(), (long long) width * height, end_time - start_time);
 #else
-    fprintf(output, "%s,%d,%d,%g\n", get_strategy_name(strategy), num_processes, (width*height), end_time - start_time);
+    fprintf(output, "%s,%d,%lld,%g\n", get_strategy_name(strategy), num_processes, (long long) width * height, end_time - start_time);
 #endif
     fclose (output);
 
-#if WITH_PBM
-    // Create PBM file
-    createPBMFile("out.pbm", mandleData, width, height);
-    free(mandleData);
+#if WITH_MPIIO
+    pbmMpiClose(pbm_file);
+#elif MASTER_COUNTS
+    // The counts are equalized over the whole image, so the image is only written once all arrived
+#if COUNT_PALETTE
+    createPPMFile("out.ppm", image_counts, count_bytes, width, height, iters);
+#else
+    createPGMFile("out.pgm", image_counts, count_bytes, width, height, iters);
+#endif
+    if ( counts_file != NULL ) {
+        streamClose(counts_file);
+    } else {
+        free(image_counts);
+    }
+#elif WITH_PBM
+    // Write what is left in the reorder window
+    pbmClose(pbm);
 #endif
 
+    for (int band = 0; band < layout->tile_rows; ++band) {
+        free(band_bits[band]);
+    }
+    free(band_tiles);
+    free(band_bits);
+    free(items);
+    free(stop_sent);
+    free(rows_left);
+    free(preview);
+    progressiveFree(progressive);
+    free(row_data);
+    free(tile_bits);
     free(recv_msg);
 }
 
 /**
  * The worker process, will process those rows that the master told him and send the result back.
  */
-void worker_proc(int strategy, int ID, int num_processes, int width, int height, double real_min, double real_max, double imag_min, double imag_max, int iters) {
+void worker_proc(int strategy, int ID, int num_processes, const TILE_LAYOUT* layout, int width, int height, double real_min, double real_max, double imag_min, double imag_max, int iters) {
     LOG("Worker: %d\n", ID);
 
     // Basic values for our process, this is used byt both version,
@@ -279,43 +934,135 @@ void worker_proc(int strategy, int ID, int num_processes, int width, int height,
     double scale_real, scale_imag;
     long initial_msg[MSG_FROM_MASTER_LEN];
     int initial_row, num_rows, last_row, cur_row;
+    int band_rows = WORKER_BAND_ROWS;
+    const int chunk_rows = RMA_CHUNK_ROWS;
+    MPI_Win counter_win;
     MPI_Status mpi_status;
 
-    long* send_msg = (long*)malloc((width+1) * sizeof(*send_msg));
+    // Rows are computed a band at a time into row_data, so the tasks of the OpenMP team are the tiles of the whole band,
+    // tiles are computed one at a time. Each row or tile is then handed to the sender, which encodes it
+    // (see mandle_msg.h) and keeps ROW_SEND_BUFFERS messages in flight while we compute the next ones.
+    if ( strategy == STRATEGY_MARIANI_SILVER )
+        band_rows = MS_BAND_ROWS;
+    else if ( strategy == STRATEGY_STATIC_GATHER )
+        band_rows = GATHER_CHUNK_ROWS;
+    if ( band_rows < layout->tile_height )
+        band_rows = layout->tile_height;
+#if WITH_COUNTS
+    // Escape counts take countBytes(iters) bytes per point
+    const int count_bytes = countBytes(iters);
+#else
+    const int count_bytes = 0;
+#endif
+    // A progressive work item may have more samples than a row
+    int row_cols = (strategy == STRATEGY_PROGRESSIVE) ? progressiveMaxSamples(width, height) : width;
+    char* row_data = (char*)malloc((long long) row_cols * band_rows * ((count_bytes > 0) ? count_bytes : 1));
+    ROW_SENDER* sender = rowSenderCreate(row_cols, layout->tile_height, count_bytes, ROW_SEND_BUFFERS, 0, MSG_FROM_WORKER, MPI_COMM_WORLD);
 
     // Get color values from the master process
     MPI_Bcast(&color_max, 1, MPI_LONG, 0, MPI_COMM_WORLD);
     MPI_Bcast(&color_min, 1, MPI_LONG, 0, MPI_COMM_WORLD);
 
+#if WITH_MPIIO
+    // Our rows go straight into the shared PBM file
+    PBM_MPI_FILE* pbm_file = pbmMpiOpen("out.pbm", width, height, MPI_COMM_WORLD);
+    if ( pbm_file == NULL ) {
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+#else
+    PBM_MPI_FILE* pbm_file = NULL;
+#endif
+
     // Compute scale factors
     scale_real = (double) (real_max - real_min) / (double) width;
     scale_imag = (double) (imag_max - imag_min) / (double) height; 
 
-    if ( strategy == STRATEGY_STATIC ) {
-        // Get the job data from the master
-        MPI_Recv(initial_msg, MSG_FROM_MASTER_LEN, MPI_LONG, 0, MSG_FROM_MASTER, MPI_COMM_WORLD, &mpi_status);
-        initial_row = initial_msg[0];
-        num_rows = initial_msg[1];
-        last_row = initial_row + num_rows;
+    // One OpenMP team works through the whole assignment. The main thread makes all MPI calls (MPI_THREAD_FUNNELED)
+    // and spawns the tiles as tasks, the other threads run them while they wait at the end of the region.
+#if WITH_OMP
+    #pragma omp parallel
+    #pragma omp master
+#endif
+    {
+        if ( strategy == STRATEGY_STATIC || strategy == STRATEGY_STATIC_COST ) {
+            // Get the job data from the master
+            MPI_Recv(initial_msg, MSG_FROM_MASTER_LEN, MPI_LONG, 0, MSG_FROM_MASTER, MPI_COMM_WORLD, &mpi_status);
+            initial_row = initial_msg[0];
+            num_rows = initial_msg[1];
+            workTiles(sender, pbm_file, layout, row_data, initial_row, 1, num_rows, scale_real, scale_imag, iters, real_min, imag_min);
+        } else if ( strategy == STRATEGY_STATIC_GATHER ) {
+            // We know our block without asking the master, the rows are packed and handed over
+            // in the same MPI_Gatherv rounds the master runs
+            int bits_size = rowBitsSize(width);
+            int max_rows = (height + num_processes - 1) / num_processes;
+            int rounds = (max_rows + GATHER_CHUNK_ROWS - 1) / GATHER_CHUNK_ROWS;
+            unsigned char* gather_bits = (unsigned char*)malloc((long long) GATHER_CHUNK_ROWS * bits_size);
+            getStaticRows(ID-1, num_processes, height, &initial_row, &num_rows);
+            last_row = initial_row + num_rows;
 
-        for (int i = initial_row; i < last_row; ++i) {
-            computeMandleColum(send_msg, width, i, scale_real, scale_imag, iters, height, real_min, imag_min); 
-            MPI_Send(send_msg, width+1, MPI_LONG, 0, MSG_FROM_WORKER, MPI_COMM_WORLD);
-        }
-    } else if ( strategy == STRATEGY_STATIC_RR ) {
-        for (int i = (ID-1); i < height; i += num_processes) {
-            computeMandleColum(send_msg, width, i, scale_real, scale_imag, iters, height, real_min, imag_min);
-            MPI_Send(send_msg, width+1, MPI_LONG, 0, MSG_FROM_WORKER, MPI_COMM_WORLD);
-        }
-    } else if ( strategy == STRATEGY_DYNAMIC ) {
-        // Work until we have no more work to be done
-        while ( ((MPI_Recv(&cur_row, 1, MPI_INT, 0, MPI_ANY_TAG, MPI_COMM_WORLD, &mpi_status)) == MPI_SUCCESS) && (mpi_status.MPI_TAG == MSG_FROM_MASTER_WORK) ) {
-            computeMandleColum(send_msg, width, cur_row, scale_real, scale_imag, iters, height, real_min, imag_min);
-            MPI_Send(send_msg, width+1, MPI_LONG, 0, MSG_FROM_WORKER, MPI_COMM_WORLD);
+            for (int round = 0; round < rounds; ++round) {
+                cur_row = initial_row + round * GATHER_CHUNK_ROWS;
+                int chunk = (last_row - cur_row < 0) ? 0 : (last_row - cur_row > GATHER_CHUNK_ROWS) ? GATHER_CHUNK_ROWS : last_row - cur_row;
+                computeMandleRows(row_data, width, cur_row, 1, chunk, scale_real, scale_imag, iters, height, real_min, imag_min);
+                for (int i = 0; i < chunk; ++i) {
+                    packRowBits(gather_bits + (long long) i * bits_size, row_data + (long long) i * width, width);
+                }
+#if WITH_MPIIO
+                pbmMpiWriteRowsAll(pbm_file, cur_row, chunk, gather_bits);
+#else
+                MPI_Gatherv(gather_bits, chunk * bits_size, MPI_BYTE, NULL, NULL, NULL, MPI_BYTE, 0, MPI_COMM_WORLD);
+#endif
+            }
+            free(gather_bits);
+        } else if ( strategy == STRATEGY_STATIC_RR ) {
+            // Our rows (or tiles) are ID-1, ID-1+num_processes, ...
+            int rr_items = (ID-1 < layout->num_tiles) ? (layout->num_tiles - (ID-1) + num_processes - 1) / num_processes : 0;
+            workTiles(sender, pbm_file, layout, row_data, ID-1, num_processes, rr_items, scale_real, scale_imag, iters, real_min, imag_min);
+        } else if ( strategy == STRATEGY_DYNAMIC || strategy == STRATEGY_MARIANI_SILVER ) {
+            // Work until we have no more work to be done
+            while ( ((MPI_Recv(&cur_row, 1, MPI_INT, 0, MPI_ANY_TAG, MPI_COMM_WORLD, &mpi_status)) == MPI_SUCCESS) && (mpi_status.MPI_TAG == MSG_FROM_MASTER_WORK) ) {
+                if ( strategy == STRATEGY_MARIANI_SILVER ) {
+                    last_row = (height - cur_row < band_rows) ? height : cur_row + band_rows;
+                    computeMandleBlock(row_data, width, 0, cur_row, width, last_row - cur_row, scale_real, scale_imag, iters, height, real_min, imag_min);
+                    for (int i = cur_row; i < last_row; ++i) {
+                        sendTile(sender, pbm_file, row_data + (long long) (i - cur_row) * width, 0, i, width, 1);
+                    }
+                } else {
+                    workTiles(sender, pbm_file, layout, row_data, cur_row, 1, 1, scale_real, scale_imag, iters, real_min, imag_min);
+                }
+            }
+        } else if ( strategy == STRATEGY_PROGRESSIVE ) {
+            // Work items are the rows and columns of samples of the levels, the master hands out the coarse levels first
+            PROGRESSIVE* progressive = progressiveCreate(width, height, false);
+            while ( ((MPI_Recv(&cur_row, 1, MPI_INT, 0, MPI_ANY_TAG, MPI_COMM_WORLD, &mpi_status)) == MPI_SUCCESS) && (mpi_status.MPI_TAG == MSG_FROM_MASTER_WORK) ) {
+                int num_samples = computeProgressiveItem(progressive, cur_row, row_data, scale_real, scale_imag, iters, real_min, imag_min);
+                rowSenderSendTile(sender, row_data, 0, cur_row, num_samples, 1);
+            }
+            progressiveFree(progressive);
+        } else if ( strategy == STRATEGY_RMA ) {
+            // Claim chunks of rows (or tiles) by atomically advancing the counter held by the master, the master
+            // itself never takes part in the scheduling and just collects the rows
+            MPI_Win_create(NULL, 0, sizeof(int), MPI_INFO_NULL, MPI_COMM_WORLD, &counter_win);
+            MPI_Win_lock_all(0, counter_win);
+            while (true) {
+                MPI_Fetch_and_op(&chunk_rows, &cur_row, MPI_INT, 0, 0, MPI_SUM, counter_win);
+                MPI_Win_flush(0, counter_win);
+                if (cur_row >= layout->num_tiles)
+                    break;
+
+                last_row = (layout->num_tiles - cur_row < chunk_rows) ? layout->num_tiles : cur_row + chunk_rows;
+                workTiles(sender, pbm_file, layout, row_data, cur_row, 1, last_row - cur_row, scale_real, scale_imag, iters, real_min, imag_min);
+            }
+            MPI_Win_unlock_all(counter_win);
+            MPI_Win_free(&counter_win);
         }
     }
 
     LOG("Worker: %d - Finished\n", ID);
 
-    free(send_msg);
+    rowSenderDestroy(sender);
+#if WITH_MPIIO
+    pbmMpiClose(pbm_file);
+#endif
+    free(row_data);
 }
@@ -33,9 +33,37 @@
 /** STD includes */
 #include <stdio.h>
 #include <stdlib.h>
+#include <math.h>
  
 /** Our own includes */
 #include "mandle_utils.h"
+#include "mandle_msg.h"
+#include "mandle_pbm.h"
+#include "mandle_ms.h"
+#include "mandle_tiles.h"
+#include "mandle_counts.h"
+#include "mandle_perturb.h"
+#include "mandle_precision.h"
+#include "mandle_progressive.h"
+#include "mandle_cache.h"
+
+/** Workers write their rows straight into the PBM file with MPI-IO, rank 0 only writes the header */
+#ifndef WITH_MPIIO
+	#define WITH_MPIIO 0
+#endif
+
+#if WITH_MPIIO && !WITH_PBM
+	#error "WITH_MPIIO writes the PBM file, it requires WITH_PBM"
+#endif
+#if WITH_MPIIO && WITH_X11
+	#error "WITH_MPIIO does not send the pixels to the master, it can not be combined with WITH_X11"
+#endif
+#if WITH_STREAM && (!WITH_PBM || WITH_MPIIO || WITH_X11)
+	#error "WITH_STREAM maps the image file of the master, it requires WITH_PBM and can not be combined with WITH_MPIIO or WITH_X11"
+#endif
+#if WITH_COUNTS && (WITH_MPIIO || WITH_X11)
+	#error "WITH_COUNTS writes a PGM/PPM image from the master, it can not be combined with WITH_MPIIO or WITH_X11"
+#endif
 
 /** Message id's used to send to the workers and what the workers send the master */
 #define MSG_FROM_MASTER 		1
@@ -49,6 +77,44 @@
 #define STRATEGY_STATIC		0
 #define STRATEGY_STATIC_RR	1
 #define STRATEGY_DYNAMIC	2
+#define STRATEGY_MARIANI_SILVER	3
+#define STRATEGY_RMA		4
+#define STRATEGY_STATIC_GATHER	5
+#define STRATEGY_STATIC_COST	6
+#define STRATEGY_PROGRESSIVE	7
+
+/** Rows the static strategies compute at once before sending them, the OpenMP team shares the tiles of all of them */
+#ifndef WORKER_BAND_ROWS
+	#define WORKER_BAND_ROWS	16
+#endif
+
+/** Rows per work item handed out by the Mariani-Silver strategy */
+#ifndef MS_BAND_ROWS
+	#define MS_BAND_ROWS	32
+#endif
+
+/** Rows a worker claims per atomic fetch of the shared row counter in the RMA strategy */
+#ifndef RMA_CHUNK_ROWS
+	#define RMA_CHUNK_ROWS	4
+#endif
+
+/** Rows each worker contributes per MPI_Gatherv round of the gather strategy, bounds the master's buffer */
+#ifndef GATHER_CHUNK_ROWS
+	#define GATHER_CHUNK_ROWS	64
+#endif
+
+/** Preview used by the cost model strategy, COST_PREVIEW_SIZE x COST_PREVIEW_SIZE points (more rows for many workers) with COST_PREVIEW_ITERS iterations */
+#ifndef COST_PREVIEW_SIZE
+	#define COST_PREVIEW_SIZE	128
+#endif
+#ifndef COST_PREVIEW_ITERS
+	#define COST_PREVIEW_ITERS	64
+#endif
+
+/** Work items the dynamic strategies keep queued at each worker, so a worker never waits for the master between items */
+#ifndef DYNAMIC_PREFETCH
+	#define DYNAMIC_PREFETCH	2
+#endif
 
 /**
  * The strategy name, used for the CSV and the window name in case of a X11 enabled build 
@@ -57,12 +123,13 @@ const char* get_strategy_name(int strategy);
 
 /**
  * The master process, will distribute the work to the worker processes and wait for them to finish.
+ * With a tile cache the dynamic strategy only hands out the tiles the cache does not have.
  */
-void master_proc(int strategy, int num_processes, int width, int height, double real_min, double real_max, double imag_min, double imag_max, int iters);
+void master_proc(int strategy, int num_processes, const TILE_LAYOUT* layout, int width, int height, double real_min, double real_max, double imag_min, double imag_max, int iters, TILE_CACHE* cache);
 
 /**
  * The worker process, will process those rows that the master told him and send the result back.
  */
-void worker_proc(int strategy, int ID, int num_processes, int width, int height, double real_min, double real_max, double imag_min, double imag_max, int iters);
+void worker_proc(int strategy, int ID, int num_processes, const TILE_LAYOUT* layout, int width, int height, double real_min, double real_max, double imag_min, double imag_max, int iters);
 
 #endif // MANDLE_H
\ No newline at end of file
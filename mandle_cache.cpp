@@ -0,0 +1,231 @@
+/**
+ * Mandlebort implementation over MPI and OpenMP
+ *
+ * Copyright (c) 2012, Moritz Wundke
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the owner nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Moritz Wundke BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+/** STD includes */
+#include <math.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/** Our own includes */
+#include "mandle_cache.h"
+
+/** First bytes of every cache file, bump the version when the key changes */
+static const char CACHE_MAGIC[8] = { 'M', 'A', 'N', 'D', 'L', 'E', 'T', '1' };
+
+/**
+ * What a tile is stored under, all fields are set one by one on a zeroed key so the padding hashes alike
+ */
+typedef struct {
+    long long real;                 // Top left point in CACHE_SUBPIXELS of a pixel
+    long long imag;
+    double scale_real;
+    double scale_imag;
+    DD_REAL origin_real;
+    DD_REAL origin_imag;
+    unsigned long long center;
+    int num_cols;
+    int num_rows;
+    int iters;
+    int precision;
+    int point_bytes;
+    int renderer;
+    int periodicity;
+} TILE_KEY;
+
+/**
+ * Start of a cache file, the tile data follows
+ */
+typedef struct {
+    char magic[8];
+    TILE_KEY key;
+    long long size;
+} TILE_HEADER;
+
+/**
+ * FNV-1a hash of 'size' bytes, continuing from 'hash'
+ */
+unsigned long long cacheHash(unsigned long long hash, const void* data, long long size) {
+    const unsigned char* bytes = (const unsigned char*) data;
+    if ( hash == 0 )
+        hash = 0xcbf29ce484222325ULL;
+    for (long long i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+/**
+ * Build the key of a tile, false if its position does not fit the key
+ */
+static bool tileKey(const TILE_CACHE* cache, int col, int row, int num_cols, int num_rows, TILE_KEY* key) {
+    const CACHE_VIEW* view = &cache->view;
+    double real = view->real_min / view->scale_real * CACHE_SUBPIXELS;
+    double imag = view->imag_min / view->scale_imag * CACHE_SUBPIXELS;
+    if ( !(fabs(real) < 1e18) || !(fabs(imag) < 1e18) ) {
+        return false;
+    }
+
+    memset(key, 0, sizeof(*key));
+    key->real = llround(real) + (long long) col * CACHE_SUBPIXELS;
+    key->imag = llround(imag) + (long long) (view->height - 1 - row) * CACHE_SUBPIXELS;
+    key->scale_real = view->scale_real;
+    key->scale_imag = view->scale_imag;
+    key->origin_real = view->origin_real;
+    key->origin_imag = view->origin_imag;
+    key->center = view->center;
+    key->num_cols = num_cols;
+    key->num_rows = num_rows;
+    key->iters = view->iters;
+    key->precision = view->precision;
+    key->point_bytes = view->point_bytes;
+    key->renderer = view->renderer;
+    key->periodicity = WITH_PERIODICITY;
+    return true;
+}
+
+/**
+ * Name of the file of a key, the hash of the key in the cache directory
+ */
+static void tileFileName(const TILE_CACHE* cache, const TILE_KEY* key, char* name, int name_size) {
+    snprintf(name, name_size, "%s/%016llx.tile", cache->dir, cacheHash(0, key, sizeof(*key)));
+}
+
+/**
+ * Open the cache directory for the tiles of 'view'
+ */
+TILE_CACHE* tileCacheOpen(const CACHE_VIEW* view) {
+    const char* dir = getenv("MANDLE_CACHE");
+    if ( dir == NULL || dir[0] == '\0' )
+        dir = CACHE_DIR;
+    if ( mkdir(dir, 0755) != 0 && errno != EEXIST ) {
+        ERROR("Can not create the tile cache '%s': %s\n", dir, strerror(errno));
+        return NULL;
+    }
+
+    TILE_CACHE* cache = (TILE_CACHE*)calloc(1, sizeof(*cache));
+    cache->dir = strdup(dir);
+    cache->view = *view;
+    LOG("Tile cache in '%s'\n", cache->dir);
+    return cache;
+}
+
+/**
+ * Report the hits and misses and close the cache
+ */
+void tileCacheClose(TILE_CACHE* cache) {
+    if ( cache == NULL )
+        return;
+    LOG("Tile cache: %ld hits, %ld misses\n", cache->hits, cache->misses);
+    free(cache->dir);
+    free(cache);
+}
+
+/**
+ * Look up a tile, the file is mapped and its key compared in full so a hash collision is only a miss
+ */
+bool tileCacheLoad(TILE_CACHE* cache, int col, int row, int num_cols, int num_rows, void* data, long long size) {
+    TILE_KEY key;
+    char name[1024];
+    bool found = false;
+    if ( !tileKey(cache, col, row, num_cols, num_rows, &key) ) {
+        ++cache->misses;
+        return false;
+    }
+    tileFileName(cache, &key, name, sizeof(name));
+
+    int fd = open(name, O_RDONLY);
+    if ( fd >= 0 ) {
+        struct stat file_stat;
+        long long file_size = (long long) sizeof(TILE_HEADER) + size;
+        if ( fstat(fd, &file_stat) == 0 && file_stat.st_size == file_size ) {
+            void* mapping = mmap(NULL, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if ( mapping != MAP_FAILED ) {
+                const TILE_HEADER* header = (const TILE_HEADER*) mapping;
+                if ( memcmp(header->magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) == 0 && memcmp(&header->key, &key, sizeof(key)) == 0 && header->size == size ) {
+                    memcpy(data, (const char*) mapping + sizeof(TILE_HEADER), size);
+                    found = true;
+                }
+                munmap(mapping, file_size);
+            }
+        }
+        close(fd);
+    }
+
+    if ( found )
+        ++cache->hits;
+    else
+        ++cache->misses;
+    return found;
+}
+
+/**
+ * Add a tile to the cache. It is written through a mapping of a temporary file that is renamed
+ * once complete, so concurrent renders never see half a tile.
+ */
+void tileCacheStore(TILE_CACHE* cache, int col, int row, int num_cols, int num_rows, const void* data, long long size) {
+    TILE_KEY key;
+    char name[1024];
+    char temp_name[1100];
+    if ( !tileKey(cache, col, row, num_cols, num_rows, &key) ) {
+        return;
+    }
+    tileFileName(cache, &key, name, sizeof(name));
+    snprintf(temp_name, sizeof(temp_name), "%s.%d.tmp", name, (int) getpid());
+
+    int fd = open(temp_name, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if ( fd < 0 ) {
+        ERROR("Can not create cache file '%s': %s\n", temp_name, strerror(errno));
+        return;
+    }
+    long long file_size = (long long) sizeof(TILE_HEADER) + size;
+    bool written = false;
+    if ( ftruncate(fd, file_size) == 0 ) {
+        void* mapping = mmap(NULL, file_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if ( mapping != MAP_FAILED ) {
+            TILE_HEADER* header = (TILE_HEADER*) mapping;
+            memcpy(header->magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+            memcpy(&header->key, &key, sizeof(key));
+            header->size = size;
+            memcpy((char*) mapping + sizeof(TILE_HEADER), data, size);
+            written = (munmap(mapping, file_size) == 0);
+        }
+    }
+    close(fd);
+
+    if ( !written || rename(temp_name, name) != 0 ) {
+        ERROR("Can not write cache file '%s': %s\n", name, strerror(errno));
+        unlink(temp_name);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,116 @@
+/**
+ * Mandlebort implementation over MPI and OpenMP
+ *
+ * Copyright (c) 2012, Moritz Wundke
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the owner nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Moritz Wundke BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+#ifndef MANDLE_CACHE_H
+#define MANDLE_CACHE_H
+
+/** Our own includes */
+#include "mandle_utils.h"
+#include "mandle_precision.h"
+
+// Reuse tiles of earlier renders from an on-disk cache and add the new ones
+#ifndef WITH_CACHE
+	#define WITH_CACHE 0
+#endif
+
+/** Directory of the tile cache, MANDLE_CACHE overrides it at runtime */
+#ifndef CACHE_DIR
+	#define CACHE_DIR	"mandle_cache"
+#endif
+
+/**
+ * Fractions of a pixel the position of a tile is keyed by, tiles of views whose points are
+ * less than half of one apart are the same. Keeps the key independent of the rounding of the
+ * view bounds, so a pan by whole tiles finds the tiles it shares with the view before.
+ */
+#ifndef CACHE_SUBPIXELS
+	#define CACHE_SUBPIXELS	256
+#endif
+
+/** Renderers whose results are kept apart, the kernels do not round alike */
+#define CACHE_RENDERER_CPU	0
+#define CACHE_RENDERER_CL	1
+#define CACHE_RENDERER_CL_VEC	2
+
+/**
+ * Everything a tile depends on apart from its position and size. Point (col, row) of the view
+ * is real_min + col * scale_real, imag_min + (height-1-row) * scale_imag, offsets from the
+ * origin (double-double) or from the center (perturbation) for the deep precisions.
+ */
+typedef struct {
+    double real_min;
+    double imag_min;
+    double scale_real;
+    double scale_imag;
+    int height;
+    int iters;
+    int precision;
+    int point_bytes;                // 0 for packed 0/1 points, else bytes per escape count
+    int renderer;
+    DD_REAL origin_real;
+    DD_REAL origin_imag;
+    unsigned long long center;      // Hash of the decimal center of a perturbation render, 0 otherwise
+} CACHE_VIEW;
+
+typedef struct {
+    char* dir;
+    CACHE_VIEW view;
+    long hits;
+    long misses;
+} TILE_CACHE;
+
+/**
+ * FNV-1a hash of 'size' bytes, continuing from 'hash' (start with 0)
+ */
+unsigned long long cacheHash(unsigned long long hash, const void* data, long long size);
+
+/**
+ * Open the cache directory for the tiles of 'view', creating it if needed. The directory is
+ * MANDLE_CACHE if set, CACHE_DIR otherwise. Returns NULL if it can not be used.
+ */
+TILE_CACHE* tileCacheOpen(const CACHE_VIEW* view);
+
+/**
+ * Report the hits and misses and close the cache
+ */
+void tileCacheClose(TILE_CACHE* cache);
+
+/**
+ * Look up the 'num_cols' x 'num_rows' tile at column 'col' and row 'row' of the view. On a hit its
+ * 'size' bytes are copied to 'data' and true is returned.
+ */
+bool tileCacheLoad(TILE_CACHE* cache, int col, int row, int num_cols, int num_rows, void* data, long long size);
+
+/**
+ * Add a tile to the cache, the file only shows up once it is complete
+ */
+void tileCacheStore(TILE_CACHE* cache, int col, int row, int num_cols, int num_rows, const void* data, long long size);
+
+#endif // MANDLE_CACHE_H
\ No newline at end of file
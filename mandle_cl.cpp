@@ -32,7 +32,12 @@
 #include "mandle_cl.h"
 
 cl_mem AllocPixelBuffer(cl_context context, const size_t buffer_size, cl_int* errorn) {
+#if CL_ZERO_COPY
+    // Host visible memory, the host maps the band instead of copying it
+    return clCreateBuffer(context, CL_MEM_WRITE_ONLY | CL_MEM_ALLOC_HOST_PTR, buffer_size, NULL, errorn);
+#else
     return clCreateBuffer(context, CL_MEM_WRITE_ONLY, buffer_size, NULL, errorn);
+#endif
 }
 
 void FreePixelBuffer(cl_mem pixelBuffer) {
@@ -41,66 +46,15 @@ void FreePixelBuffer(cl_mem pixelBuffer) {
 }
 
 /**
- * Main entry point
+ * Set the arguments of mandel_kernel
  */
-int main (int argc, char *argv[]) {
-	int iterations;
-	int width = X_PIX;
-	int height = Y_PIX;
-    float scale = 3.5f;
-    float offsetX = -0.5f;
-    float offsetY = 0;
+void SetMandelKernelArgs(cl_kernel kern, cl_mem pixelBuffer, int width, int height, double scale, double offsetX, double offsetY, int iterations, bool useDouble) {
+    cl_int errorn;
 
-    // Sanity checks
-    if ( argc < 2 ) {
-        ERROR("Usage: %s iterations [sizeY sizeY scale offsetX offestY] %d\n", argv[0], argc);
-        exit(EXIT_FAILURE);
-    }
-
-    // Get data from commandline
-    iterations = atoi(argv[1]);
-    if (argc > 3) {
-         width = atof(argv[2]);
-         height = atof(argv[3]);
-    }
-    if (argc > 4) {
-        scale = atof(argv[4]);
-    }
-    if (argc > 5) {
-        offsetX = atof(argv[5]);
-        offsetY = atof(argv[6]);
-    }
-
-    // List of OpenCL specifc variables
-    cl_kernel kern;
-    cl_command_queue queue;
-    cl_context context;
-    cl_int errorn = 0;
-    cl_device_id* devices = NULL;
-    unsigned int workGroupSize = 1;
-
-    // Create the context
-    context = clu_create_context(CL_DEVICE_TYPE_ALL);
-
-    // Get devices
-    devices = clu_get_devices(context);
-
-    // Load kernel
-    kern = clu_load_kernel(context, "mandel_kernel.cl", "mandel_kernel", devices);
-
-    // Create our work group
-    queue = clu_create_command_queue(context, kern, devices, 0,&workGroupSize);
-
-    if(devices == NULL) {
-        ERROR("No valid OpenCL devices found. Sorry...\n");
-        return EXIT_FAILURE;
-    }
-
-    size_t mandleData_size = sizeof(char) * width * height;
-    cl_mem pixelBuffer = AllocPixelBuffer(context, mandleData_size, &errorn);
-    clu_check_error("Creating pixel buffer", errorn);
-
-    // Set kernel arguments
+    // The view goes in as the type the kernel was built with, see MANDEL_DOUBLE
+    cl_double viewDouble[3] = { scale, offsetX, offsetY };
+    cl_float viewFloat[3] = { (cl_float) scale, (cl_float) offsetX, (cl_float) offsetY };
+    size_t viewSize = useDouble ? sizeof(cl_double) : sizeof(cl_float);
     errorn = clSetKernelArg(
             kern,
             0,
@@ -125,22 +79,22 @@ int main (int argc, char *argv[]) {
     errorn = clSetKernelArg(
             kern,
             3,
-            sizeof(float),
-            (void *)&scale);
+            viewSize,
+            useDouble ? (void *)&viewDouble[0] : (void *)&viewFloat[0]);
     clu_check_error("setup_arguments scale", errorn);
 
     errorn = clSetKernelArg(
             kern,
             4,
-            sizeof(float),
-            (void *)&offsetX);
+            viewSize,
+            useDouble ? (void *)&viewDouble[1] : (void *)&viewFloat[1]);
     clu_check_error("setup_arguments offsetX", errorn);
 
     errorn = clSetKernelArg(
             kern,
             5,
-            sizeof(float),
-            (void *)&offsetY);
+            viewSize,
+            useDouble ? (void *)&viewDouble[2] : (void *)&viewFloat[2]);
     clu_check_error("setup_arguments offsetY", errorn);
 
     errorn = clSetKernelArg(
@@ -149,74 +103,614 @@ int main (int argc, char *argv[]) {
             sizeof(int),
             (void *)&iterations);
     clu_check_error("setup_arguments iters", errorn);
+}
 
-    // Start timer
-    double start = GetTime();
+/**
+ * Upload the reference orbit and set the arguments of mandel_perturb_kernel, returns the orbit buffer
+ */
+cl_mem SetPerturbKernelArgs(cl_context context, cl_kernel kern, cl_mem pixelBuffer, const REF_ORBIT* orbit, int width, int height, double radius, int iterations) {
+    cl_int errorn;
+
+    // The orbit goes to the device as real, imag pairs of the kernel's REAL type
+    CL_REAL* orbitData = (CL_REAL*) malloc(2 * orbit->length * sizeof(CL_REAL));
+    for (int k = 0; k < orbit->length; ++k) {
+        orbitData[2*k] = (CL_REAL) orbit->z_real[k];
+        orbitData[2*k+1] = (CL_REAL) orbit->z_imag[k];
+    }
+    cl_mem orbitBuffer = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, 2 * orbit->length * sizeof(CL_REAL), orbitData, &errorn);
+    clu_check_error("Creating orbit buffer", errorn);
+    free(orbitData);
+
+    // The pixels are offsets from the reference point in the center
+    CL_REAL scale = (CL_REAL) (2 * radius / height);
+    CL_REAL realMin = (CL_REAL) (-radius * width / height);
+    CL_REAL imagMin = (CL_REAL) -radius;
+    errorn  = clSetKernelArg(kern, 0, sizeof(cl_mem), (void *) &pixelBuffer);
+    errorn |= clSetKernelArg(kern, 1, sizeof(cl_mem), (void *) &orbitBuffer);
+    errorn |= clSetKernelArg(kern, 2, sizeof(int), (void *) &orbit->length);
+    errorn |= clSetKernelArg(kern, 3, sizeof(int), (void *) &width);
+    errorn |= clSetKernelArg(kern, 4, sizeof(int), (void *) &height);
+    errorn |= clSetKernelArg(kern, 5, sizeof(CL_REAL), (void *) &scale);
+    errorn |= clSetKernelArg(kern, 6, sizeof(CL_REAL), (void *) &realMin);
+    errorn |= clSetKernelArg(kern, 7, sizeof(CL_REAL), (void *) &imagMin);
+    errorn |= clSetKernelArg(kern, 8, sizeof(int), (void *) &iterations);
+    clu_check_error("setup_arguments perturbation", errorn);
+    return orbitBuffer;
+}
+
+/**
+ * The pixels per work item given by MANDLE_CL_VEC
+ */
+int ForcedVecWidth() {
+    const char* forced = getenv("MANDLE_CL_VEC");
+    if ( forced == NULL )
+        return 0;
+    int vecWidth = atoi(forced);
+    if ( vecWidth == 1 || vecWidth == 2 || vecWidth == 4 || vecWidth == 8 || vecWidth == 16 )
+        return vecWidth;
+    ERROR("Unknown MANDLE_CL_VEC '%s', expected 1, 2, 4, 8 or 16\n", forced);
+    return 0;
+}
+
+/**
+ * Pixels per work item, by the preferred vector width of the device. CPU runtimes map the lanes onto their
+ * SIMD registers, GPUs prefer scalars but still save the overhead of the work items with 4.
+ */
+static int PickVecWidth(cl_device_id device, bool useDouble) {
+    int vecWidth = ForcedVecWidth();
+    if ( vecWidth > 0 )
+        return vecWidth;
+    cl_uint preferred = 0;
+    cl_int errorn = clGetDeviceInfo(device, useDouble ? CL_DEVICE_PREFERRED_VECTOR_WIDTH_DOUBLE : CL_DEVICE_PREFERRED_VECTOR_WIDTH_FLOAT, sizeof(preferred), &preferred, NULL);
+    clu_check_error("Getting the preferred vector width", errorn, false);
+    return (preferred >= 8) ? 8 : 4;
+}
+
+/**
+ * Create the context, load the kernel for every device and allocate a queue and a pixel buffer for every slot
+ */
+CL_RENDERER* CreateRenderer(int width, int height, int band_rows, double scale, double offsetX, double offsetY, int iterations, bool* useDouble, int count_bytes, const REF_ORBIT* orbit, double radius) {
+    cl_int errorn = 0;
+    cl_device_id* devices = NULL;
+    cl_uint numDevices = 0;
+    CL_RENDERER* renderer = (CL_RENDERER*) malloc(sizeof(*renderer));
+    renderer->width = width;
+    renderer->band_rows = band_rows;
+    renderer->count_bytes = count_bytes;
+
+    // Create the context
+    renderer->context = clu_create_context(CL_DEVICE_TYPE_ALL);
+
+    // Get devices
+    devices = clu_get_devices(renderer->context, &numDevices);
+    if(devices == NULL || numDevices == 0) {
+        ERROR("No valid OpenCL devices found. Sorry...\n");
+        exit(EXIT_FAILURE);
+    }
+#if CL_NUMA_DEVICES
+    renderer->context = clu_split_numa_devices(renderer->context, &devices, &numDevices);
+#endif
+
+    // Every device renders bands, MANDLE_CL_DEVICES=n keeps the first n
+    const char* maxDevices = getenv("MANDLE_CL_DEVICES");
+    if ( maxDevices != NULL && atoi(maxDevices) > 0 && (cl_uint) atoi(maxDevices) < numDevices ) {
+        numDevices = atoi(maxDevices);
+    }
+    LOG("Rendering on %d OpenCL devices\n", numDevices);
+
+    // One program is built for all devices, the double kernels only build if every one of them has fp64
+    if ( *useDouble && !clu_devices_support_double(devices, numDevices) ) {
+        LOG("Not every OpenCL device supports double precision, iterating in float\n");
+        *useDouble = false;
+    }
+
+    // The deep zoom has its own kernel, the others run vectorized unless one pixel per work item is forced.
+    // The program is built once for all devices, the first one picks the vector width.
+    renderer->vecWidth = (orbit != NULL) ? 1 : PickVecWidth(devices[0], *useDouble);
+    const char* kernelName = (orbit != NULL) ? "mandel_perturb_kernel" : (renderer->vecWidth > 1) ? "mandel_vec_kernel" : "mandel_kernel";
+    LOG("OpenCL kernel '%s', %d pixels per work item\n", kernelName, renderer->vecWidth);
+
+    // Load kernel, in count mode the pixel buffer holds uchar or ushort escape counts
+    char options[192];
+#if WITH_COUNTS
+    snprintf(options, sizeof(options), "-DWITH_PERIODICITY=%d -DPERTURB_DOUBLE=%d -DMANDEL_DOUBLE=%d -DVEC_WIDTH=%d -DWITH_COUNTS=1 -DCOUNT_TYPE=%s", WITH_PERIODICITY, PERTURB_DOUBLE, *useDouble, (renderer->vecWidth > 1) ? renderer->vecWidth : 4, (count_bytes == 1) ? "uchar" : "ushort");
+#else
+    snprintf(options, sizeof(options), "-DWITH_PERIODICITY=%d -DPERTURB_DOUBLE=%d -DMANDEL_DOUBLE=%d -DVEC_WIDTH=%d", WITH_PERIODICITY, PERTURB_DOUBLE, *useDouble, (renderer->vecWidth > 1) ? renderer->vecWidth : 4);
+#endif
+    renderer->kern = clu_load_kernel(renderer->context, "mandel_kernel.cl", kernelName, devices, options, numDevices);
+
+    // Every band in flight has its own in-order queue and pixel buffer, a device computes one band while
+    // another one is read back. A device holds CL_PIPELINE bands, whatever the size of the image.
+    renderer->numDevices = numDevices;
+    renderer->numSlots = numDevices * CL_PIPELINE;
+    renderer->queues = (cl_command_queue*) malloc(renderer->numSlots * sizeof(cl_command_queue));
+    renderer->pixelBuffers = (cl_mem*) malloc(renderer->numSlots * sizeof(cl_mem));
+    renderer->hostBuffers = (char**) calloc(renderer->numSlots, sizeof(char*));
+    renderer->readEvents = (cl_event*) calloc(renderer->numSlots, sizeof(cl_event));
+    renderer->bandData = (char**) calloc(renderer->numSlots, sizeof(char*));
+    renderer->bandPoints = (long long*) calloc(renderer->numSlots, sizeof(long long));
+    renderer->workGroupSizes = (unsigned int*) malloc(numDevices * sizeof(unsigned int));
+    renderer->deviceBands = (int*) calloc(numDevices, sizeof(int));
+    renderer->devicePoints = (long long*) calloc(numDevices, sizeof(long long));
+    renderer->deviceStart = (double*) calloc(numDevices, sizeof(double));
+    for (int slot = 0; slot < renderer->numSlots; ++slot) {
+        int device = slot / CL_PIPELINE;
+        renderer->queues[slot] = clu_create_command_queue(renderer->context, renderer->kern, devices, device, &renderer->workGroupSizes[device]);
+        renderer->pixelBuffers[slot] = AllocPixelBuffer(renderer->context, (size_t) count_bytes * width * band_rows, &errorn);
+        clu_check_error("Creating pixel buffer", errorn);
+    }
+    free(devices);
+
+    renderer->orbitBuffer = NULL;
+    if ( orbit != NULL ) {
+        renderer->orbitBuffer = SetPerturbKernelArgs(renderer->context, renderer->kern, renderer->pixelBuffers[0], orbit, width, height, radius, iterations);
+        renderer->rowArg = 9;
+    } else {
+        SetMandelKernelArgs(renderer->kern, renderer->pixelBuffers[0], width, height, scale, offsetX, offsetY, iterations, *useDouble);
+        renderer->rowArg = 7;
+    }
+    return renderer;
+}
+
+/**
+ * Whether a device finished points to measure its throughput by
+ */
+static bool DeviceMeasured(CL_RENDERER* renderer, int device, double now) {
+    return renderer->devicePoints[device] > 0 && now > renderer->deviceStart[device];
+}
+
+/**
+ * Seconds a measured device needs for the bands it has and one more by its throughput so far
+ */
+static double DeviceEstimate(CL_RENDERER* renderer, int device, double now) {
+    double pointsPerSecond = renderer->devicePoints[device] / (now - renderer->deviceStart[device]);
+    return (renderer->deviceBands[device] + 1) * (double) renderer->width * renderer->band_rows / pointsPerSecond;
+}
+
+/**
+ * Pick the device for the next band and one of its free slots
+ */
+int PickSlot(CL_RENDERER* renderer, int bandsLeft) {
+    double now = GetTime();
+    bool lastBands = (bandsLeft <= renderer->numSlots);
+    // An unmeasured device may be the slowest, so the last bands only go to the measured ones while there are any
+    bool anyMeasured = false;
+    for (int device = 0; lastBands && device < renderer->numDevices; ++device)
+        anyMeasured = anyMeasured || DeviceMeasured(renderer, device, now);
+    int bestDevice = -1;
+    double bestKey = 0;
+    for (int device = 0; device < renderer->numDevices; ++device) {
+        // A full device can not take the band now, but for the last bands it may still be the one to wait for
+        if ( !lastBands && renderer->deviceBands[device] == CL_PIPELINE )
+            continue;
+        if ( anyMeasured && !DeviceMeasured(renderer, device, now) )
+            continue;
+        double key = anyMeasured ? DeviceEstimate(renderer, device, now) : renderer->deviceBands[device];
+        if ( bestDevice < 0 || key < bestKey ) {
+            bestDevice = device;
+            bestKey = key;
+        }
+    }
+    if ( bestDevice < 0 )
+        return -1;
+    for (int slot = bestDevice * CL_PIPELINE; slot < (bestDevice + 1) * CL_PIPELINE; ++slot) {
+        if ( renderer->bandData[slot] == NULL )
+            return slot;
+    }
+    return -1;
+}
+
+/**
+ * Enqueue the kernel of a band and its readback, or its mapping with CL_ZERO_COPY, on the queue of 'slot'
+ */
+void EnqueueBand(CL_RENDERER* renderer, int slot, char* bandData, int firstRow, int numRows) {
+    cl_int errorn;
+    cl_command_queue queue = renderer->queues[slot];
+    int device = slot / CL_PIPELINE;
+    size_t bandSize = (size_t) renderer->count_bytes * renderer->width * numRows;
+
+    if ( renderer->deviceStart[device] == 0 ) {
+        renderer->deviceStart[device] = GetTime();
+    }
+    ++renderer->deviceBands[device];
+    renderer->bandPoints[slot] = (long long) renderer->width * numRows;
+
+    // The arguments are copied at enqueue time, so the kernel is shared by all slots
+    errorn  = clSetKernelArg(renderer->kern, 0, sizeof(cl_mem), (void *) &renderer->pixelBuffers[slot]);
+    errorn |= clSetKernelArg(renderer->kern, renderer->rowArg, sizeof(int), (void *) &firstRow);
+    errorn |= clSetKernelArg(renderer->kern, renderer->rowArg + 1, sizeof(int), (void *) &numRows);
+    clu_check_error("setup_arguments band", errorn);
 
     // Enqueue a kernel run call
-    cl_event events[2];
-    size_t globalThreads[1];
-    globalThreads[0] = width * height + 1;
-    if (globalThreads[0] % workGroupSize != 0) {
-        globalThreads[0] = (globalThreads[0] / workGroupSize + 1) * workGroupSize;
+    cl_event kernelEvent;
+    if ( renderer->vecWidth > 1 ) {
+        // A work item per 'vecWidth' pixels of a row and one row of work items per row, the runtime picks the work groups
+        size_t globalThreads[2];
+        globalThreads[0] = (renderer->width + renderer->vecWidth - 1) / renderer->vecWidth;
+        globalThreads[1] = numRows;
+
+        errorn = clEnqueueNDRangeKernel(
+                queue,
+                renderer->kern,
+                2,
+                NULL,
+                globalThreads,
+                NULL,
+                0,
+                NULL,
+                &kernelEvent);
+    } else {
+        unsigned int workGroupSize = renderer->workGroupSizes[device];
+        size_t globalThreads[1];
+        globalThreads[0] = (size_t) renderer->width * numRows;
+        if (globalThreads[0] % workGroupSize != 0) {
+            globalThreads[0] = (globalThreads[0] / workGroupSize + 1) * workGroupSize;
+        }
+        size_t localThreads[1];
+        localThreads[0] = workGroupSize;
+
+        errorn = clEnqueueNDRangeKernel(
+                queue,
+                renderer->kern,
+                1,
+                NULL,
+                globalThreads,
+                localThreads,
+                0,
+                NULL,
+                &kernelEvent);
     }
-    size_t localThreads[1];
-    localThreads[0] = workGroupSize;
+    clu_check_error("Failed to push queue", errorn);
 
-    errorn = clEnqueueNDRangeKernel(
+    // The readback waits for the kernel, the host waits for the readback in WaitBand
+#if CL_ZERO_COPY
+    renderer->bandData[slot] = (char*) clEnqueueMapBuffer(
             queue,
-            kern,
+            renderer->pixelBuffers[slot],
+            CL_FALSE,
+            CL_MAP_READ,
+            0,
+            bandSize,
             1,
-            NULL,
-            globalThreads,
-            localThreads,
+            &kernelEvent,
+            &renderer->readEvents[slot],
+            &errorn);
+    clu_check_error("Failed to map computation result", errorn);
+#else
+    if ( bandData == NULL ) {
+        if ( renderer->hostBuffers[slot] == NULL ) {
+            renderer->hostBuffers[slot] = (char*) malloc((size_t) renderer->count_bytes * renderer->width * renderer->band_rows);
+        }
+        bandData = renderer->hostBuffers[slot];
+    }
+    errorn = clEnqueueReadBuffer(
+            queue,
+            renderer->pixelBuffers[slot],
+            CL_FALSE,
             0,
-            NULL,
-            &events[0]);
-    clu_check_error("Failed to push queue", errorn);
+            bandSize,
+            bandData,
+            1,
+            &kernelEvent,
+            &renderer->readEvents[slot]);
+    clu_check_error("Failed to read computation result", errorn);
+    renderer->bandData[slot] = bandData;
+#endif
+    clReleaseEvent(kernelEvent);
+
+    // Start the device on the band now, not when the host waits for it
+    clFlush(queue);
+}
 
-    // Wait for the kernel call to finish execution
-    errorn = clWaitForEvents(1, &events[0]);
+/**
+ * Wait for any band in flight. OpenCL only waits for all of several events, so with more than one band
+ * in flight their state is polled.
+ */
+int WaitBand(CL_RENDERER* renderer) {
+    for (;;) {
+        int waiting = 0;
+        int last = -1;
+        for (int slot = 0; slot < renderer->numSlots; ++slot) {
+            if ( renderer->readEvents[slot] == NULL )
+                continue;
+            cl_int status = CL_COMPLETE;
+            clGetEventInfo(renderer->readEvents[slot], CL_EVENT_COMMAND_EXECUTION_STATUS, sizeof(status), &status, NULL);
+            if ( status <= CL_COMPLETE )
+                return slot;
+            ++waiting;
+            last = slot;
+        }
+        if ( waiting == 0 )
+            return -1;
+        if ( waiting == 1 ) {
+            clWaitForEvents(1, &renderer->readEvents[last]);
+            return last;
+        }
+        usleep(100);
+    }
+}
+
+/**
+ * Returns the points of the finished band and accounts them to its device
+ */
+char* FinishBand(CL_RENDERER* renderer, int slot) {
+    cl_int errorn = clWaitForEvents(1, &renderer->readEvents[slot]);
     clu_check_error("CFailed to wait for work to be finished", errorn);
+    clReleaseEvent(renderer->readEvents[slot]);
+    renderer->readEvents[slot] = NULL;
+    renderer->devicePoints[slot / CL_PIPELINE] += renderer->bandPoints[slot];
+    return renderer->bandData[slot];
+}
+
+/**
+ * Hand the pixel buffer of 'slot' back to the device once the host is done with its points
+ */
+void ReleaseBand(CL_RENDERER* renderer, int slot) {
+#if CL_ZERO_COPY
+    // Queued in order before the next kernel of the slot, which writes the buffer again
+    cl_int errorn = clEnqueueUnmapMemObject(renderer->queues[slot], renderer->pixelBuffers[slot], renderer->bandData[slot], 0, NULL, NULL);
+    clu_check_error("Failed to unmap computation result", errorn);
+#endif
+    renderer->bandData[slot] = NULL;
+    --renderer->deviceBands[slot / CL_PIPELINE];
+}
 
-    clReleaseEvent(events[0]);
+/**
+ * Free the pixel buffers and the device objects
+ */
+void FreeRenderer(CL_RENDERER* renderer) {
+    if ( renderer == NULL )
+        return;
+    for (int device = 0; device < renderer->numDevices; ++device) {
+        LOG("OpenCL Device %d: rendered %lld points\n", device, renderer->devicePoints[device]);
+    }
+    for (int slot = 0; slot < renderer->numSlots; ++slot) {
+        clFinish(renderer->queues[slot]);
+        FreePixelBuffer(renderer->pixelBuffers[slot]);
+        clReleaseCommandQueue(renderer->queues[slot]);
+        free(renderer->hostBuffers[slot]);
+    }
+    if ( renderer->orbitBuffer != NULL ) {
+        clReleaseMemObject(renderer->orbitBuffer);
+    }
+    clReleaseKernel(renderer->kern);
+    clReleaseContext(renderer->context);
+    free(renderer->deviceStart);
+    free(renderer->devicePoints);
+    free(renderer->deviceBands);
+    free(renderer->workGroupSizes);
+    free(renderer->bandPoints);
+    free(renderer->bandData);
+    free(renderer->readEvents);
+    free(renderer->hostBuffers);
+    free(renderer->pixelBuffers);
+    free(renderer->queues);
+    free(renderer);
+}
 
-    // Allocate the char buffer used to draw the mandlebrot into
-    char* mandleData = (char*) calloc(width * height, sizeof(char));
+/**
+ * Hand a finished band on, to the PBM file or as written part of the mapped count image. Either may be NULL.
+ */
+static void BandDone(PBM_WRITER* pbm, STREAM_FILE* countsFile, const char* bandData, int row, int rows, int width, int count_bytes) {
+    if ( countsFile != NULL ) {
+        streamWrote(countsFile, (long long) count_bytes * width * rows);
+    }
+    if ( pbm != NULL ) {
+        for (int i = 0; i < rows; ++i) {
+            pbmWriteRowData(pbm, row + i, bandData + (size_t) i * width);
+        }
+    }
+}
 
-    // Enqueue readBuffer
-    errorn = clEnqueueReadBuffer(
-            queue,
-            pixelBuffer,
-            CL_TRUE,
-            0,
-            width * height,
-            mandleData,
-            0,
-            NULL,
-            &events[1]);
-    clu_check_error("Failed to read computation result", errorn);
+/**
+ * Main entry point
+ */
+int main (int argc, char *argv[]) {
+	int iterations;
+	int width = X_PIX;
+	int height = Y_PIX;
+    double scale = 3.5;
+    double offsetX = -0.5;
+    double offsetY = 0;
+
+    // Sanity checks
+    if ( argc < 2 ) {
+        ERROR("Usage: %s iterations [sizeY sizeY scale offsetX offestY [centerReal centerImag radius]] %d\n", argv[0], argc);
+        exit(EXIT_FAILURE);
+    }
+
+    // Get data from commandline
+    iterations = atoi(argv[1]);
+    if (argc > 3) {
+         width = atof(argv[2]);
+         height = atof(argv[3]);
+    }
+    if (argc > 4) {
+        scale = atof(argv[4]);
+    }
+    if (argc > 5) {
+        offsetX = atof(argv[5]);
+        offsetY = atof(argv[6]);
+    }
+
+    // Deep zoom, the view is given by its center as decimal strings and the distance to the top edge
+    // instead of scale and offset. We iterate the reference orbit, the pixels only their offsets to it.
+    REF_ORBIT* orbit = NULL;
+    double radius = 0;
+    if (argc > 9) {
+        radius = atof(argv[9]);
+        orbit = refOrbitCreate(argv[7], argv[8], iterations);
+        if ( orbit == NULL ) {
+            exit(EXIT_FAILURE);
+        }
+    }
 
-    clReleaseEvent(events[1]);
+    // Float coordinates while they resolve the pixels, double after that. The deep zoom has its own kernel.
+    int precision = choosePrecision(fmin(scale / width, scale / height), fabs(offsetX) + fabs(offsetY) + scale, PRECISION_DOUBLE);
+    bool useDouble = (precision == PRECISION_DOUBLE);
+    LOG("Iterating in '%s'\n", getPrecisionName(precision));
 
-    double end = GetTime();
-    const double elapsedTime = end - start;
-    const double sampleSec = elapsedTime>0?height * width / elapsedTime:0;
+    // The image is rendered in bands of whole rows, only one band lives on the device
+#if WITH_COUNTS
+    const int count_bytes = countBytes(iterations);
+#else
+    const int count_bytes = 1;
+#endif
+    int band_rows = CL_BAND_PIXELS / width;
+    band_rows = (band_rows < 1) ? 1 : (band_rows > height) ? height : band_rows;
+
+    // The counts are equalized over the whole image, a gigapixel image collects them in a mapped temporary file.
+    // Without counts finished bands go straight into the PBM file, in place with WITH_STREAM.
+    PBM_WRITER* pbm = NULL;
+    STREAM_FILE* countsFile = NULL;
+#if WITH_COUNTS && WITH_STREAM
+    countsFile = streamOpen("out_cl.counts", "", (long long) count_bytes * width * height, true);
+    if ( countsFile == NULL ) {
+        exit(EXIT_FAILURE);
+    }
+    char* mandleData = (char*) streamData(countsFile);
+#elif WITH_COUNTS
+    char* mandleData = (char*) calloc((size_t) count_bytes * width * height, sizeof(char));
+#else
+    // Bands read from the cache arrive here, the devices read back into the host buffers of their slots
+    char* mandleData = (char*) malloc((size_t) width * band_rows);
+#if WITH_PBM && WITH_STREAM
+    pbm = pbmOpenMapped("out_cl.pbm", width, height);
+#elif WITH_PBM
+    pbm = pbmOpen("out_cl.pbm", width, height, 1);
+#endif
+#if WITH_PBM
+    if ( pbm == NULL ) {
+        exit(EXIT_FAILURE);
+    }
+#endif
+#endif
+
+#if WITH_CACHE
+    // Bands of a repeated render of the view are read from the tile cache instead, every band is one tile
+    CACHE_VIEW view;
+    memset(&view, 0, sizeof(view));
+    if ( orbit != NULL ) {
+        view.scale_real = view.scale_imag = 2 * radius / height;
+        view.real_min = -radius * width / height;
+        view.imag_min = -radius;
+        view.center = cacheHash(cacheHash(0, argv[7], strlen(argv[7])), argv[8], strlen(argv[8]));
+    } else {
+        view.scale_real = scale / width;
+        view.scale_imag = scale / height;
+        view.real_min = offsetX - scale / 2;
+        view.imag_min = offsetY - scale / 2;
+    }
+    view.height = height;
+    view.iters = iterations;
+    view.precision = (orbit != NULL) ? PRECISION_PERTURB : precision;
+    view.point_bytes = WITH_COUNTS ? count_bytes : 0;
+    view.renderer = (orbit != NULL || ForcedVecWidth() == 1) ? CACHE_RENDERER_CL : CACHE_RENDERER_CL_VEC;
+    TILE_CACHE* cache = tileCacheOpen(&view);
+#endif
+
+    // The devices are only set up once a band has to be rendered. Bands go to the devices as they have free
+    // slots, a device computes its next band while one is read back. Bands finish in any order.
+    CL_RENDERER* renderer = NULL;
+    int* slotRows = NULL;
+    int numBands = (height + band_rows - 1) / band_rows;
+    int nextBand = 0;
+    int bandsDone = 0;
+    double setupTime = 0;
+    double start = GetTime();
+#if WITH_CACHE
+    int checkedBand = -1;
+#endif
+    while ( bandsDone < numBands ) {
+        // Hand out bands while a device takes them, bands in the cache are done right away
+        while ( nextBand < numBands ) {
+            int row = nextBand * band_rows;
+            int rows = (height - row < band_rows) ? height - row : band_rows;
+            char* bandData = (WITH_COUNTS) ? mandleData + (size_t) count_bytes * width * row : mandleData;
+#if WITH_CACHE
+            if ( checkedBand != nextBand ) {
+                checkedBand = nextBand;
+                if ( cache != NULL && tileCacheLoad(cache, 0, row, width, rows, bandData, (size_t) count_bytes * width * rows) ) {
+                    BandDone(pbm, countsFile, bandData, row, rows, width, count_bytes);
+                    ++nextBand;
+                    ++bandsDone;
+                    continue;
+                }
+            }
+#endif
+            if ( renderer == NULL ) {
+                double setupStart = GetTime();
+                renderer = CreateRenderer(width, height, band_rows, scale, offsetX, offsetY, iterations, &useDouble, count_bytes, orbit, radius);
+                if ( precision == PRECISION_DOUBLE && !useDouble ) {
+                    precision = PRECISION_FLOAT;
+#if WITH_CACHE
+                    // The bands rendered from now on are float ones, they are cached as such
+                    if ( cache != NULL && orbit == NULL ) {
+                        cache->view.precision = precision;
+                    }
+#endif
+                }
+                slotRows = (int*) malloc(renderer->numSlots * sizeof(int));
+                setupTime = GetTime() - setupStart;
+            }
+            int slot = PickSlot(renderer, numBands - nextBand);
+            if ( slot < 0 )
+                break;
+            // Counts are read back straight into the count image
+            EnqueueBand(renderer, slot, (WITH_COUNTS) ? bandData : NULL, row, rows);
+            slotRows[slot] = row;
+            ++nextBand;
+        }
+
+        int slot = (renderer != NULL) ? WaitBand(renderer) : -1;
+        if ( slot < 0 )
+            continue;
+        int row = slotRows[slot];
+        int rows = (height - row < band_rows) ? height - row : band_rows;
+        char* bandData = FinishBand(renderer, slot);
+        if ( WITH_COUNTS && bandData != mandleData + (size_t) count_bytes * width * row ) {
+            // The counts are needed after the band, copy them out of the mapped buffer
+            memcpy(mandleData + (size_t) count_bytes * width * row, bandData, (size_t) count_bytes * width * rows);
+        }
+#if WITH_CACHE
+        if ( cache != NULL ) {
+            tileCacheStore(cache, 0, row, width, rows, bandData, (size_t) count_bytes * width * rows);
+        }
+#endif
+        BandDone(pbm, countsFile, bandData, row, rows, width, count_bytes);
+        ReleaseBand(renderer, slot);
+        ++bandsDone;
+    }
+    // Compile and device setup are not part of the render
+    const double elapsedTime = GetTime() - start - setupTime;
+    FreeRenderer(renderer);
+    free(slotRows);
+#if WITH_CACHE
+    tileCacheClose(cache);
+#endif
+    const double sampleSec = elapsedTime>0?(double) height * width / elapsedTime:0;
 
     // Create file
     FILE* output;
     output = fopen ( "output_cl.csv" , "a+" );
-    fprintf(output, "%g,%g,%d\n", elapsedTime, sampleSec / 1000.f,(width*height));
+    fprintf(output, "%g,%g,%lld\n", elapsedTime, sampleSec / 1000.f,(long long) width * height);
     fclose (output);
 
-    // Free pixel buffer
-    FreePixelBuffer(pixelBuffer);
+    refOrbitFree(orbit);
 
-    // Write PBM file
-#if WITH_PBM
-    createPBMFile("out_cl.pbm", mandleData, width, height);
+    // Write the shaded image of the counts, or close the PBM file the bands went to
+#if WITH_PBM && WITH_COUNTS && COUNT_PALETTE
+    createPPMFile("out_cl.ppm", (unsigned char*) mandleData, count_bytes, width, height, iterations);
+#elif WITH_PBM && WITH_COUNTS
+    createPGMFile("out_cl.pgm", (unsigned char*) mandleData, count_bytes, width, height, iterations);
+#elif WITH_PBM
+    pbmClose(pbm);
 #endif
+#if WITH_COUNTS && WITH_STREAM
+    streamClose(countsFile);
+#else
     free(mandleData);
-    
+#endif
+
     return EXIT_SUCCESS;
 }
\ No newline at end of file
@@ -30,9 +30,84 @@
 #ifndef MANDLE_CL_H
 #define MANDLE_CL_H
  
+/** STD includes */
+#include <math.h>
+#include <string.h>
+#include <unistd.h>
+
 /** Our own includes */
 #include "mandle_cl_utils.h"
 #include "mandle_utils.h"
+#include "mandle_pbm.h"
+#include "mandle_counts.h"
+#include "mandle_perturb.h"
+#include "mandle_precision.h"
+#include "mandle_cache.h"
+
+// The deep zoom kernel iterates doubles instead of floats, the device needs cl_khr_fp64
+#ifndef PERTURB_DOUBLE
+	#define PERTURB_DOUBLE 0
+#endif
+
+#if PERTURB_DOUBLE
+	typedef cl_double CL_REAL;
+#else
+	typedef cl_float CL_REAL;
+#endif
+
+#if WITH_STREAM && !WITH_PBM
+	#error "WITH_STREAM maps the image file, it requires WITH_PBM"
+#endif
+
+/** Points the device renders at once, the pixel buffer holds a band of as many whole rows as fit */
+#ifndef CL_BAND_PIXELS
+	#define CL_BAND_PIXELS	(1 << 24)
+#endif
+
+/** Bands in flight per device, each on its own in-order queue, the device computes the next band while one is read back */
+#ifndef CL_PIPELINE
+	#define CL_PIPELINE	2
+#endif
+
+/** Map the pixel buffers, allocated in host visible memory, instead of reading them into host buffers */
+#ifndef CL_ZERO_COPY
+	#define CL_ZERO_COPY	0
+#endif
+
+/** Run every NUMA domain of a CPU device as a device of its own (clCreateSubDevices) */
+#ifndef CL_NUMA_DEVICES
+	#define CL_NUMA_DEVICES	0
+#endif
+
+/**
+ * The device side of a render, the kernel with its arguments and the pixel buffers of the bands in flight.
+ * Every device of the context has CL_PIPELINE slots, slot s belongs to device s / CL_PIPELINE.
+ */
+typedef struct {
+    cl_context context;
+    cl_kernel kern;
+    int numDevices;
+    int numSlots;
+    cl_command_queue* queues;       // One in-order queue per slot
+    cl_mem* pixelBuffers;           // One band of 'band_rows' rows per slot
+    char** hostBuffers;             // Host buffer of the slot for bands without a place of their own, allocated on use
+    cl_event* readEvents;           // Readback or mapping of the band in the slot, NULL while the slot is free
+    char** bandData;                // Where the points of the band in the slot arrive
+    long long* bandPoints;          // Points of the band in the slot
+    unsigned int* workGroupSizes;   // Per device
+    int* deviceBands;               // Bands in flight per device
+    long long* devicePoints;        // Points a device finished
+    double* deviceStart;            // When a device got its first band, 0 before
+    cl_mem orbitBuffer;             // Reference orbit of the deep zoom, NULL otherwise
+    int width;
+    int band_rows;
+    int count_bytes;
+    int vecWidth;                   // Pixels per work item of mandel_vec_kernel on a 2D range, 1 for the 1D kernels
+    int rowArg;                     // Index of the firstRow kernel argument, numRows follows it
+} CL_RENDERER;
+
+/** Pixels per work item forced with MANDLE_CL_VEC=1|2|4|8|16, 0 to pick them from the device. 1 runs mandel_kernel. */
+int ForcedVecWidth();
 
 /** Allocate the pixel buffer used to write the mandle into */
 cl_mem AllocPixelBuffer(cl_context context, const size_t buffer_size, cl_int* errorn);
@@ -40,4 +115,38 @@ cl_mem AllocPixelBuffer(cl_context context, const size_t buffer_size, cl_int* er
 /** Free the pixel buffer */
 void FreePixelBuffer(cl_mem pixelBuffer);
 
+/** Set the arguments of the mandel_kernel, built with MANDEL_DOUBLE set to 'useDouble' */
+void SetMandelKernelArgs(cl_kernel kern, cl_mem pixelBuffer, int width, int height, double scale, double offsetX, double offsetY, int iterations, bool useDouble);
+
+/**
+ * Set up the devices to render the image in bands of up to 'band_rows' rows, with 'orbit' by perturbation.
+ * 'useDouble' is cleared if not every device supports double precision, the kernels iterate in float then.
+ */
+CL_RENDERER* CreateRenderer(int width, int height, int band_rows, double scale, double offsetX, double offsetY, int iterations, bool* useDouble, int count_bytes, const REF_ORBIT* orbit, double radius);
+
+/**
+ * The free slot the next band should go to, -1 if no device should take it now. While more bands are left
+ * than there are slots every free slot takes one, so the devices take bands at the rate they finish them.
+ * The last bands only go to a device that is expected to finish them first by its measured throughput.
+ */
+int PickSlot(CL_RENDERER* renderer, int bandsLeft);
+
+/** Enqueue 'numRows' rows starting at 'firstRow' on the queue of 'slot', read back into 'bandData' (the host buffer of the slot if NULL) or mapped with CL_ZERO_COPY */
+void EnqueueBand(CL_RENDERER* renderer, int slot, char* bandData, int firstRow, int numRows);
+
+/** Wait until a band in flight is done, returns its slot or -1 if there is none */
+int WaitBand(CL_RENDERER* renderer);
+
+/** Returns the points of the finished band of 'slot' */
+char* FinishBand(CL_RENDERER* renderer, int slot);
+
+/** Done with the points of the band of 'slot', the slot takes the next band */
+void ReleaseBand(CL_RENDERER* renderer, int slot);
+
+/** Release the device objects of the renderer */
+void FreeRenderer(CL_RENDERER* renderer);
+
+/** Upload the reference orbit and set the arguments of the mandel_perturb_kernel, returns the orbit buffer */
+cl_mem SetPerturbKernelArgs(cl_context context, cl_kernel kern, cl_mem pixelBuffer, const REF_ORBIT* orbit, int width, int height, double radius, int iterations);
+
 #endif // MANDLE_CL_H
\ No newline at end of file
@@ -28,9 +28,19 @@
  * 
  */
 
+/** STD includes */
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
 /** Our main header */
 #include "mandle_cl_utils.h"
 #include "mandle_utils.h"
+#include "mandle_cache.h"
+
+/** Magic of a cached program file, followed by the number of devices, the size of each binary and the binaries */
+#define BINARY_MAGIC "MCLBIN1"
 
 /**
  * Read a file and load into a char buffer
@@ -75,14 +85,166 @@ const char* clu_read_file(const char *filename) {
     return src;
 }
 
+#if CL_BINARY_CACHE
+/**
+ * Name of the cached program of 'source' built with 'options' for the devices, false if the cache directory can not be created
+ */
+static bool clu_binary_name(char* name, size_t name_size, const char* source, const char* options, cl_device_id *devices, cl_uint num_devices) {
+    const char* dir = getenv("MANDLE_CACHE");
+    if ( dir == NULL || dir[0] == '\0' )
+        dir = CACHE_DIR;
+    if ( mkdir(dir, 0755) != 0 && errno != EEXIST ) {
+        ERROR("Can not create the program cache '%s': %s\n", dir, strerror(errno));
+        return false;
+    }
+
+    unsigned long long hash = cacheHash(0, source, strlen(source) + 1);
+    if ( options != NULL ) {
+        hash = cacheHash(hash, options, strlen(options));
+    }
+    hash = cacheHash(hash, &num_devices, sizeof(num_devices));
+    const cl_device_info infos[3] = { CL_DEVICE_NAME, CL_DEVICE_VERSION, CL_DRIVER_VERSION };
+    for (cl_uint i = 0; i < num_devices; ++i) {
+        for (int k = 0; k < 3; ++k) {
+            char info[256] = "";
+            clGetDeviceInfo(devices[i], infos[k], sizeof(info) - 1, info, NULL);
+            hash = cacheHash(hash, info, strlen(info) + 1);
+        }
+    }
+    snprintf(name, name_size, "%s/%016llx.clbin", dir, hash);
+    return true;
+}
+
+/**
+ * Load and build the cached program, NULL if there is none or the runtime rejects it
+ */
+static cl_program clu_load_binary(cl_context context, const char* name, cl_device_id *devices, cl_uint num_devices, const char* options) {
+    FILE* file = fopen(name, "rb");
+    if ( file == NULL )
+        return NULL;
+
+    char magic[sizeof(BINARY_MAGIC)];
+    cl_uint count = 0;
+    size_t* sizes = (size_t*) calloc(num_devices, sizeof(size_t));
+    unsigned char** binaries = (unsigned char**) calloc(num_devices, sizeof(unsigned char*));
+    bool valid = fread(magic, 1, sizeof(magic), file) == sizeof(magic) && memcmp(magic, BINARY_MAGIC, sizeof(magic)) == 0
+              && fread(&count, sizeof(count), 1, file) == 1 && count == num_devices
+              && fread(sizes, sizeof(size_t), num_devices, file) == num_devices;
+    for (cl_uint i = 0; valid && i < num_devices; ++i) {
+        binaries[i] = sizes[i] > 0 ? (unsigned char*) malloc(sizes[i]) : NULL;
+        valid = binaries[i] != NULL && fread(binaries[i], 1, sizes[i], file) == sizes[i];
+    }
+    fclose(file);
+
+    cl_program program = NULL;
+    if ( valid ) {
+        cl_int errorn;
+        program = clCreateProgramWithBinary(context, num_devices, devices, sizes, (const unsigned char**) binaries, NULL, &errorn);
+        if ( errorn != CL_SUCCESS ) {
+            program = NULL;
+        } else if ( clBuildProgram(program, num_devices, devices, options, NULL, NULL) != CL_SUCCESS ) {
+            clReleaseProgram(program);
+            program = NULL;
+        }
+    }
+    if ( program == NULL ) {
+        LOG("Cached program '%s' can not be used, building from source\n", name);
+    } else {
+        LOG("Loaded cached program '%s'\n", name);
+    }
+    for (cl_uint i = 0; i < num_devices; ++i) {
+        free(binaries[i]);
+    }
+    free(binaries);
+    free(sizes);
+    return program;
+}
+
 /**
- * Load a kernel programm
+ * Store the binaries of a built program. It is written to a temporary file that is renamed once complete,
+ * so concurrent launches never load half a program.
  */
-cl_kernel clu_load_kernel(cl_context context, const char *filename, const char *kernelname, cl_device_id *devices) {
+static void clu_store_binary(cl_program program, const char* name, cl_device_id *devices, cl_uint num_devices) {
+    // The program has a binary for every device of the context, pick those of the devices it was built for
+    cl_uint programDevices = 0;
+    cl_int errorn = clGetProgramInfo(program, CL_PROGRAM_NUM_DEVICES, sizeof(programDevices), &programDevices, NULL);
+    if ( errorn != CL_SUCCESS || programDevices == 0 )
+        return;
+    cl_device_id* ids = (cl_device_id*) malloc(programDevices * sizeof(cl_device_id));
+    size_t* sizes = (size_t*) calloc(programDevices, sizeof(size_t));
+    unsigned char** binaries = (unsigned char**) calloc(programDevices, sizeof(unsigned char*));
+    errorn  = clGetProgramInfo(program, CL_PROGRAM_DEVICES, programDevices * sizeof(cl_device_id), ids, NULL);
+    errorn |= clGetProgramInfo(program, CL_PROGRAM_BINARY_SIZES, programDevices * sizeof(size_t), sizes, NULL);
+    for (cl_uint i = 0; i < programDevices; ++i) {
+        binaries[i] = (unsigned char*) malloc(sizes[i] > 0 ? sizes[i] : 1);
+    }
+    if ( errorn == CL_SUCCESS ) {
+        errorn = clGetProgramInfo(program, CL_PROGRAM_BINARIES, programDevices * sizeof(unsigned char*), binaries, NULL);
+    }
+
+    bool valid = (errorn == CL_SUCCESS);
+    cl_uint* index = (cl_uint*) malloc(num_devices * sizeof(cl_uint));
+    for (cl_uint i = 0; valid && i < num_devices; ++i) {
+        for (index[i] = 0; index[i] < programDevices && ids[index[i]] != devices[i]; ++index[i]) {}
+        valid = index[i] < programDevices && sizes[index[i]] > 0;
+    }
+
+    if ( valid ) {
+        char temp_name[1100];
+        snprintf(temp_name, sizeof(temp_name), "%s.%d.tmp", name, (int) getpid());
+        FILE* file = fopen(temp_name, "wb");
+        bool written = (file != NULL);
+        if ( written ) {
+            written = fwrite(BINARY_MAGIC, 1, sizeof(BINARY_MAGIC), file) == sizeof(BINARY_MAGIC)
+                   && fwrite(&num_devices, sizeof(num_devices), 1, file) == 1;
+            for (cl_uint i = 0; written && i < num_devices; ++i) {
+                written = fwrite(&sizes[index[i]], sizeof(size_t), 1, file) == 1;
+            }
+            for (cl_uint i = 0; written && i < num_devices; ++i) {
+                written = fwrite(binaries[index[i]], 1, sizes[index[i]], file) == sizes[index[i]];
+            }
+            written = (fclose(file) == 0) && written;
+        }
+        if ( !written || rename(temp_name, name) != 0 ) {
+            ERROR("Can not write cached program '%s': %s\n", name, strerror(errno));
+            unlink(temp_name);
+        }
+    }
+
+    free(index);
+    for (cl_uint i = 0; i < programDevices; ++i) {
+        free(binaries[i]);
+    }
+    free(binaries);
+    free(sizes);
+    free(ids);
+}
+#endif // CL_BINARY_CACHE
+
+/**
+ * Load a kernel programm, 'options' are passed to the OpenCL compiler. A program built before is loaded from the binary cache.
+ */
+cl_kernel clu_load_kernel(cl_context context, const char *filename, const char *kernelname, cl_device_id *devices, const char *options/*=NULL*/, cl_uint num_devices/*=1*/) {
     cl_int errorn;
-    // Create the kernel program
     const char *sources = clu_read_file(filename);
-    cl_program program = clCreateProgramWithSource(
+
+#if CL_BINARY_CACHE
+    // A program built before by the same runtime is loaded from its binaries, compiling can take longer than the render
+    char binaryName[1024];
+    bool cacheable = clu_binary_name(binaryName, sizeof(binaryName), sources, options, devices, num_devices);
+    cl_program program = cacheable ? clu_load_binary(context, binaryName, devices, num_devices, options) : NULL;
+    if ( program != NULL ) {
+        free((void*) sources);
+        cl_kernel kernel = clCreateKernel(program, kernelname, &errorn);
+        clu_check_error("Failed to create kernel", errorn);
+        return kernel;
+    }
+#else
+    cl_program program;
+#endif
+
+    // Create the kernel program
+    program = clCreateProgramWithSource(
             context,
             1,
             &sources,
@@ -90,7 +252,7 @@ cl_kernel clu_load_kernel(cl_context context, const char *filename, const char *
             &errorn);
     clu_check_error("clu_load_kernel-clCreateProgramWithSource", errorn);
 
-    errorn = clBuildProgram(program, 1, devices, NULL, NULL, NULL);
+    errorn = clBuildProgram(program, num_devices, devices, options, NULL, NULL);
     if (errorn != CL_SUCCESS) {
         clu_check_error("Failed to build kernel", errorn, false);
 
@@ -118,6 +280,13 @@ cl_kernel clu_load_kernel(cl_context context, const char *filename, const char *
         ERROR("OpenCL Programm Build Log:\n%s\n", buildLog);
         exit(EXIT_FAILURE);
     }
+    free((void*) sources);
+
+#if CL_BINARY_CACHE
+    if ( cacheable ) {
+        clu_store_binary(program, binaryName, devices, num_devices);
+    }
+#endif
 
     cl_kernel kernel = clCreateKernel(program, kernelname, &errorn);
     clu_check_error("Failed to create kernel", errorn);
@@ -180,7 +349,7 @@ cl_context clu_create_context(cl_device_type type) {
 /**
  * Get the devices available by the context
  */
-cl_device_id* clu_get_devices(cl_context context) {
+cl_device_id* clu_get_devices(cl_context context, cl_uint* num_devices/*=NULL*/) {
     // Get the size of device list data
     size_t deviceListSize;
     cl_int errorn = clGetContextInfo(
@@ -205,9 +374,88 @@ cl_device_id* clu_get_devices(cl_context context) {
             devices,
             NULL);
     clu_check_error("Failed to OpenCL context device list", errorn);
+    if (num_devices != NULL) {
+        *num_devices = (cl_uint) (deviceListSize / sizeof(cl_device_id));
+    }
     return devices;
 }
 
+/**
+ * Replace the CPU devices by their NUMA domains
+ */
+cl_context clu_split_numa_devices(cl_context context, cl_device_id** devices, cl_uint* num_devices) {
+    cl_device_id split[MAX_DEVICES];
+    cl_uint numSplit = 0;
+    bool splitAny = false;
+    for (cl_uint i = 0; i < *num_devices && numSplit < MAX_DEVICES; ++i) {
+        cl_device_type type = 0;
+        clGetDeviceInfo((*devices)[i], CL_DEVICE_TYPE, sizeof(type), &type, NULL);
+
+        cl_uint numSub = 0;
+        if (type & CL_DEVICE_TYPE_CPU) {
+            const cl_device_partition_property props[3] = {
+                CL_DEVICE_PARTITION_BY_AFFINITY_DOMAIN,
+                CL_DEVICE_AFFINITY_DOMAIN_NUMA,
+                0
+            };
+            if (clCreateSubDevices((*devices)[i], props, MAX_DEVICES - numSplit, split + numSplit, &numSub) != CL_SUCCESS) {
+                numSub = 0;
+            }
+        }
+        if (numSub > 1) {
+            LOG("OpenCL Device %d: split into %d NUMA domains\n", i, numSub);
+            numSplit += numSub;
+            splitAny = true;
+        } else {
+            if (numSub == 1) {
+                clReleaseDevice(split[numSplit]);
+            }
+            split[numSplit++] = (*devices)[i];
+        }
+    }
+    if (!splitAny) {
+        return context;
+    }
+
+    // The sub-devices get a context of their own on the platform of the devices
+    cl_platform_id platform;
+    cl_int errorn = clGetDeviceInfo(split[0], CL_DEVICE_PLATFORM, sizeof(platform), &platform, NULL);
+    clu_check_error("Failed to get the platform of the devices", errorn);
+    cl_context_properties cps[3] = {
+        CL_CONTEXT_PLATFORM,
+        (cl_context_properties) platform,
+        0
+    };
+    cl_context splitContext = clCreateContext(cps, numSplit, split, NULL, NULL, &errorn);
+    clu_check_error("Failed to create the context of the sub-devices", errorn);
+    clReleaseContext(context);
+
+    free(*devices);
+    *devices = (cl_device_id*) malloc(numSplit * sizeof(cl_device_id));
+    for (cl_uint i = 0; i < numSplit; ++i) {
+        (*devices)[i] = split[i];
+    }
+    *num_devices = numSplit;
+    return splitContext;
+}
+
+/**
+ * True if all devices support double precision. OpenCL 1.0 and 1.1 devices may not report a double FP config,
+ * for them the cl_khr_fp64 extension counts.
+ */
+bool clu_devices_support_double(cl_device_id *devices, cl_uint num_devices) {
+    for (cl_uint i = 0; i < num_devices; ++i) {
+        cl_device_fp_config config = 0;
+        if ( clGetDeviceInfo(devices[i], CL_DEVICE_DOUBLE_FP_CONFIG, sizeof(config), &config, NULL) == CL_SUCCESS && config != 0 )
+            continue;
+        char extensions[4096] = "";
+        clGetDeviceInfo(devices[i], CL_DEVICE_EXTENSIONS, sizeof(extensions) - 1, extensions, NULL);
+        if ( strstr(extensions, "cl_khr_fp64") == NULL )
+            return false;
+    }
+    return true;
+}
+
 /**
  * Create a command queue
  */
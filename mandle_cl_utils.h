@@ -37,15 +37,24 @@
 /** Maximum number of devices we are able to handle */
 #define MAX_DEVICES 16
 
+/**
+ * Keep the built kernel programs in the cache directory (MANDLE_CACHE or CACHE_DIR) and load them instead
+ * of compiling the source again. Keyed by the source, the build options and the name and driver of the devices.
+ */
+#ifndef CL_BINARY_CACHE
+	#define CL_BINARY_CACHE	1
+#endif
+
 /**
  * Read a file and load into a char buffer
  */
 const char* clu_read_file(const char *filename);
 
 /**
- * Load a kernel programm
+ * Load a kernel programm for the first 'num_devices' devices, 'options' are passed to the OpenCL compiler.
+ * With CL_BINARY_CACHE a program built before is loaded from its binaries instead.
  */
-cl_kernel clu_load_kernel(cl_context context, const char *filename, const char *kernelname, cl_device_id *devices);
+cl_kernel clu_load_kernel(cl_context context, const char *filename, const char *kernelname, cl_device_id *devices, const char *options=NULL, cl_uint num_devices=1);
 
 /**
  * Create a context and provide a list of available devices
@@ -53,9 +62,20 @@ cl_kernel clu_load_kernel(cl_context context, const char *filename, const char *
 cl_context clu_create_context(cl_device_type type);
 
 /**
- * Get the devices available by the context
+ * Get the devices available by the context, their number goes to 'num_devices'
+ */
+cl_device_id* clu_get_devices(cl_context context, cl_uint* num_devices=NULL);
+
+/**
+ * True if all of the first 'num_devices' devices support double precision (cl_khr_fp64)
+ */
+bool clu_devices_support_double(cl_device_id *devices, cl_uint num_devices);
+
+/**
+ * Split every CPU device into one sub-device per NUMA domain. The devices are replaced by the sub-devices
+ * and the context by one holding them, devices that can not be split are kept.
  */
-cl_device_id* clu_get_devices(cl_context context);
+cl_context clu_split_numa_devices(cl_context context, cl_device_id** devices, cl_uint* num_devices);
 
 /**
  * Create a command queue
@@ -0,0 +1,199 @@
+/**
+ * Mandlebort implementation over MPI and OpenMP
+ *
+ * Copyright (c) 2012, Moritz Wundke
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the owner nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Moritz Wundke BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+/** Our own includes */
+#include "mandle_counts.h"
+#include "mandle_simd.h"
+
+#include <string.h>
+
+/** Rows coloured and written at once by the PGM and PPM writers */
+#define COUNT_WRITE_ROWS	64
+
+/**
+ * Bytes per escape count, 1 while all counts up to 'iters' fit into a uint8 and 2 otherwise
+ */
+int countBytes(int iters) {
+    return (iters <= 0xFF) ? 1 : 2;
+}
+
+/**
+ * Compute the columns [first_col, first_col+num_cols) of 'num_rows' rows starting at 'first_row', 'row_step'
+ * rows apart, into consecutive rows of 'stride' counts of 'counts'
+ */
+static void computeMandleCountArea(unsigned char *counts, int count_bytes, int stride, int first_col, int num_cols, int first_row, int row_step, int num_rows, double scale_real, double scale_imag, int iters, int height, double real_min, double imag_min) {
+    // Same tiling and tasks as the 0/1 rows
+    MANDLE_COUNT_KERNEL kernel = getMandleCountKernel();
+    int tile_rows = (num_rows + OMP_TILE_ROWS - 1) / OMP_TILE_ROWS;
+    int tile_cols = (num_cols + OMP_TILE_COLS - 1) / OMP_TILE_COLS;
+    int num_tiles = tile_rows * tile_cols;
+
+#if WITH_OMP
+    #pragma omp taskloop num_tasks(ompNumTasks(num_tiles))
+#endif
+    for (int tile = 0; tile < num_tiles; ++tile) {
+        int tile_row = tile / tile_cols;
+        int col = (tile % tile_cols) * OMP_TILE_COLS;
+        int cols = (num_cols - col < OMP_TILE_COLS) ? num_cols - col : OMP_TILE_COLS;
+        int last = ((tile_row+1) * OMP_TILE_ROWS < num_rows) ? (tile_row+1) * OMP_TILE_ROWS : num_rows;
+        for (int i = tile_row * OMP_TILE_ROWS; i < last; ++i) {
+            kernel(counts + ((long long) i * stride + col) * count_bytes, count_bytes, first_col + col, cols, first_row + i * row_step, scale_real, scale_imag, iters, height, real_min, imag_min);
+        }
+    }
+}
+
+/**
+ * Compute 'num_rows' rows starting at 'first_row', 'row_step' rows apart, and store the escape
+ * count of each column in consecutive rows of 'width' counts of a pre allocated array
+ */
+void computeMandleCountRows(unsigned char *counts, int count_bytes, int width, int first_row, int row_step, int num_rows, double scale_real, double scale_imag, int iters, int height, double real_min, double imag_min) {
+    computeMandleCountArea(counts, count_bytes, width, 0, width, first_row, row_step, num_rows, scale_real, scale_imag, iters, height, real_min, imag_min);
+}
+
+/**
+ * Compute a tile of 'num_cols' x 'num_rows' points starting at (first_col, first_row) and store the
+ * escape count of each point in consecutive rows of 'num_cols' counts of a pre allocated array
+ */
+void computeMandleCountTile(unsigned char *counts, int count_bytes, int first_col, int first_row, int num_cols, int num_rows, double scale_real, double scale_imag, int iters, int height, double real_min, double imag_min) {
+    computeMandleCountArea(counts, count_bytes, num_cols, first_col, num_cols, first_row, 1, num_rows, scale_real, scale_imag, iters, height, real_min, imag_min);
+}
+
+/**
+ * Histogram equalization of 'num' counts, see mandle_counts.h
+ */
+void countLevels(unsigned char *levels, const unsigned char *counts, int count_bytes, long long num, int iters) {
+    const int max_count = (iters < COUNT_MAX) ? iters : COUNT_MAX;
+    long long* histogram = (long long*)calloc(max_count + 1, sizeof(*histogram));
+
+    // Every thread counts its part into a private histogram, they are summed up at the end
+#if WITH_OMP
+    #pragma omp parallel
+#endif
+    {
+        long long* local = (long long*)calloc(max_count + 1, sizeof(*local));
+#if WITH_OMP
+        #pragma omp for schedule(static)
+#endif
+        for (long long i = 0; i < num; ++i) {
+            ++local[getCount(counts, count_bytes, i)];
+        }
+#if WITH_OMP
+        #pragma omp critical
+#endif
+        for (int k = 0; k <= max_count; ++k) {
+            histogram[k] += local[k];
+        }
+        free(local);
+    }
+
+    // Map the cumulative distribution of the escaped points to the levels above 0
+    long long escaped = num - histogram[max_count];
+    long long sum = 0;
+    for (int k = 0; k < max_count; ++k) {
+        sum += histogram[k];
+        levels[k] = (escaped > 0) ? (unsigned char) (1 + ((COUNT_LEVELS - 2) * sum) / escaped) : 1;
+    }
+    levels[max_count] = 0;
+    free(histogram);
+}
+
+/**
+ * Palette of the PPM images, interpolated between a few control colours. Level 0 is black.
+ */
+static void countPalette(unsigned char *palette) {
+    static const double stops[] = { 0.0, 0.16, 0.42, 0.6425, 0.8575, 1.0 };
+    static const unsigned char colors[][3] = { {0, 7, 100}, {32, 107, 203}, {237, 255, 255}, {255, 170, 0}, {0, 2, 0}, {0, 7, 100} };
+    palette[0] = palette[1] = palette[2] = 0;
+    for (int level = 1; level < COUNT_LEVELS; ++level) {
+        double t = (double) (level - 1) / (double) (COUNT_LEVELS - 2);
+        int stop = 0;
+        while ( stop < 4 && t > stops[stop+1] ) {
+            ++stop;
+        }
+        double f = (t - stops[stop]) / (stops[stop+1] - stops[stop]);
+        for (int c = 0; c < 3; ++c) {
+            palette[level*3 + c] = (unsigned char) (colors[stop][c] + f * (colors[stop+1][c] - colors[stop][c]) + 0.5);
+        }
+    }
+}
+
+/**
+ * Write the counts as a binary PGM (channels 1) or PPM (channels 3), COUNT_WRITE_ROWS rows at a time
+ */
+static void createCountFile(const char* filename, const unsigned char *counts, int count_bytes, int width, int height, int iters, int channels) {
+    FILE* file = fopen(filename, "wb");
+    if ( file == NULL ) {
+        ERROR("Can not create '%s'\n", filename);
+        return;
+    }
+    const int max_count = (iters < COUNT_MAX) ? iters : COUNT_MAX;
+    unsigned char* levels = (unsigned char*)malloc(max_count + 1);
+    unsigned char* palette = (unsigned char*)malloc(COUNT_LEVELS * 3);
+    unsigned char* pixels = (unsigned char*)malloc((long long) width * COUNT_WRITE_ROWS * channels);
+    countLevels(levels, counts, count_bytes, (long long) width * height, iters);
+    countPalette(palette);
+
+    fprintf(file, "%s\n%d %d\n%d\n", (channels == 1) ? "P5" : "P6", width, height, COUNT_LEVELS - 1);
+    for (int row = 0; row < height; row += COUNT_WRITE_ROWS) {
+        long long num = (long long) width * ((height - row < COUNT_WRITE_ROWS) ? height - row : COUNT_WRITE_ROWS);
+        const unsigned char* block = counts + (long long) row * width * count_bytes;
+#if WITH_OMP
+        #pragma omp parallel for schedule(static)
+#endif
+        for (long long i = 0; i < num; ++i) {
+            unsigned char level = levels[getCount(block, count_bytes, i)];
+            if ( channels == 1 ) {
+                pixels[i] = level;
+            } else {
+                memcpy(pixels + i*3, palette + level*3, 3);
+            }
+        }
+        fwrite(pixels, channels, num, file);
+    }
+
+    free(pixels);
+    free(palette);
+    free(levels);
+    fclose(file);
+}
+
+/**
+ * Generate a binary PGM (P5) file, the counts are equalized to grey levels
+ */
+void createPGMFile(const char* filename, const unsigned char *counts, int count_bytes, int width, int height, int iters) {
+    createCountFile(filename, counts, count_bytes, width, height, iters, 1);
+}
+
+/**
+ * Generate a binary PPM (P6) file, the counts are equalized and coloured through a palette
+ */
+void createPPMFile(const char* filename, const unsigned char *counts, int count_bytes, int width, int height, int iters) {
+    createCountFile(filename, counts, count_bytes, width, height, iters, 3);
+}
\ No newline at end of file
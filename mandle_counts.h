@@ -0,0 +1,105 @@
+/**
+ * Mandlebort implementation over MPI and OpenMP
+ *
+ * Copyright (c) 2012, Moritz Wundke
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the owner nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Moritz Wundke BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+#ifndef MANDLE_COUNTS_H
+#define MANDLE_COUNTS_H
+
+/** Our own includes */
+#include "mandle_utils.h"
+
+/** Largest escape count a count buffer can hold, counts of 2 bytes saturate here */
+#define COUNT_MAX	0xFFFF
+
+/** Points per channel of the output, the count images are written with 8 bit channels */
+#define COUNT_LEVELS	256
+
+// Compute escape counts instead of 0/1 values and write a shaded image
+#ifndef WITH_COUNTS
+	#define WITH_COUNTS 0
+#endif
+
+// Write the count image as a colour PPM through a palette instead of a grey PGM
+#ifndef COUNT_PALETTE
+	#define COUNT_PALETTE 0
+#endif
+
+/**
+ * Bytes per escape count, 1 while all counts up to 'iters' fit into a uint8 and 2 otherwise
+ */
+int countBytes(int iters);
+
+/**
+ * Store a count in a buffer of 'count_bytes' wide counts
+ */
+static inline void setCount(unsigned char *counts, int count_bytes, long long i, long long count) {
+    if ( count_bytes == 1 ) {
+        counts[i] = (unsigned char) count;
+    } else {
+        ((unsigned short*) counts)[i] = (unsigned short) ((count < COUNT_MAX) ? count : COUNT_MAX);
+    }
+}
+
+/**
+ * Get a count from a buffer of 'count_bytes' wide counts
+ */
+static inline int getCount(const unsigned char *counts, int count_bytes, long long i) {
+    return (count_bytes == 1) ? counts[i] : ((const unsigned short*) counts)[i];
+}
+
+/**
+ * Compute 'num_rows' rows starting at 'first_row', 'row_step' rows apart, and store the escape
+ * count of each column in consecutive rows of 'width' counts of a pre allocated array
+ */
+void computeMandleCountRows(unsigned char *counts, int count_bytes, int width, int first_row, int row_step, int num_rows, double scale_real, double scale_imag, int iters, int height, double real_min, double imag_min);
+
+/**
+ * Compute a tile of 'num_cols' x 'num_rows' points starting at (first_col, first_row) and store the
+ * escape count of each point in consecutive rows of 'num_cols' counts of a pre allocated array
+ */
+void computeMandleCountTile(unsigned char *counts, int count_bytes, int first_col, int first_row, int num_cols, int num_rows, double scale_real, double scale_imag, int iters, int height, double real_min, double imag_min);
+
+/**
+ * Histogram equalization of 'num' counts: fill 'levels' (one entry per count up to
+ * min(iters, COUNT_MAX)) with a level in 1..COUNT_LEVELS-1 so that every level is used by
+ * about the same number of escaped points. Points that did not escape get level 0.
+ */
+void countLevels(unsigned char *levels, const unsigned char *counts, int count_bytes, long long num, int iters);
+
+/**
+ * Generate a binary PGM (P5) file, the counts are equalized to grey levels
+ */
+void createPGMFile(const char* filename, const unsigned char *counts, int count_bytes, int width, int height, int iters);
+
+/**
+ * Generate a binary PPM (P6) file, the counts are equalized and coloured through a palette
+ */
+void createPPMFile(const char* filename, const unsigned char *counts, int count_bytes, int width, int height, int iters);
+
+#endif // MANDLE_COUNTS_H
\ No newline at end of file
@@ -0,0 +1,184 @@
+/**
+ * Mandlebort implementation over MPI and OpenMP
+ *
+ * Copyright (c) 2012, Moritz Wundke
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the owner nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Moritz Wundke BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+/** Our own includes */
+#include "mandle_ms.h"
+#include "mandle_simd.h"
+
+#include <string.h>
+
+/**
+ * View parameters shared by the whole recursion
+ */
+typedef struct {
+    char *data;
+    int stride;
+    int first_col;
+    int first_row;
+    double scale_real;
+    double scale_imag;
+    int iters;
+    int height;
+    double real_min;
+    double imag_min;
+    MANDLE_ROW_KERNEL row_kernel;
+    MANDLE_COLUMN_KERNEL column_kernel;
+} MS_BLOCK;
+
+/** Pixel at block local coordinates (x, y) */
+#define MS_PIXEL(b, x, y)	((b)->data[(long long) (y) * (b)->stride + (x)])
+
+/**
+ * Compute 'len' points of local row y starting at local column x
+ */
+static void msComputeRow(const MS_BLOCK* b, int x, int y, int len) {
+    if ( len > 0 ) {
+        b->row_kernel(&MS_PIXEL(b, x, y), b->first_col + x, len, b->first_row + y, b->scale_real, b->scale_imag, b->iters, b->height, b->real_min, b->imag_min);
+    }
+}
+
+/**
+ * Compute 'len' points of local column x starting at local row y
+ */
+static void msComputeColumn(const MS_BLOCK* b, int x, int y, int len) {
+    if ( len > 0 ) {
+        b->column_kernel(&MS_PIXEL(b, x, y), b->stride, b->first_col + x, b->first_row + y, len, b->scale_real, b->scale_imag, b->iters, b->height, b->real_min, b->imag_min);
+    }
+}
+
+/**
+ * Check if every border pixel of the rectangle has the value of its top left corner
+ */
+static bool msUniformBorder(const MS_BLOCK* b, int x, int y, int w, int h) {
+    const char value = MS_PIXEL(b, x, y);
+    for (int i = x; i < x + w; ++i) {
+        if ( MS_PIXEL(b, i, y) != value || MS_PIXEL(b, i, y + h - 1) != value )
+            return false;
+    }
+    for (int i = y + 1; i < y + h - 1; ++i) {
+        if ( MS_PIXEL(b, x, i) != value || MS_PIXEL(b, x + w - 1, i) != value )
+            return false;
+    }
+    return true;
+}
+
+/**
+ * Check if the rectangle contains the origin. The set is connected and holds the origin,
+ * so a border that is all outside the set can only enclose points of the set if it
+ * encloses the origin as well.
+ */
+static bool msContainsOrigin(const MS_BLOCK* b, int x, int y, int w, int h) {
+    const double real_lo = b->real_min + ((double) (b->first_col + x) * b->scale_real);
+    const double real_hi = b->real_min + ((double) (b->first_col + x + w - 1) * b->scale_real);
+    const double imag_hi = b->imag_min + ((double) (b->height - 1 - (b->first_row + y)) * b->scale_imag);
+    const double imag_lo = b->imag_min + ((double) (b->height - 1 - (b->first_row + y + h - 1)) * b->scale_imag);
+    return real_lo <= 0 && 0 <= real_hi && imag_lo <= 0 && 0 <= imag_hi;
+}
+
+/**
+ * Resolve the inside of a rectangle whose border is already computed
+ */
+static void msRect(const MS_BLOCK* b, int x, int y, int w, int h) {
+    // Nothing left inside
+    if ( w <= 2 || h <= 2 )
+        return;
+
+    // Uniform border, the inside has the same value
+    if ( msUniformBorder(b, x, y, w, h) && (MS_PIXEL(b, x, y) == 1 || !msContainsOrigin(b, x, y, w, h)) ) {
+        const char value = MS_PIXEL(b, x, y);
+        for (int i = y + 1; i < y + h - 1; ++i) {
+            memset(&MS_PIXEL(b, x + 1, i), value, w - 2);
+        }
+        return;
+    }
+
+    // Small enough to just compute it
+    if ( w <= MS_MIN_SIZE || h <= MS_MIN_SIZE ) {
+        for (int i = y + 1; i < y + h - 1; ++i) {
+            msComputeRow(b, x + 1, i, w - 2);
+        }
+        return;
+    }
+
+    // Compute the dividing line, both halves then share it as border
+    if ( w >= h ) {
+        const int mid = x + w / 2;
+        msComputeColumn(b, mid, y + 1, h - 2);
+#if WITH_OMP
+        #pragma omp task if(w * h > MS_TASK_AREA)
+#endif
+        msRect(b, x, y, mid - x + 1, h);
+        msRect(b, mid, y, x + w - mid, h);
+    } else {
+        const int mid = y + h / 2;
+        msComputeRow(b, x + 1, mid, w - 2);
+#if WITH_OMP
+        #pragma omp task if(w * h > MS_TASK_AREA)
+#endif
+        msRect(b, x, y, w, mid - y + 1);
+        msRect(b, x, mid, w, y + h - mid);
+    }
+}
+
+/**
+ * Compute a block of points using Mariani-Silver subdivision
+ */
+void computeMandleBlock(char *data, int stride, int first_col, int first_row, int num_cols, int num_rows, double scale_real, double scale_imag, int iters, int height, double real_min, double imag_min) {
+    MS_BLOCK block;
+    block.data = data;
+    block.stride = stride;
+    block.first_col = first_col;
+    block.first_row = first_row;
+    block.scale_real = scale_real;
+    block.scale_imag = scale_imag;
+    block.iters = iters;
+    block.height = height;
+    block.real_min = real_min;
+    block.imag_min = imag_min;
+    block.row_kernel = getMandleRowKernel();
+    block.column_kernel = getMandleColumnKernel();
+
+    if ( num_cols <= 0 || num_rows <= 0 )
+        return;
+
+    // Outer border of the block
+    msComputeRow(&block, 0, 0, num_cols);
+    if ( num_rows > 1 )
+        msComputeRow(&block, 0, num_rows - 1, num_cols);
+    msComputeColumn(&block, 0, 1, num_rows - 2);
+    if ( num_cols > 1 )
+        msComputeColumn(&block, num_cols - 1, 1, num_rows - 2);
+
+    // Subdivide, the recursion spawns tasks for the team of the worker and we wait for all of them
+#if WITH_OMP
+    #pragma omp taskgroup
+#endif
+    msRect(&block, 0, 0, num_cols, num_rows);
+}
\ No newline at end of file
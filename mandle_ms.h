@@ -0,0 +1,55 @@
+/**
+ * Mandlebort implementation over MPI and OpenMP
+ *
+ * Copyright (c) 2012, Moritz Wundke
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the owner nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Moritz Wundke BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+#ifndef MANDLE_MS_H
+#define MANDLE_MS_H
+
+/** Our own includes */
+#include "mandle_utils.h"
+
+/** Rectangles with a side this short or shorter are computed pixel by pixel */
+#ifndef MS_MIN_SIZE
+	#define MS_MIN_SIZE	8
+#endif
+
+/** Rectangles smaller than this (in pixels) are not worth an OpenMP task */
+#ifndef MS_TASK_AREA
+	#define MS_TASK_AREA	4096
+#endif
+
+/**
+ * Compute a block of 'num_rows' x 'num_cols' points starting at (first_row, first_col)
+ * using Mariani-Silver subdivision: a rectangle whose border is all 0 or all 1 is filled
+ * without iterating its inside, any other rectangle is split in two along its longer side.
+ * The result is stored row by row in 'data', 'stride' chars apart.
+ */
+void computeMandleBlock(char *data, int stride, int first_col, int first_row, int num_cols, int num_rows, double scale_real, double scale_imag, int iters, int height, double real_min, double imag_min);
+
+#endif // MANDLE_MS_H
\ No newline at end of file
@@ -0,0 +1,499 @@
+/**
+ * Mandlebort implementation over MPI and OpenMP
+ *
+ * Copyright (c) 2012, Moritz Wundke
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the owner nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Moritz Wundke BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+/** Our own includes */
+#include "mandle_msg.h"
+#include "mandle_counts.h"
+
+#include <string.h>
+#include <stdint.h>
+
+#ifdef __SSE2__
+	#include <emmintrin.h>
+#endif
+
+// The 64 bit multiply tricks below handle 8 pixels at once and rely on little endian byte order
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	#define MSG_SWAR 1
+#else
+	#define MSG_SWAR 0
+#endif
+
+/** Longest LEB128 encoding of an int */
+#define MAX_VARINT_LEN	5
+
+/**
+ * Bytes needed by a packed row
+ */
+int rowBitsSize(int width) {
+    return (width + 7) / 8;
+}
+
+/**
+ * Bytes needed by a packed tile, every row of the tile starts at a new byte
+ */
+int tileBitsSize(int num_cols, int num_rows) {
+    return num_rows * rowBitsSize(num_cols);
+}
+
+/**
+ * Maximum size of a row message, RLE is only used when it beats the bitmap
+ */
+int rowMsgMaxSize(int width) {
+    return tileMsgMaxSize(width, 1);
+}
+
+/**
+ * Maximum size of a tile message, RLE is only used when it beats the bitmap
+ */
+int tileMsgMaxSize(int num_cols, int num_rows) {
+    return sizeof(ROW_MSG_HEADER) + tileBitsSize(num_cols, num_rows);
+}
+
+/**
+ * Maximum size of a count tile message, RLE is only used when it beats the plain counts
+ */
+int countTileMsgMaxSize(int num_cols, int num_rows, int count_bytes) {
+    return sizeof(ROW_MSG_HEADER) + num_cols * num_rows * count_bytes;
+}
+
+/**
+ * Pack a row of 0/1 values into a bitmap
+ */
+void packRowBits(unsigned char *bits, const char *data, int width) {
+    int j = 0;
+#if MSG_SWAR
+    // The multiply moves byte i of the group to bit 63-i, so the top byte holds
+    // the 8 pixels with the first one in the most significant bit
+    for (; j + 8 <= width; j += 8) {
+        uint64_t group;
+        memcpy(&group, data + j, 8);
+        bits[j/8] = (unsigned char) ((group * 0x8040201008040201ULL) >> 56);
+    }
+#endif
+    for (; j < width; j += 8) {
+        unsigned char byte = 0;
+        for (int b = 0; b < 8 && j+b < width; ++b) {
+            byte |= (data[j+b] & 1) << (7-b);
+        }
+        bits[j/8] = byte;
+    }
+}
+
+/**
+ * Unpack a bitmap into a row of 0/1 values
+ */
+void unpackRowBits(char *data, const unsigned char *bits, int width) {
+    int j = 0;
+#if MSG_SWAR
+    // Broadcast the byte, keep bit 7-i in byte i and turn each non zero byte into 1
+    for (; j + 8 <= width; j += 8) {
+        uint64_t group = (bits[j/8] * 0x0101010101010101ULL) & 0x0102040810204080ULL;
+        group = ((group + 0x7F7F7F7F7F7F7F7FULL) >> 7) & 0x0101010101010101ULL;
+        memcpy(data + j, &group, 8);
+    }
+#endif
+    for (; j < width; ++j) {
+        data[j] = (bits[j/8] >> (7 - j%8)) & 1;
+    }
+}
+
+/**
+ * Length of the run of 'value' that starts at column 'start'
+ */
+static int runLength(const char *data, int start, int width, char value) {
+    int j = start;
+#ifdef __SSE2__
+    // Compare 16 pixels at once and stop at the first one that differs
+    const __m128i v = _mm_set1_epi8(value);
+    for (; j + 16 <= width; j += 16) {
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*) (data + j)), v));
+        if (mask != 0xFFFF)
+            return j + __builtin_ctz(~mask) - start;
+    }
+#endif
+    while (j < width && data[j] == value) {
+        ++j;
+    }
+    return j - start;
+}
+
+/**
+ * Append a LEB128 varint and return the number of bytes written
+ */
+static int putVarint(unsigned char *out, unsigned int value) {
+    int n = 0;
+    while (value >= 0x80) {
+        out[n++] = (unsigned char) ((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    out[n++] = (unsigned char) value;
+    return n;
+}
+
+/**
+ * Read a LEB128 varint, returns the number of bytes read or -1 on a truncated value
+ */
+static int getVarint(const unsigned char *in, int length, unsigned int *value) {
+    *value = 0;
+    for (int n = 0; n < length && n < MAX_VARINT_LEN; ++n) {
+        *value |= (unsigned int) (in[n] & 0x7F) << (7*n);
+        if ( (in[n] & 0x80) == 0 )
+            return n + 1;
+    }
+    return -1;
+}
+
+/**
+ * Set the bits [start, start+len) of a bitmap, whole bytes are filled at once
+ */
+static void setBitRun(unsigned char *bits, int start, int len) {
+    int end = start + len;
+    for (; start < end && (start & 7); ++start) {
+        bits[start/8] |= 0x80 >> (start & 7);
+    }
+    int full_bytes = (end - start) / 8;
+    memset(bits + start/8, 0xFF, full_bytes);
+    start += full_bytes * 8;
+    for (; start < end; ++start) {
+        bits[start/8] |= 0x80 >> (start & 7);
+    }
+}
+
+/**
+ * RLE encode a row, gives up and returns -1 as soon as it would need more than 'limit' bytes
+ */
+static int encodeRowRLE(unsigned char *out, int limit, const char *data, int width) {
+    int n = 0;
+    char value = 0;
+    for (int j = 0; j < width; value ^= 1) {
+        int run = runLength(data, j, width, value);
+        // Only the first run may be empty, anything else means the row is not 0/1
+        if ( (run == 0 && j > 0) || n + MAX_VARINT_LEN > limit )
+            return -1;
+        n += putVarint(out + n, run);
+        j += run;
+    }
+    return n;
+}
+
+/**
+ * Decode a RLE row into a bitmap, returns the bytes used or -1 if the runs do not match the row
+ */
+static int decodeRowRLE(unsigned char *bits, const unsigned char *in, int length, int width) {
+    memset(bits, 0, rowBitsSize(width));
+    int n = 0;
+    int value = 0;
+    for (int j = 0; j < width; value ^= 1) {
+        unsigned int run;
+        int used = getVarint(in + n, length - n, &run);
+        if ( used < 0 || run > (unsigned int) (width - j) )
+            return -1;
+        if ( value )
+            setBitRun(bits, j, run);
+        n += used;
+        j += run;
+    }
+    return n;
+}
+
+/**
+ * Encode a tile into 'msg', picking the RLE encoding when it is smaller than the bitmap
+ */
+int encodeTileMsg(unsigned char *msg, const char *data, int col, int row, int num_cols, int num_rows) {
+    ROW_MSG_HEADER header;
+    unsigned char *payload = msg + sizeof(header);
+    int limit = tileBitsSize(num_cols, num_rows);
+    header.row = row;
+    header.col = col;
+    header.num_cols = num_cols;
+    header.num_rows = num_rows;
+    header.encoding = ROW_ENC_RLE;
+    header.length = 0;
+
+    // The runs of every row follow each other, each row starting with a run of 0
+    for (int i = 0; i < num_rows && header.length >= 0; ++i) {
+        int used = encodeRowRLE(payload + header.length, limit - header.length, data + (long long) i * num_cols, num_cols);
+        header.length = (used < 0) ? -1 : header.length + used;
+    }
+    if ( header.length < 0 ) {
+        header.encoding = ROW_ENC_BITS;
+        header.length = limit;
+        for (int i = 0; i < num_rows; ++i) {
+            packRowBits(payload + (long long) i * rowBitsSize(num_cols), data + (long long) i * num_cols, num_cols);
+        }
+    }
+    memcpy(msg, &header, sizeof(header));
+    return sizeof(header) + header.length;
+}
+
+/**
+ * Encode a row into 'msg', picking the RLE encoding when it is smaller than the bitmap
+ */
+int encodeRowMsg(unsigned char *msg, const char *data, int width, int row) {
+    return encodeTileMsg(msg, data, 0, row, width, 1);
+}
+
+/**
+ * Encode a message carrying only the tile coordinates
+ */
+int encodeTileHeaderMsg(unsigned char *msg, int col, int row, int num_cols, int num_rows) {
+    ROW_MSG_HEADER header;
+    header.row = row;
+    header.col = col;
+    header.num_cols = num_cols;
+    header.num_rows = num_rows;
+    header.encoding = ROW_ENC_NONE;
+    header.length = 0;
+    memcpy(msg, &header, sizeof(header));
+    return sizeof(header);
+}
+
+/**
+ * Decode a tile message of 'length' bytes into a packed tile
+ */
+int decodeTileMsg(const unsigned char *msg, int length, unsigned char *bits, int max_size, int *col, int *num_cols, int *num_rows) {
+    ROW_MSG_HEADER header;
+    if ( length < (int) sizeof(header) )
+        return -1;
+    memcpy(&header, msg, sizeof(header));
+    const unsigned char *payload = msg + sizeof(header);
+    if ( header.length != length - (int) sizeof(header) )
+        return -1;
+    if ( header.num_cols <= 0 || header.num_rows <= 0 || header.num_rows > max_size / rowBitsSize(header.num_cols) )
+        return -1;
+
+    int row_size = rowBitsSize(header.num_cols);
+    if ( header.encoding == ROW_ENC_BITS ) {
+        if ( header.length != tileBitsSize(header.num_cols, header.num_rows) )
+            return -1;
+        memcpy(bits, payload, header.length);
+    } else if ( header.encoding == ROW_ENC_RLE ) {
+        int n = 0;
+        for (int i = 0; i < header.num_rows; ++i) {
+            int used = decodeRowRLE(bits + (long long) i * row_size, payload + n, header.length - n, header.num_cols);
+            if ( used < 0 )
+                return -1;
+            n += used;
+        }
+        if ( n != header.length )
+            return -1;
+    } else if ( header.encoding == ROW_ENC_NONE ) {
+        if ( header.length != 0 )
+            return -1;
+    } else {
+        return -1;
+    }
+    *col = header.col;
+    *num_cols = header.num_cols;
+    *num_rows = header.num_rows;
+    return header.row;
+}
+
+/**
+ * Decode a row message of 'length' bytes into a packed bitmap
+ */
+int decodeRowMsg(const unsigned char *msg, int length, unsigned char *bits, int width) {
+    int col, num_cols, num_rows;
+    int row = decodeTileMsg(msg, length, bits, rowBitsSize(width), &col, &num_cols, &num_rows);
+    if ( row < 0 || col != 0 || num_cols != width || num_rows != 1 )
+        return -1;
+    return row;
+}
+
+/**
+ * Encode a count tile into 'msg', picking the RLE encoding when it is smaller than the plain counts
+ */
+int encodeCountTileMsg(unsigned char *msg, const unsigned char *counts, int count_bytes, int col, int row, int num_cols, int num_rows) {
+    ROW_MSG_HEADER header;
+    unsigned char *payload = msg + sizeof(header);
+    long long num = (long long) num_cols * num_rows;
+    int limit = num * count_bytes;
+    header.row = row;
+    header.col = col;
+    header.num_cols = num_cols;
+    header.num_rows = num_rows;
+    header.encoding = ROW_ENC_COUNTS_RLE;
+    header.length = 0;
+
+    // Runs go on across the rows of the tile, the interior of the set is one long run of 'iters'
+    for (long long i = 0; i < num && header.length >= 0; ) {
+        int count = getCount(counts, count_bytes, i);
+        long long j = i + 1;
+        while ( j < num && getCount(counts, count_bytes, j) == count ) {
+            ++j;
+        }
+        if ( header.length + 2*MAX_VARINT_LEN > limit ) {
+            header.length = -1;
+        } else {
+            header.length += putVarint(payload + header.length, count);
+            header.length += putVarint(payload + header.length, j - i);
+        }
+        i = j;
+    }
+    if ( header.length < 0 ) {
+        header.encoding = ROW_ENC_COUNTS;
+        header.length = limit;
+        memcpy(payload, counts, limit);
+    }
+    memcpy(msg, &header, sizeof(header));
+    return sizeof(header) + header.length;
+}
+
+/**
+ * Decode a count tile message of 'length' bytes into 'counts'
+ */
+int decodeCountTileMsg(const unsigned char *msg, int length, unsigned char *counts, int count_bytes, int max_size, int *col, int *num_cols, int *num_rows) {
+    ROW_MSG_HEADER header;
+    if ( length < (int) sizeof(header) )
+        return -1;
+    memcpy(&header, msg, sizeof(header));
+    const unsigned char *payload = msg + sizeof(header);
+    if ( header.length != length - (int) sizeof(header) )
+        return -1;
+    if ( header.num_cols <= 0 || header.num_rows <= 0 || header.num_rows > max_size / (header.num_cols * count_bytes) )
+        return -1;
+
+    long long num = (long long) header.num_cols * header.num_rows;
+    if ( header.encoding == ROW_ENC_COUNTS ) {
+        if ( header.length != num * count_bytes )
+            return -1;
+        memcpy(counts, payload, header.length);
+    } else if ( header.encoding == ROW_ENC_COUNTS_RLE ) {
+        int n = 0;
+        for (long long i = 0; i < num; ) {
+            unsigned int count, run;
+            int used = getVarint(payload + n, header.length - n, &count);
+            if ( used < 0 || count > (unsigned int) ((count_bytes == 1) ? 0xFF : COUNT_MAX) )
+                return -1;
+            n += used;
+            used = getVarint(payload + n, header.length - n, &run);
+            if ( used < 0 || run == 0 || run > num - i )
+                return -1;
+            n += used;
+            for (unsigned int k = 0; k < run; ++k, ++i) {
+                setCount(counts, count_bytes, i, count);
+            }
+        }
+        if ( n != header.length )
+            return -1;
+    } else {
+        return -1;
+    }
+    *col = header.col;
+    *num_cols = header.num_cols;
+    *num_rows = header.num_rows;
+    return header.row;
+}
+
+#if WITH_MPI
+/**
+ * Create a sender for rows of 'width' pixels, or tiles of at most 'width' x 'max_rows' pixels
+ */
+ROW_SENDER* rowSenderCreate(int width, int max_rows, int count_bytes, int num_buffers, int dest, int tag, MPI_Comm comm) {
+    ROW_SENDER *sender = (ROW_SENDER*)malloc(sizeof(*sender));
+    sender->num_buffers = (num_buffers < 1) ? 1 : num_buffers;
+    sender->next = 0;
+    sender->width = width;
+    sender->count_bytes = count_bytes;
+    if ( max_rows < 1 )
+        max_rows = 1;
+    sender->msg_size = (count_bytes > 0) ? countTileMsgMaxSize(width, max_rows, count_bytes) : tileMsgMaxSize(width, max_rows);
+    sender->dest = dest;
+    sender->tag = tag;
+    sender->comm = comm;
+    sender->buffers = (unsigned char*)malloc((long long) sender->num_buffers * sender->msg_size);
+    sender->requests = (MPI_Request*)malloc(sender->num_buffers * sizeof(*sender->requests));
+    for (int i = 0; i < sender->num_buffers; ++i) {
+        sender->requests[i] = MPI_REQUEST_NULL;
+    }
+    return sender;
+}
+
+/**
+ * Get the next buffer of the ring, the oldest send has to complete before we may overwrite it
+ */
+static unsigned char* rowSenderBuffer(ROW_SENDER *sender) {
+    MPI_Wait(&sender->requests[sender->next], MPI_STATUS_IGNORE);
+    return sender->buffers + (long long) sender->next * sender->msg_size;
+}
+
+/**
+ * Start sending the message in the current buffer and move on to the next one
+ */
+static void rowSenderPost(ROW_SENDER *sender, unsigned char *msg, int length) {
+    MPI_Isend(msg, length, MPI_BYTE, sender->dest, sender->tag, sender->comm, &sender->requests[sender->next]);
+    sender->next = (sender->next + 1) % sender->num_buffers;
+}
+
+/**
+ * Encode and start sending a row, waits only if all buffers are still in flight
+ */
+void rowSenderSend(ROW_SENDER *sender, const char *data, int row) {
+    unsigned char *msg = rowSenderBuffer(sender);
+    rowSenderPost(sender, msg, encodeRowMsg(msg, data, sender->width, row));
+}
+
+/**
+ * Encode and start sending a tile, waits only if all buffers are still in flight
+ */
+void rowSenderSendTile(ROW_SENDER *sender, const char *data, int col, int row, int num_cols, int num_rows) {
+    unsigned char *msg = rowSenderBuffer(sender);
+    rowSenderPost(sender, msg, encodeTileMsg(msg, data, col, row, num_cols, num_rows));
+}
+
+/**
+ * Encode and start sending a tile of escape counts, waits only if all buffers are still in flight
+ */
+void rowSenderSendCounts(ROW_SENDER *sender, const unsigned char *counts, int col, int row, int num_cols, int num_rows) {
+    unsigned char *msg = rowSenderBuffer(sender);
+    rowSenderPost(sender, msg, encodeCountTileMsg(msg, counts, sender->count_bytes, col, row, num_cols, num_rows));
+}
+
+/**
+ * Start sending a header only message for a tile the worker stored itself
+ */
+void rowSenderSendHeader(ROW_SENDER *sender, int col, int row, int num_cols, int num_rows) {
+    unsigned char *msg = rowSenderBuffer(sender);
+    rowSenderPost(sender, msg, encodeTileHeaderMsg(msg, col, row, num_cols, num_rows));
+}
+
+/**
+ * Wait for all pending sends and free the sender
+ */
+void rowSenderDestroy(ROW_SENDER *sender) {
+    if ( sender == NULL )
+        return;
+    MPI_Waitall(sender->num_buffers, sender->requests, MPI_STATUSES_IGNORE);
+    free(sender->requests);
+    free(sender->buffers);
+    free(sender);
+}
+#endif
\ No newline at end of file
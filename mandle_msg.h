@@ -0,0 +1,191 @@
+/**
+ * Mandlebort implementation over MPI and OpenMP
+ *
+ * Copyright (c) 2012, Moritz Wundke
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the owner nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Moritz Wundke BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+#ifndef MANDLE_MSG_H
+#define MANDLE_MSG_H
+
+/** Our own includes */
+#include "mandle_utils.h"
+
+/** Row encodings used on the wire */
+#define ROW_ENC_BITS	0	// Packed bitmap, (width+7)/8 bytes, first column in the most significant bit
+#define ROW_ENC_RLE		1	// Lengths of the alternating 0 and 1 runs (starting with 0) as LEB128 varints
+#define ROW_ENC_NONE	2	// No payload, the worker stored the row itself (MPI-IO output)
+#define ROW_ENC_COUNTS	3	// Escape counts, 1 or 2 bytes each (see countBytes)
+#define ROW_ENC_COUNTS_RLE	4	// Pairs of escape count and run length as LEB128 varints, runs span the rows of a tile
+
+/** Number of row messages a worker keeps in flight */
+#ifndef ROW_SEND_BUFFERS
+	#define ROW_SEND_BUFFERS	2
+#endif
+
+/**
+ * Header in front of every row or tile message, followed by 'length' bytes of payload.
+ * A row is a tile of 'width' x 1 points starting at column 0.
+ */
+typedef struct {
+    int row;
+    int col;
+    int num_cols;
+    int num_rows;
+    int encoding;
+    int length;
+} ROW_MSG_HEADER;
+
+/**
+ * Bytes needed by a packed row
+ */
+int rowBitsSize(int width);
+
+/**
+ * Bytes needed by a packed tile, every row of the tile starts at a new byte
+ */
+int tileBitsSize(int num_cols, int num_rows);
+
+/**
+ * Maximum size of a row message, used to allocate the send and receive buffers
+ */
+int rowMsgMaxSize(int width);
+
+/**
+ * Maximum size of a tile message, used to allocate the send and receive buffers
+ */
+int tileMsgMaxSize(int num_cols, int num_rows);
+
+/**
+ * Maximum size of a tile message of escape counts, 'count_bytes' each
+ */
+int countTileMsgMaxSize(int num_cols, int num_rows, int count_bytes);
+
+/**
+ * Pack a row of 0/1 values into a bitmap
+ */
+void packRowBits(unsigned char *bits, const char *data, int width);
+
+/**
+ * Unpack a bitmap into a row of 0/1 values
+ */
+void unpackRowBits(char *data, const unsigned char *bits, int width);
+
+/**
+ * Encode a row into 'msg', picking the RLE encoding when it is smaller than the
+ * bitmap. Returns the size of the message in bytes.
+ */
+int encodeRowMsg(unsigned char *msg, const char *data, int width, int row);
+
+/**
+ * Encode a tile of 'num_cols' x 'num_rows' values, stored row by row in 'data', into 'msg'.
+ * Every row of the tile uses the RLE encoding if it makes the tile smaller than the bitmap.
+ * Returns the size of the message in bytes.
+ */
+int encodeTileMsg(unsigned char *msg, const char *data, int col, int row, int num_cols, int num_rows);
+
+/**
+ * Encode a message carrying only the tile coordinates. Returns the size of the message in bytes.
+ */
+int encodeTileHeaderMsg(unsigned char *msg, int col, int row, int num_cols, int num_rows);
+
+/**
+ * Decode a row message of 'length' bytes into a packed bitmap, 'bits' is left untouched for
+ * header only messages. Returns the row id or -1 if the message is corrupt.
+ */
+int decodeRowMsg(const unsigned char *msg, int length, unsigned char *bits, int width);
+
+/**
+ * Decode a tile message of 'length' bytes into a packed tile (see tileBitsSize) of at most
+ * 'max_size' bytes, 'bits' is left untouched for header only messages. Returns the first row
+ * of the tile and stores its first column and size, or returns -1 if the message is corrupt.
+ */
+int decodeTileMsg(const unsigned char *msg, int length, unsigned char *bits, int max_size, int *col, int *num_cols, int *num_rows);
+
+/**
+ * Encode a tile of 'num_cols' x 'num_rows' escape counts, 'count_bytes' each and stored row by row,
+ * into 'msg'. The runs of equal counts are used if they make the tile smaller. Returns the size of
+ * the message in bytes.
+ */
+int encodeCountTileMsg(unsigned char *msg, const unsigned char *counts, int count_bytes, int col, int row, int num_cols, int num_rows);
+
+/**
+ * Decode a count tile message of 'length' bytes into at most 'max_size' bytes of counts. Returns the
+ * first row of the tile and stores its first column and size, or returns -1 if the message is corrupt.
+ */
+int decodeCountTileMsg(const unsigned char *msg, int length, unsigned char *counts, int count_bytes, int max_size, int *col, int *num_cols, int *num_rows);
+
+#if WITH_MPI
+/**
+ * Non blocking row sender, rows are encoded into a ring of buffers and sent with MPI_Isend.
+ * A buffer is only reused once its previous send completed.
+ */
+typedef struct {
+    int num_buffers;
+    int next;
+    int width;
+    int count_bytes;    // Bytes per escape count of count tiles, 0 for 0/1 rows and tiles
+    int msg_size;
+    int dest;
+    int tag;
+    MPI_Comm comm;
+    unsigned char *buffers;
+    MPI_Request *requests;
+} ROW_SENDER;
+
+/**
+ * Create a sender for rows of 'width' pixels, or tiles of at most 'width' x 'max_rows' pixels,
+ * going to 'dest' with the given tag. With 'count_bytes' > 0 it sends escape counts of that size.
+ */
+ROW_SENDER* rowSenderCreate(int width, int max_rows, int count_bytes, int num_buffers, int dest, int tag, MPI_Comm comm);
+
+/**
+ * Encode and start sending a row, waits only if all buffers are still in flight
+ */
+void rowSenderSend(ROW_SENDER *sender, const char *data, int row);
+
+/**
+ * Encode and start sending a tile, waits only if all buffers are still in flight
+ */
+void rowSenderSendTile(ROW_SENDER *sender, const char *data, int col, int row, int num_cols, int num_rows);
+
+/**
+ * Encode and start sending a tile of escape counts, waits only if all buffers are still in flight
+ */
+void rowSenderSendCounts(ROW_SENDER *sender, const unsigned char *counts, int col, int row, int num_cols, int num_rows);
+
+/**
+ * Start sending a header only message for a tile the worker stored itself
+ */
+void rowSenderSendHeader(ROW_SENDER *sender, int col, int row, int num_cols, int num_rows);
+
+/**
+ * Wait for all pending sends and free the sender
+ */
+void rowSenderDestroy(ROW_SENDER *sender);
+#endif
+
+#endif // MANDLE_MSG_H
\ No newline at end of file
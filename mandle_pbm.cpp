@@ -0,0 +1,290 @@
+/**
+ * Mandlebort implementation over MPI and OpenMP
+ *
+ * Copyright (c) 2012, Moritz Wundke
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the owner nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Moritz Wundke BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+/** Our own includes */
+#include "mandle_pbm.h"
+#include "mandle_msg.h"
+
+#include <string.h>
+#include <sys/types.h>
+
+/**
+ * Write a packed row at its position in the file, seeking only if the file is not already there
+ */
+static void pbmWriteAt(PBM_WRITER* pbm, int row, const unsigned char* bits) {
+    if ( pbm->file_row != row ) {
+        if ( fseeko(pbm->file, (off_t) (pbm->data_offset + (long long) row * pbm->row_size), SEEK_SET) != 0 ) {
+            ERROR("Failed to seek to row %d of the PBM file\n", row);
+            return;
+        }
+    }
+    fwrite(bits, 1, pbm->row_size, pbm->file);
+    pbm->file_row = row + 1;
+}
+
+/**
+ * Write every row that is now in sequence
+ */
+static void pbmDrain(PBM_WRITER* pbm) {
+    while ( pbm->next_row < pbm->height ) {
+        int slot = pbm->next_row % pbm->window;
+        if ( pbm->pending_used[slot] ) {
+            pbmWriteAt(pbm, pbm->next_row, pbm->pending + (long long) slot * pbm->row_size);
+            pbm->pending_used[slot] = 0;
+        } else if ( !pbm->written[pbm->next_row] ) {
+            break;
+        }
+        ++pbm->next_row;
+    }
+}
+
+/**
+ * Create 'filename' and write the P4 header
+ */
+PBM_WRITER* pbmOpen(const char* filename, int width, int height, int window) {
+    FILE* file = fopen(filename, "wb");
+    if ( file == NULL ) {
+        ERROR("Failed to create PBM file '%s'\n", filename);
+        return NULL;
+    }
+
+    PBM_WRITER* pbm = (PBM_WRITER*) malloc(sizeof(*pbm));
+    pbm->file = file;
+    pbm->width = width;
+    pbm->height = height;
+    pbm->row_size = rowBitsSize(width);
+    pbm->data_offset = fprintf(file, "P4\n%d %d\n", width, height);
+    pbm->next_row = 0;
+    pbm->file_row = 0;
+    pbm->window = (window > 0) ? window : 1;
+    pbm->pending = (unsigned char*) malloc((long long) pbm->window * pbm->row_size);
+    pbm->pending_used = (char*) calloc(pbm->window, sizeof(char));
+    pbm->written = (char*) calloc(height, sizeof(char));
+    pbm->stream = NULL;
+    return pbm;
+}
+
+/**
+ * Create 'filename' and map it with the P4 header
+ */
+PBM_WRITER* pbmOpenMapped(const char* filename, int width, int height) {
+    char header[64];
+    snprintf(header, sizeof(header), "P4\n%d %d\n", width, height);
+    STREAM_FILE* stream = streamOpen(filename, header, (long long) height * rowBitsSize(width), false);
+    if ( stream == NULL ) {
+        ERROR("Failed to create PBM file '%s'\n", filename);
+        return NULL;
+    }
+
+    PBM_WRITER* pbm = (PBM_WRITER*) calloc(1, sizeof(*pbm));
+    pbm->width = width;
+    pbm->height = height;
+    pbm->row_size = rowBitsSize(width);
+    pbm->data_offset = stream->data_offset;
+    pbm->stream = stream;
+    return pbm;
+}
+
+/**
+ * Copy a packed tile into the mapped file
+ */
+void pbmWriteTile(PBM_WRITER* pbm, int first_col, int first_row, int num_cols, int num_rows, const unsigned char* bits) {
+    if ( pbm->stream == NULL || first_row < 0 || first_row > pbm->height - num_rows || first_col < 0 || first_col > pbm->width - num_cols || first_col % 8 != 0 ) {
+        ERROR("PBM tile at %d,%d can not be written in place\n", first_col, first_row);
+        return;
+    }
+    int tile_row_size = rowBitsSize(num_cols);
+    unsigned char* data = streamData(pbm->stream);
+    for (int i = 0; i < num_rows; ++i) {
+        memcpy(data + (long long) (first_row + i) * pbm->row_size + first_col / 8, bits + (long long) i * tile_row_size, tile_row_size);
+    }
+    streamWrote(pbm->stream, (long long) num_rows * tile_row_size);
+}
+
+/**
+ * Hand a packed row to the writer
+ */
+void pbmWriteRow(PBM_WRITER* pbm, int row, const unsigned char* bits) {
+    if ( pbm->stream != NULL ) {
+        pbmWriteTile(pbm, 0, row, pbm->width, 1, bits);
+        return;
+    }
+    if ( row < pbm->next_row || row >= pbm->height || pbm->written[row] ) {
+        ERROR("PBM row %d written twice or out of range\n", row);
+        return;
+    }
+
+    if ( row == pbm->next_row ) {
+        pbmWriteAt(pbm, row, bits);
+        ++pbm->next_row;
+        pbmDrain(pbm);
+    } else if ( row < pbm->next_row + pbm->window ) {
+        int slot = row % pbm->window;
+        memcpy(pbm->pending + (long long) slot * pbm->row_size, bits, pbm->row_size);
+        pbm->pending_used[slot] = 1;
+    } else {
+        // Too far ahead for the window, write it in place
+        pbmWriteAt(pbm, row, bits);
+        pbm->written[row] = 1;
+    }
+}
+
+/**
+ * Hand a row of 0/1 values to the writer
+ */
+void pbmWriteRowData(PBM_WRITER* pbm, int row, const char* data) {
+    unsigned char* bits = (unsigned char*) malloc(pbm->row_size);
+    packRowBits(bits, data, pbm->width);
+    pbmWriteRow(pbm, row, bits);
+    free(bits);
+}
+
+/**
+ * Flush the window, fill rows that never arrived with 0 and close the file
+ */
+void pbmClose(PBM_WRITER* pbm) {
+    if ( pbm->stream != NULL ) {
+        // The file was created full of zeros, rows that never arrived are already 0
+        streamClose(pbm->stream);
+        free(pbm);
+        return;
+    }
+    unsigned char* empty = (unsigned char*) calloc(pbm->row_size, sizeof(unsigned char));
+    while ( pbm->next_row < pbm->height ) {
+        ERROR("PBM row %d missing\n", pbm->next_row);
+        pbmWriteRow(pbm, pbm->next_row, empty);
+    }
+    free(empty);
+
+    fclose(pbm->file);
+    free(pbm->written);
+    free(pbm->pending_used);
+    free(pbm->pending);
+    free(pbm);
+}
+
+/**
+ * Generate a binary PBM file from a full image
+ */
+void createPBMFile(const char* filename, char *data, int width, int height) {
+    PBM_WRITER* pbm = pbmOpen(filename, width, height, 1);
+    if ( pbm == NULL )
+        return;
+    for (int row = 0; row < height; ++row) {
+        pbmWriteRowData(pbm, row, data + (long long) row * width);
+    }
+    pbmClose(pbm);
+}
+
+#if WITH_MPI
+/**
+ * Collectively create 'filename', sized for the whole image, rank 0 writes the P4 header
+ */
+PBM_MPI_FILE* pbmMpiOpen(const char* filename, int width, int height, MPI_Comm comm) {
+    MPI_File file;
+    int rank;
+    char header[64];
+    int header_size = snprintf(header, sizeof(header), "P4\n%d %d\n", width, height);
+
+    MPI_Comm_rank(comm, &rank);
+    if ( MPI_File_open(comm, (char*) filename, MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &file) != MPI_SUCCESS ) {
+        if ( rank == 0 ) {
+            ERROR("Failed to create PBM file '%s'\n", filename);
+        }
+        return NULL;
+    }
+
+    PBM_MPI_FILE* pbm = (PBM_MPI_FILE*) malloc(sizeof(*pbm));
+    pbm->file = file;
+    pbm->width = width;
+    pbm->row_size = rowBitsSize(width);
+    pbm->data_offset = header_size;
+    pbm->row_bits = (unsigned char*) malloc(pbm->row_size);
+
+    // Drop whatever an older and bigger file left behind
+    MPI_File_set_size(file, pbm->data_offset + (MPI_Offset) height * pbm->row_size);
+    if ( rank == 0 ) {
+        MPI_File_write_at(file, 0, header, header_size, MPI_BYTE, MPI_STATUS_IGNORE);
+    }
+    return pbm;
+}
+
+/**
+ * Write 'num_rows' consecutive packed rows starting at 'first_row'
+ */
+void pbmMpiWriteRows(PBM_MPI_FILE* pbm, int first_row, int num_rows, const unsigned char* bits) {
+    MPI_Offset offset = pbm->data_offset + (MPI_Offset) first_row * pbm->row_size;
+    if ( MPI_File_write_at(pbm->file, offset, (void*) bits, num_rows * pbm->row_size, MPI_BYTE, MPI_STATUS_IGNORE) != MPI_SUCCESS ) {
+        ERROR("Failed to write PBM rows %d to %d\n", first_row, first_row + num_rows - 1);
+    }
+}
+
+/**
+ * Collective version of pbmMpiWriteRows
+ */
+void pbmMpiWriteRowsAll(PBM_MPI_FILE* pbm, int first_row, int num_rows, const unsigned char* bits) {
+    MPI_Offset offset = pbm->data_offset + (MPI_Offset) first_row * pbm->row_size;
+    if ( MPI_File_write_at_all(pbm->file, offset, (void*) bits, num_rows * pbm->row_size, MPI_BYTE, MPI_STATUS_IGNORE) != MPI_SUCCESS ) {
+        ERROR("Failed to write PBM rows %d to %d\n", first_row, first_row + num_rows - 1);
+    }
+}
+
+/**
+ * Pack a row of 0/1 values and write it
+ */
+void pbmMpiWriteRowData(PBM_MPI_FILE* pbm, int row, const char* data) {
+    packRowBits(pbm->row_bits, data, pbm->width);
+    pbmMpiWriteRows(pbm, row, 1, pbm->row_bits);
+}
+
+/**
+ * Pack and write a tile, every row of the tile is a run of whole bytes in the file
+ */
+void pbmMpiWriteTileData(PBM_MPI_FILE* pbm, int first_col, int first_row, int num_cols, int num_rows, const char* data) {
+    for (int i = 0; i < num_rows; ++i) {
+        MPI_Offset offset = pbm->data_offset + (MPI_Offset) (first_row + i) * pbm->row_size + first_col / 8;
+        packRowBits(pbm->row_bits, data + (long long) i * num_cols, num_cols);
+        if ( MPI_File_write_at(pbm->file, offset, pbm->row_bits, rowBitsSize(num_cols), MPI_BYTE, MPI_STATUS_IGNORE) != MPI_SUCCESS ) {
+            ERROR("Failed to write PBM row %d\n", first_row + i);
+        }
+    }
+}
+
+/**
+ * Collectively close the file
+ */
+void pbmMpiClose(PBM_MPI_FILE* pbm) {
+    if ( pbm == NULL )
+        return;
+    MPI_File_close(&pbm->file);
+    free(pbm->row_bits);
+    free(pbm);
+}
+#endif
\ No newline at end of file
@@ -0,0 +1,152 @@
+/**
+ * Mandlebort implementation over MPI and OpenMP
+ *
+ * Copyright (c) 2012, Moritz Wundke
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the owner nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Moritz Wundke BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+#ifndef MANDLE_PBM_H
+#define MANDLE_PBM_H
+
+/** STD includes */
+#include <stdio.h>
+
+/** Our own includes */
+#include "mandle_utils.h"
+#include "mandle_stream.h"
+
+/** Number of out of order rows the PBM writer keeps in memory before writing them in place */
+#ifndef PBM_WINDOW
+	#define PBM_WINDOW	256
+#endif
+
+/**
+ * Streaming binary PBM (P4) writer. Rows can be handed in any order: the next row
+ * of the file is appended right away, rows slightly ahead wait in a reorder window
+ * and rows further ahead are written at their offset in the file.
+ */
+typedef struct {
+    FILE* file;
+    int width;
+    int height;
+    int row_size;           // Bytes of a packed row
+    long long data_offset;  // Size of the header
+    int next_row;           // First row not yet written in sequence
+    long long file_row;     // Row the file position points to
+    int window;             // Rows in the reorder window
+    unsigned char* pending; // Reorder window, row r lives in slot r % window
+    char* pending_used;     // Slot holds a row
+    char* written;          // Rows written ahead of next_row
+    STREAM_FILE* stream;    // Mapped file of a writer from pbmOpenMapped, NULL otherwise
+} PBM_WRITER;
+
+/**
+ * Create 'filename' and write the P4 header
+ */
+PBM_WRITER* pbmOpen(const char* filename, int width, int height, int window);
+
+/**
+ * Create 'filename' sized for the whole image and map it, rows and tiles are copied straight to their
+ * place in any order and the working set is bounded by STREAM_WORKING_SET
+ */
+PBM_WRITER* pbmOpenMapped(const char* filename, int width, int height);
+
+/**
+ * Write a packed tile in place, 'num_rows' rows of rowBitsSize(num_cols) bytes. Only for mapped writers,
+ * 'first_col' has to be a multiple of 8.
+ */
+void pbmWriteTile(PBM_WRITER* pbm, int first_col, int first_row, int num_cols, int num_rows, const unsigned char* bits);
+
+/**
+ * Hand a packed row (see packRowBits) to the writer
+ */
+void pbmWriteRow(PBM_WRITER* pbm, int row, const unsigned char* bits);
+
+/**
+ * Hand a row of 0/1 values to the writer
+ */
+void pbmWriteRowData(PBM_WRITER* pbm, int row, const char* data);
+
+/**
+ * Flush the window, fill rows that never arrived with 0 and close the file
+ */
+void pbmClose(PBM_WRITER* pbm);
+
+/**
+ * Generate a binary PBM file from a full image.
+ *
+ * filename: filename to be written to
+ * data: matrix of all data, 'width' values per row
+ */
+void createPBMFile(const char* filename, char *data, int width, int height);
+
+#if WITH_MPI
+/**
+ * Binary PBM (P4) file shared by all ranks through MPI-IO. Every rank writes its rows
+ * at their offset, rank 0 writes the header.
+ */
+typedef struct {
+    MPI_File file;
+    int width;
+    int row_size;             // Bytes of a packed row
+    MPI_Offset data_offset;   // Size of the header
+    unsigned char* row_bits;  // Scratch row for pbmMpiWriteRowData
+} PBM_MPI_FILE;
+
+/**
+ * Collectively create 'filename', sized for the whole image, rank 0 writes the P4 header.
+ * Returns NULL on every rank if the file could not be created.
+ */
+PBM_MPI_FILE* pbmMpiOpen(const char* filename, int width, int height, MPI_Comm comm);
+
+/**
+ * Write 'num_rows' consecutive packed rows starting at 'first_row'
+ */
+void pbmMpiWriteRows(PBM_MPI_FILE* pbm, int first_row, int num_rows, const unsigned char* bits);
+
+/**
+ * Collective version of pbmMpiWriteRows, every rank of the file has to call it (with 0 rows if it has nothing to write)
+ */
+void pbmMpiWriteRowsAll(PBM_MPI_FILE* pbm, int first_row, int num_rows, const unsigned char* bits);
+
+/**
+ * Pack a row of 0/1 values and write it
+ */
+void pbmMpiWriteRowData(PBM_MPI_FILE* pbm, int row, const char* data);
+
+/**
+ * Pack and write a tile of 'num_cols' x 'num_rows' values stored row by row in 'data',
+ * 'first_col' has to be a multiple of 8
+ */
+void pbmMpiWriteTileData(PBM_MPI_FILE* pbm, int first_col, int first_row, int num_cols, int num_rows, const char* data);
+
+/**
+ * Collectively close the file
+ */
+void pbmMpiClose(PBM_MPI_FILE* pbm);
+#endif
+
+#endif // MANDLE_PBM_H
\ No newline at end of file
@@ -0,0 +1,349 @@
+/**
+ * Mandlebort implementation over MPI and OpenMP
+ *
+ * Copyright (c) 2012, Moritz Wundke
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the owner nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Moritz Wundke BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+/** Our own includes */
+#include "mandle_perturb.h"
+#include "mandle_simd.h"
+#include "mandle_counts.h"
+
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+
+/**
+ * Fixed point number in two's complement, limb 0 is the least significant one and
+ * limb PERTURB_LIMBS-1 holds the integer part
+ */
+typedef struct {
+    uint32_t limb[PERTURB_LIMBS];
+} HP_FIXED;
+
+/** Reference the perturbation kernels iterate against */
+static const REF_ORBIT* reference = NULL;
+
+static bool hpIsNegative(const HP_FIXED* a) {
+    return (a->limb[PERTURB_LIMBS-1] & 0x80000000u) != 0;
+}
+
+static void hpNegate(HP_FIXED* a) {
+    uint64_t carry = 1;
+    for (int k = 0; k < PERTURB_LIMBS; ++k) {
+        carry += (uint32_t) ~a->limb[k];
+        a->limb[k] = (uint32_t) carry;
+        carry >>= 32;
+    }
+}
+
+static void hpAdd(HP_FIXED* r, const HP_FIXED* a, const HP_FIXED* b) {
+    uint64_t carry = 0;
+    for (int k = 0; k < PERTURB_LIMBS; ++k) {
+        carry += (uint64_t) a->limb[k] + b->limb[k];
+        r->limb[k] = (uint32_t) carry;
+        carry >>= 32;
+    }
+}
+
+static void hpSub(HP_FIXED* r, const HP_FIXED* a, const HP_FIXED* b) {
+    HP_FIXED negated = *b;
+    hpNegate(&negated);
+    hpAdd(r, a, &negated);
+}
+
+/**
+ * Multiply the magnitudes and drop the lowest PERTURB_LIMBS-1 limbs of the product
+ */
+static void hpMul(HP_FIXED* r, const HP_FIXED* a, const HP_FIXED* b) {
+    HP_FIXED ma = *a, mb = *b;
+    bool negative = hpIsNegative(&ma) != hpIsNegative(&mb);
+    if ( hpIsNegative(&ma) )
+        hpNegate(&ma);
+    if ( hpIsNegative(&mb) )
+        hpNegate(&mb);
+
+    uint32_t product[2*PERTURB_LIMBS];
+    memset(product, 0, sizeof(product));
+    for (int i = 0; i < PERTURB_LIMBS; ++i) {
+        uint64_t carry = 0;
+        for (int j = 0; j < PERTURB_LIMBS; ++j) {
+            carry += (uint64_t) ma.limb[i] * mb.limb[j] + product[i+j];
+            product[i+j] = (uint32_t) carry;
+            carry >>= 32;
+        }
+        product[i+PERTURB_LIMBS] = (uint32_t) carry;
+    }
+    memcpy(r->limb, product + PERTURB_LIMBS-1, sizeof(r->limb));
+    if ( negative )
+        hpNegate(r);
+}
+
+static double hpToDouble(const HP_FIXED* a) {
+    HP_FIXED m = *a;
+    bool negative = hpIsNegative(&m);
+    if ( negative )
+        hpNegate(&m);
+    double value = 0;
+    for (int k = 0; k < PERTURB_LIMBS; ++k) {
+        value += ldexp((double) m.limb[k], 32 * (k - (PERTURB_LIMBS-1)));
+    }
+    return negative ? -value : value;
+}
+
+/**
+ * Multiply (divide is false) or divide the magnitude 'a' by a small factor
+ */
+static void hpScale(HP_FIXED* a, uint32_t factor, bool divide) {
+    uint64_t carry = 0;
+    if ( divide ) {
+        for (int k = PERTURB_LIMBS-1; k >= 0; --k) {
+            carry = (carry << 32) | a->limb[k];
+            a->limb[k] = (uint32_t) (carry / factor);
+            carry %= factor;
+        }
+    } else {
+        for (int k = 0; k < PERTURB_LIMBS; ++k) {
+            carry += (uint64_t) a->limb[k] * factor;
+            a->limb[k] = (uint32_t) carry;
+            carry >>= 32;
+        }
+    }
+}
+
+/**
+ * Parse a decimal number with an optional exponent, returns false if it is not one
+ */
+static bool hpParse(HP_FIXED* r, const char* text) {
+    memset(r, 0, sizeof(*r));
+    bool negative = (*text == '-');
+    if ( *text == '-' || *text == '+' )
+        ++text;
+
+    // Integer digits go straight into the top limb
+    const char* digits = text;
+    while ( *text >= '0' && *text <= '9' ) {
+        r->limb[PERTURB_LIMBS-1] = r->limb[PERTURB_LIMBS-1] * 10 + (*text++ - '0');
+    }
+
+    // The fraction is built from its last digit up, adding the digit and dividing by ten
+    if ( *text == '.' ) {
+        const char* first = ++text;
+        while ( *text >= '0' && *text <= '9' ) {
+            ++text;
+        }
+        HP_FIXED fraction;
+        memset(&fraction, 0, sizeof(fraction));
+        for (const char* digit = text - 1; digit >= first; --digit) {
+            fraction.limb[PERTURB_LIMBS-1] += *digit - '0';
+            hpScale(&fraction, 10, true);
+        }
+        hpAdd(r, r, &fraction);
+        if ( text == first && first - 1 == digits )
+            return false;
+    } else if ( text == digits ) {
+        return false;
+    }
+
+    if ( *text == 'e' || *text == 'E' ) {
+        char* end;
+        long exponent = strtol(text + 1, &end, 10);
+        if ( end == text + 1 )
+            return false;
+        text = end;
+        for (; exponent > 0; --exponent) {
+            hpScale(r, 10, false);
+        }
+        for (; exponent < 0; ++exponent) {
+            hpScale(r, 10, true);
+        }
+    }
+    if ( negative )
+        hpNegate(r);
+    return *text == '\0';
+}
+
+/**
+ * Allocate an empty orbit of 'length' points
+ */
+REF_ORBIT* refOrbitAlloc(int length) {
+    REF_ORBIT* orbit = (REF_ORBIT*)malloc(sizeof(*orbit));
+    orbit->length = length;
+    orbit->z_real = (double*)malloc(length * sizeof(*orbit->z_real));
+    orbit->z_imag = (double*)malloc(length * sizeof(*orbit->z_imag));
+    return orbit;
+}
+
+/**
+ * Iterate the orbit of the center point in fixed point
+ */
+REF_ORBIT* refOrbitCreate(const char* center_real, const char* center_imag, int iters) {
+    HP_FIXED c_real, c_imag, z_real, z_imag, real_sq, imag_sq, cross;
+    if ( !hpParse(&c_real, center_real) || !hpParse(&c_imag, center_imag) ) {
+        ERROR("Center '%s' '%s' is not a number\n", center_real, center_imag);
+        return NULL;
+    }
+    REF_ORBIT* orbit = refOrbitAlloc(iters + 1);
+    memset(&z_real, 0, sizeof(z_real));
+    memset(&z_imag, 0, sizeof(z_imag));
+    orbit->z_real[0] = orbit->z_imag[0] = 0;
+
+    // Same loop as computeMandleIterations, the last point stored is the first one outside
+    int k = 0;
+    double lengthsq = 0;
+    while ( lengthsq < SIZE_SQ && k < iters ) {
+        hpMul(&real_sq, &z_real, &z_real);
+        hpMul(&imag_sq, &z_imag, &z_imag);
+        hpMul(&cross, &z_real, &z_imag);
+        hpSub(&z_real, &real_sq, &imag_sq);
+        hpAdd(&z_real, &z_real, &c_real);
+        hpAdd(&z_imag, &cross, &cross);
+        hpAdd(&z_imag, &z_imag, &c_imag);
+        ++k;
+        orbit->z_real[k] = hpToDouble(&z_real);
+        orbit->z_imag[k] = hpToDouble(&z_imag);
+        lengthsq = orbit->z_real[k] * orbit->z_real[k] + orbit->z_imag[k] * orbit->z_imag[k];
+    }
+    orbit->length = k + 1;
+    LOG("Reference orbit with %d points\n", orbit->length);
+    return orbit;
+}
+
+/**
+ * Free the orbit
+ */
+void refOrbitFree(REF_ORBIT* orbit) {
+    if ( orbit == NULL )
+        return;
+    free(orbit->z_real);
+    free(orbit->z_imag);
+    free(orbit);
+}
+
+/**
+ * Iterate the delta of a point to the reference orbit
+ */
+int computePerturbIterations(const REF_ORBIT* orbit, double dc_real, double dc_imag, int iters) {
+    const double* z_real = orbit->z_real;
+    const double* z_imag = orbit->z_imag;
+    const int last = orbit->length - 1;
+    double d_real = 0, d_imag = 0;
+    int m = 0;
+
+    for (int k = 0; k < iters; ) {
+        // d' = (2 Z + d) d + dc, which is (Z + d)^2 + c - (Z^2 + c_ref)
+        const double t_real = 2.0*z_real[m] + d_real;
+        const double t_imag = 2.0*z_imag[m] + d_imag;
+        const double temp = t_real*d_real - t_imag*d_imag + dc_real;
+        d_imag = t_real*d_imag + t_imag*d_real + dc_imag;
+        d_real = temp;
+        ++m;
+        ++k;
+
+        const double real = z_real[m] + d_real;
+        const double imag = z_imag[m] + d_imag;
+        const double lengthsq = real*real + imag*imag;
+        if ( lengthsq >= SIZE_SQ )
+            return k;
+
+        // Glitch, the point got closer to 0 than to the reference (or the reference ended): continue from Z_0
+        if ( lengthsq < d_real*d_real + d_imag*d_imag || m == last ) {
+            d_real = real;
+            d_imag = imag;
+            m = 0;
+        }
+    }
+    return iters;
+}
+
+/**
+ * Perturbation row kernel, 'real_min' and 'imag_min' are offsets from the reference point
+ */
+static void perturbRow(char *data, int first_col, int num_cols, int row, double scale_real, double scale_imag, int iters, int height, double real_min, double imag_min) {
+    const double dc_imag = imag_min + ((double) (height-1-row) * scale_imag);
+    for (int j = 0; j < num_cols; ++j) {
+        data[j] = (computePerturbIterations(reference, real_min + ((double) (first_col + j) * scale_real), dc_imag, iters) == iters);
+    }
+}
+
+/**
+ * Perturbation column kernel
+ */
+static void perturbColumn(char *data, int stride, int col, int first_row, int num_rows, double scale_real, double scale_imag, int iters, int height, double real_min, double imag_min) {
+    const double dc_real = real_min + ((double) col * scale_real);
+    for (int i = 0; i < num_rows; ++i) {
+        data[(long long) i * stride] = (computePerturbIterations(reference, dc_real, imag_min + ((double) (height-1-(first_row+i)) * scale_imag), iters) == iters);
+    }
+}
+
+/**
+ * Perturbation count kernel
+ */
+static void perturbCount(unsigned char *counts, int count_bytes, int first_col, int num_cols, int row, double scale_real, double scale_imag, int iters, int height, double real_min, double imag_min) {
+    const double dc_imag = imag_min + ((double) (height-1-row) * scale_imag);
+    for (int j = 0; j < num_cols; ++j) {
+        setCount(counts, count_bytes, j, computePerturbIterations(reference, real_min + ((double) (first_col + j) * scale_real), dc_imag, iters));
+    }
+}
+
+/**
+ * Make all kernels iterate against 'orbit', NULL selects the normal kernels
+ */
+void setPerturbReference(const REF_ORBIT* orbit) {
+    reference = orbit;
+    if ( orbit != NULL ) {
+        setMandleKernels(perturbRow, perturbColumn, perturbCount, "perturbation");
+    } else {
+        setMandleKernels(NULL, NULL, NULL, NULL);
+    }
+}
+
+/**
+ * The orbit set with setPerturbReference
+ */
+const REF_ORBIT* getPerturbReference() {
+    return reference;
+}
+
+#if WITH_MPI
+/**
+ * Broadcast the orbit of 'root', the other ranks get a new orbit in '*orbit'
+ */
+void refOrbitBcast(REF_ORBIT** orbit, int root, MPI_Comm comm) {
+    int rank, length = 0;
+    MPI_Comm_rank(comm, &rank);
+    if ( rank == root )
+        length = (*orbit != NULL) ? (*orbit)->length : 0;
+    MPI_Bcast(&length, 1, MPI_INT, root, comm);
+    if ( rank != root )
+        *orbit = (length > 0) ? refOrbitAlloc(length) : NULL;
+    if ( length > 0 ) {
+        MPI_Bcast((*orbit)->z_real, length, MPI_DOUBLE, root, comm);
+        MPI_Bcast((*orbit)->z_imag, length, MPI_DOUBLE, root, comm);
+    }
+}
+#endif
\ No newline at end of file
@@ -0,0 +1,95 @@
+/**
+ * Mandlebort implementation over MPI and OpenMP
+ *
+ * Copyright (c) 2012, Moritz Wundke
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the owner nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Moritz Wundke BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+#ifndef MANDLE_PERTURB_H
+#define MANDLE_PERTURB_H
+
+/** Our own includes */
+#include "mandle_utils.h"
+
+/** 32 bit limbs of the fixed point numbers the reference orbit is computed with, the top limb holds the integer part */
+#ifndef PERTURB_LIMBS
+	#define PERTURB_LIMBS	8
+#endif
+
+/**
+ * Reference orbit of the deep zoom mode. The orbit of the center of the view is iterated once
+ * in fixed point with PERTURB_LIMBS limbs and stored as doubles, every pixel then only iterates
+ * its difference to it in double precision. The orbit ends once it escaped or after 'iters'
+ * iterations.
+ */
+typedef struct {
+    int length;         // Points Z_0 .. Z_{length-1} of the orbit, Z_0 = 0
+    double* z_real;
+    double* z_imag;
+} REF_ORBIT;
+
+/**
+ * Iterate the orbit of the point 'center_real' + 'center_imag' i, given as decimal strings
+ * (e.g. "-0.743643887037158704752191506114774"). Returns NULL if a string is not a number.
+ */
+REF_ORBIT* refOrbitCreate(const char* center_real, const char* center_imag, int iters);
+
+/**
+ * Allocate an empty orbit of 'length' points
+ */
+REF_ORBIT* refOrbitAlloc(int length);
+
+/**
+ * Free the orbit
+ */
+void refOrbitFree(REF_ORBIT* orbit);
+
+/**
+ * Number of iterations until the point at offset 'dc_real' + 'dc_imag' i from the reference
+ * escapes, 'iters' if it does not escape. When the delta grows larger than the point itself the
+ * reference is no longer usable (a glitch), the point is rebased onto the start of the orbit.
+ */
+int computePerturbIterations(const REF_ORBIT* orbit, double dc_real, double dc_imag, int iters);
+
+/**
+ * Make all row, column and count kernels (see mandle_simd.h) iterate against 'orbit', real_min and
+ * imag_min of the kernels are then offsets from the reference point. NULL selects the normal kernels.
+ */
+void setPerturbReference(const REF_ORBIT* orbit);
+
+/**
+ * The orbit set with setPerturbReference, NULL if the deep zoom mode is not active
+ */
+const REF_ORBIT* getPerturbReference();
+
+#if WITH_MPI
+/**
+ * Broadcast the orbit of 'root', the other ranks get a new orbit in '*orbit'
+ */
+void refOrbitBcast(REF_ORBIT** orbit, int root, MPI_Comm comm);
+#endif
+
+#endif // MANDLE_PERTURB_H
\ No newline at end of file
@@ -0,0 +1,809 @@
+/**
+ * Mandlebort implementation over MPI and OpenMP
+ *
+ * Copyright (c) 2012, Moritz Wundke
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the owner nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Moritz Wundke BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+/** Our own includes */
+#include "mandle_precision.h"
+#include "mandle_simd.h"
+#include "mandle_counts.h"
+
+#include <string.h>
+#include <float.h>
+#include <math.h>
+
+#if WITH_SIMD
+	#include <immintrin.h>
+#endif
+
+/** Precision the kernels run with and the origin of the double-double kernels */
+static int precision = PRECISION_DOUBLE;
+static DD_REAL origin_real = { 0, 0 };
+static DD_REAL origin_imag = { 0, 0 };
+
+/**
+ * Double-double arithmetic after Dekker and Knuth, the error of every double operation
+ * is recovered exactly and carried in the low part
+ */
+static inline DD_REAL ddQuickTwoSum(double a, double b) {
+    DD_REAL r;
+    r.hi = a + b;
+    r.lo = b - (r.hi - a);
+    return r;
+}
+
+static inline DD_REAL ddTwoSum(double a, double b) {
+    DD_REAL r;
+    r.hi = a + b;
+    const double v = r.hi - a;
+    r.lo = (a - (r.hi - v)) + (b - v);
+    return r;
+}
+
+static inline DD_REAL ddFromDouble(double a) {
+    DD_REAL r = { a, 0 };
+    return r;
+}
+
+static inline DD_REAL operator+(const DD_REAL& a, const DD_REAL& b) {
+    DD_REAL s = ddTwoSum(a.hi, b.hi);
+    DD_REAL t = ddTwoSum(a.lo, b.lo);
+    s.lo += t.hi;
+    s = ddQuickTwoSum(s.hi, s.lo);
+    s.lo += t.lo;
+    return ddQuickTwoSum(s.hi, s.lo);
+}
+
+static inline DD_REAL operator-(const DD_REAL& a) {
+    DD_REAL r = { -a.hi, -a.lo };
+    return r;
+}
+
+static inline DD_REAL operator-(const DD_REAL& a, const DD_REAL& b) {
+    return a + (-b);
+}
+
+static inline DD_REAL operator*(const DD_REAL& a, const DD_REAL& b) {
+    const double p = a.hi * b.hi;
+    double e = fma(a.hi, b.hi, -p);
+    e += a.hi * b.lo + a.lo * b.hi;
+    return ddQuickTwoSum(p, e);
+}
+
+/**
+ * Divide by a small integer, used to build the fraction of a parsed number
+ */
+static inline DD_REAL ddDivide(const DD_REAL& a, double b) {
+    const double q1 = a.hi / b;
+    const double p = q1 * b;
+    const double e = fma(q1, b, -p);
+    const double q2 = ((a.hi - p) - e + a.lo) / b;
+    return ddQuickTwoSum(q1, q2);
+}
+
+static inline double toDouble(float a) {
+    return a;
+}
+
+static inline double toDouble(double a) {
+    return a;
+}
+
+static inline double toDouble(const DD_REAL& a) {
+    return a.hi;
+}
+
+/**
+ * Coordinate of pixel 'index' 'scale' apart from 'min', double-double coordinates are relative to the origin
+ */
+template <typename REAL>
+static inline REAL pixelCoord(int index, double scale, double min, const DD_REAL&) {
+    return (REAL) (min + ((double) index * scale));
+}
+
+template <>
+inline DD_REAL pixelCoord<DD_REAL>(int index, double scale, double min, const DD_REAL& origin) {
+    DD_REAL offset;
+    offset.hi = (double) index * scale;
+    offset.lo = fma((double) index, scale, -offset.hi);
+    return origin + (ddFromDouble(min) + offset);
+}
+
+/**
+ * Number of iterations until the point escapes, the same loop as computeMandle in any scalar type
+ */
+template <typename REAL>
+static inline int pointIterations(REAL c_real, REAL c_imag, int iters) {
+    // The bulb test only needs double accuracy, points right at its border are the only ones it can get wrong
+    if ( inMainCardioidOrBulb(toDouble(c_real), toDouble(c_imag)) ) {
+        return iters;
+    }
+    REAL z_real = REAL(), z_imag = REAL(), temp;
+#if WITH_PERIODICITY
+    REAL check_real = z_real, check_imag = z_imag;
+    long long check_at = 1;
+#endif
+    int k = 0;
+    double lengthsq;
+    do {
+        temp = z_real*z_real - z_imag*z_imag + c_real;
+        z_imag = (z_real + z_real)*z_imag + c_imag;
+        z_real = temp;
+        lengthsq = toDouble(z_real)*toDouble(z_real) + toDouble(z_imag)*toDouble(z_imag);
+        ++k;
+#if WITH_PERIODICITY
+        if ( lengthsq < SIZE_SQ ) {
+            if ( fabs(toDouble(z_real - check_real)) < PERIODICITY_EPS && fabs(toDouble(z_imag - check_imag)) < PERIODICITY_EPS ) {
+                return iters;
+            }
+            if ( k == check_at ) {
+                check_real = z_real;
+                check_imag = z_imag;
+                check_at <<= 1;
+            }
+        }
+#endif
+    } while (lengthsq < SIZE_SQ && k < iters);
+    return k;
+}
+
+/**
+ * Group function: iteration counts of the first 'num' points of 'c_real' and 'c_imag'.
+ * The vector ones work on a fixed number of lanes, the row, column and count kernels
+ * below fill the points of a group and store the result.
+ */
+template <typename REAL>
+static void groupScalar(const REAL* c_real, const REAL* c_imag, int num, int iters, int* counts) {
+    for (int j = 0; j < num; ++j) {
+        counts[j] = pointIterations<REAL>(c_real[j], c_imag[j], iters);
+    }
+}
+
+template <typename REAL, int GROUP, void (*group)(const REAL*, const REAL*, int, int, int*)>
+static void precisionRow(char *data, int first_col, int num_cols, int row, double scale_real, double scale_imag, int iters, int height, double real_min, double imag_min) {
+    REAL c_real[GROUP], c_imag[GROUP];
+    int counts[GROUP];
+    const REAL imag = pixelCoord<REAL>(height-1-row, scale_imag, imag_min, origin_imag);
+    for (int col = 0; col < num_cols; col += GROUP) {
+        const int num = (num_cols - col < GROUP) ? num_cols - col : GROUP;
+        for (int j = 0; j < num; ++j) {
+            c_real[j] = pixelCoord<REAL>(first_col + col + j, scale_real, real_min, origin_real);
+            c_imag[j] = imag;
+        }
+        group(c_real, c_imag, num, iters, counts);
+        for (int j = 0; j < num; ++j) {
+            data[col + j] = (counts[j] == iters);
+        }
+    }
+}
+
+template <typename REAL, int GROUP, void (*group)(const REAL*, const REAL*, int, int, int*)>
+static void precisionColumn(char *data, int stride, int col, int first_row, int num_rows, double scale_real, double scale_imag, int iters, int height, double real_min, double imag_min) {
+    REAL c_real[GROUP], c_imag[GROUP];
+    int counts[GROUP];
+    const REAL real = pixelCoord<REAL>(col, scale_real, real_min, origin_real);
+    for (int row = 0; row < num_rows; row += GROUP) {
+        const int num = (num_rows - row < GROUP) ? num_rows - row : GROUP;
+        for (int i = 0; i < num; ++i) {
+            c_real[i] = real;
+            c_imag[i] = pixelCoord<REAL>(height-1-(first_row + row + i), scale_imag, imag_min, origin_imag);
+        }
+        group(c_real, c_imag, num, iters, counts);
+        for (int i = 0; i < num; ++i) {
+            data[(long long) (row + i) * stride] = (counts[i] == iters);
+        }
+    }
+}
+
+template <typename REAL, int GROUP, void (*group)(const REAL*, const REAL*, int, int, int*)>
+static void precisionCount(unsigned char *data, int count_bytes, int first_col, int num_cols, int row, double scale_real, double scale_imag, int iters, int height, double real_min, double imag_min) {
+    REAL c_real[GROUP], c_imag[GROUP];
+    int counts[GROUP];
+    const REAL imag = pixelCoord<REAL>(height-1-row, scale_imag, imag_min, origin_imag);
+    for (int col = 0; col < num_cols; col += GROUP) {
+        const int num = (num_cols - col < GROUP) ? num_cols - col : GROUP;
+        for (int j = 0; j < num; ++j) {
+            c_real[j] = pixelCoord<REAL>(first_col + col + j, scale_real, real_min, origin_real);
+            c_imag[j] = imag;
+        }
+        group(c_real, c_imag, num, iters, counts);
+        for (int j = 0; j < num; ++j) {
+            setCount(data, count_bytes, col + j, counts[j]);
+        }
+    }
+}
+
+#if WITH_SIMD
+
+/**
+ * Lanes that start done, past the end of the group or inside the main cardioid or the period-2 bulb.
+ * Those get a full count like pointIterations gives them.
+ */
+template <typename REAL>
+static inline void doneLanes(const REAL* c_real, const REAL* c_imag, int num, int lanes, long long* done) {
+    for (int j = 0; j < lanes; ++j) {
+        done[j] = ( j >= num || inMainCardioidOrBulb(toDouble(c_real[j]), toDouble(c_imag[j])) ) ? -1 : 0;
+    }
+}
+
+/**
+ * AVX2 float, 2 x 8 points per group. Twice the lanes of the double kernel.
+ */
+__attribute__((target("avx2"), optimize("fp-contract=off")))
+static void groupFloatAVX2(const float* c_real, const float* c_imag, int num, int iters, int* counts) {
+    float real[16], imag[16];
+    long long done[16];
+    int done32[16];
+    doneLanes<float>(c_real, c_imag, num, 16, done);
+    for (int j = 0; j < 16; ++j) {
+        real[j] = (j < num) ? c_real[j] : 0;
+        imag[j] = (j < num) ? c_imag[j] : 0;
+        done32[j] = (int) done[j];
+    }
+
+    const __m256 c_real0 = _mm256_loadu_ps(real), c_real1 = _mm256_loadu_ps(real + 8);
+    const __m256 c_imag0 = _mm256_loadu_ps(imag), c_imag1 = _mm256_loadu_ps(imag + 8);
+    const __m256 limit = _mm256_set1_ps(SIZE_SQ);
+    const __m256i iters_v = _mm256_set1_epi32(iters);
+    const __m256i done0 = _mm256_loadu_si256((const __m256i*) done32);
+    const __m256i done1 = _mm256_loadu_si256((const __m256i*) (done32 + 8));
+    __m256 z_real0 = _mm256_setzero_ps(), z_imag0 = _mm256_setzero_ps();
+    __m256 z_real1 = _mm256_setzero_ps(), z_imag1 = _mm256_setzero_ps();
+    __m256 active0 = _mm256_castsi256_ps(_mm256_xor_si256(done0, _mm256_set1_epi32(-1)));
+    __m256 active1 = _mm256_castsi256_ps(_mm256_xor_si256(done1, _mm256_set1_epi32(-1)));
+    __m256i k0 = _mm256_and_si256(done0, iters_v);
+    __m256i k1 = _mm256_and_si256(done1, iters_v);
+#if WITH_PERIODICITY
+    const __m256 eps = _mm256_set1_ps(PERIODICITY_EPS);
+    const __m256 sign = _mm256_set1_ps(-0.0f);
+    __m256 check_real0 = z_real0, check_imag0 = z_imag0;
+    __m256 check_real1 = z_real1, check_imag1 = z_imag1;
+    long long check_at = 1;
+#endif
+
+    for (int i = 0; i < iters && _mm256_movemask_ps(_mm256_or_ps(active0, active1)) != 0; ++i) {
+        __m256 temp0 = _mm256_add_ps(_mm256_sub_ps(_mm256_mul_ps(z_real0, z_real0), _mm256_mul_ps(z_imag0, z_imag0)), c_real0);
+        __m256 temp1 = _mm256_add_ps(_mm256_sub_ps(_mm256_mul_ps(z_real1, z_real1), _mm256_mul_ps(z_imag1, z_imag1)), c_real1);
+        z_imag0 = _mm256_add_ps(_mm256_mul_ps(_mm256_add_ps(z_real0, z_real0), z_imag0), c_imag0);
+        z_imag1 = _mm256_add_ps(_mm256_mul_ps(_mm256_add_ps(z_real1, z_real1), z_imag1), c_imag1);
+        z_real0 = temp0;
+        z_real1 = temp1;
+        __m256 lengthsq0 = _mm256_add_ps(_mm256_mul_ps(z_real0, z_real0), _mm256_mul_ps(z_imag0, z_imag0));
+        __m256 lengthsq1 = _mm256_add_ps(_mm256_mul_ps(z_real1, z_real1), _mm256_mul_ps(z_imag1, z_imag1));
+
+        // Active lanes are all ones, subtracting them counts one iteration
+        k0 = _mm256_sub_epi32(k0, _mm256_castps_si256(active0));
+        k1 = _mm256_sub_epi32(k1, _mm256_castps_si256(active1));
+        active0 = _mm256_and_ps(active0, _mm256_cmp_ps(lengthsq0, limit, _CMP_LT_OQ));
+        active1 = _mm256_and_ps(active1, _mm256_cmp_ps(lengthsq1, limit, _CMP_LT_OQ));
+#if WITH_PERIODICITY
+        __m256 periodic0 = _mm256_and_ps(active0, _mm256_and_ps(
+                _mm256_cmp_ps(_mm256_andnot_ps(sign, _mm256_sub_ps(z_real0, check_real0)), eps, _CMP_LT_OQ),
+                _mm256_cmp_ps(_mm256_andnot_ps(sign, _mm256_sub_ps(z_imag0, check_imag0)), eps, _CMP_LT_OQ)));
+        __m256 periodic1 = _mm256_and_ps(active1, _mm256_and_ps(
+                _mm256_cmp_ps(_mm256_andnot_ps(sign, _mm256_sub_ps(z_real1, check_real1)), eps, _CMP_LT_OQ),
+                _mm256_cmp_ps(_mm256_andnot_ps(sign, _mm256_sub_ps(z_imag1, check_imag1)), eps, _CMP_LT_OQ)));
+        k0 = _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(k0), _mm256_castsi256_ps(iters_v), periodic0));
+        k1 = _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(k1), _mm256_castsi256_ps(iters_v), periodic1));
+        active0 = _mm256_andnot_ps(periodic0, active0);
+        active1 = _mm256_andnot_ps(periodic1, active1);
+        if ( i + 1 == check_at ) {
+            check_real0 = z_real0;
+            check_imag0 = z_imag0;
+            check_real1 = z_real1;
+            check_imag1 = z_imag1;
+            check_at <<= 1;
+        }
+#endif
+    }
+
+    int lanes[16];
+    _mm256_storeu_si256((__m256i*) &lanes[0], k0);
+    _mm256_storeu_si256((__m256i*) &lanes[8], k1);
+    memcpy(counts, lanes, num * sizeof(int));
+}
+
+/**
+ * AVX2 double-double operations on 4 lanes, hi and lo parts in separate registers
+ */
+__attribute__((target("avx2,fma"), optimize("fp-contract=off")))
+static inline void ddQuickTwoSumAVX2(__m256d a, __m256d b, __m256d* hi, __m256d* lo) {
+    *hi = _mm256_add_pd(a, b);
+    *lo = _mm256_sub_pd(b, _mm256_sub_pd(*hi, a));
+}
+
+__attribute__((target("avx2,fma"), optimize("fp-contract=off")))
+static inline void ddAddAVX2(__m256d a_hi, __m256d a_lo, __m256d b_hi, __m256d b_lo, __m256d* hi, __m256d* lo) {
+    __m256d s = _mm256_add_pd(a_hi, b_hi);
+    __m256d v = _mm256_sub_pd(s, a_hi);
+    __m256d e = _mm256_add_pd(_mm256_sub_pd(a_hi, _mm256_sub_pd(s, v)), _mm256_sub_pd(b_hi, v));
+    __m256d t = _mm256_add_pd(a_lo, b_lo);
+    __m256d w = _mm256_sub_pd(t, a_lo);
+    __m256d f = _mm256_add_pd(_mm256_sub_pd(a_lo, _mm256_sub_pd(t, w)), _mm256_sub_pd(b_lo, w));
+    ddQuickTwoSumAVX2(s, _mm256_add_pd(e, t), &s, &e);
+    ddQuickTwoSumAVX2(s, _mm256_add_pd(e, f), hi, lo);
+}
+
+__attribute__((target("avx2,fma"), optimize("fp-contract=off")))
+static inline void ddMulAVX2(__m256d a_hi, __m256d a_lo, __m256d b_hi, __m256d b_lo, __m256d* hi, __m256d* lo) {
+    __m256d p = _mm256_mul_pd(a_hi, b_hi);
+    __m256d e = _mm256_fmsub_pd(a_hi, b_hi, p);
+    e = _mm256_add_pd(e, _mm256_add_pd(_mm256_mul_pd(a_hi, b_lo), _mm256_mul_pd(a_lo, b_hi)));
+    ddQuickTwoSumAVX2(p, e, hi, lo);
+}
+
+/**
+ * One iteration of 4 double-double lanes, the same steps as pointIterations
+ */
+__attribute__((target("avx2,fma"), optimize("fp-contract=off")))
+static inline __m256d ddStepAVX2(__m256d* z_real_hi, __m256d* z_real_lo, __m256d* z_imag_hi, __m256d* z_imag_lo,
+                                 __m256d c_real_hi, __m256d c_real_lo, __m256d c_imag_hi, __m256d c_imag_lo) {
+    const __m256d sign = _mm256_set1_pd(-0.0);
+    __m256d real_sq_hi, real_sq_lo, imag_sq_hi, imag_sq_lo, temp_hi, temp_lo;
+    ddMulAVX2(*z_real_hi, *z_real_lo, *z_real_hi, *z_real_lo, &real_sq_hi, &real_sq_lo);
+    ddMulAVX2(*z_imag_hi, *z_imag_lo, *z_imag_hi, *z_imag_lo, &imag_sq_hi, &imag_sq_lo);
+    ddAddAVX2(real_sq_hi, real_sq_lo, _mm256_xor_pd(imag_sq_hi, sign), _mm256_xor_pd(imag_sq_lo, sign), &temp_hi, &temp_lo);
+    ddAddAVX2(temp_hi, temp_lo, c_real_hi, c_real_lo, &temp_hi, &temp_lo);
+
+    // 2 z_real is exact, doubling both parts
+    ddMulAVX2(_mm256_add_pd(*z_real_hi, *z_real_hi), _mm256_add_pd(*z_real_lo, *z_real_lo), *z_imag_hi, *z_imag_lo, z_imag_hi, z_imag_lo);
+    ddAddAVX2(*z_imag_hi, *z_imag_lo, c_imag_hi, c_imag_lo, z_imag_hi, z_imag_lo);
+    *z_real_hi = temp_hi;
+    *z_real_lo = temp_lo;
+    return _mm256_add_pd(_mm256_mul_pd(*z_real_hi, *z_real_hi), _mm256_mul_pd(*z_imag_hi, *z_imag_hi));
+}
+
+/**
+ * AVX2 double-double, 2 x 4 points per group
+ */
+__attribute__((target("avx2,fma"), optimize("fp-contract=off")))
+static void groupDDAVX2(const DD_REAL* c_real, const DD_REAL* c_imag, int num, int iters, int* counts) {
+    double real_hi[8], real_lo[8], imag_hi[8], imag_lo[8];
+    long long done[8];
+    doneLanes<DD_REAL>(c_real, c_imag, num, 8, done);
+    for (int j = 0; j < 8; ++j) {
+        real_hi[j] = (j < num) ? c_real[j].hi : 0;
+        real_lo[j] = (j < num) ? c_real[j].lo : 0;
+        imag_hi[j] = (j < num) ? c_imag[j].hi : 0;
+        imag_lo[j] = (j < num) ? c_imag[j].lo : 0;
+    }
+
+    const __m256d c_real_hi0 = _mm256_loadu_pd(real_hi), c_real_hi1 = _mm256_loadu_pd(real_hi + 4);
+    const __m256d c_real_lo0 = _mm256_loadu_pd(real_lo), c_real_lo1 = _mm256_loadu_pd(real_lo + 4);
+    const __m256d c_imag_hi0 = _mm256_loadu_pd(imag_hi), c_imag_hi1 = _mm256_loadu_pd(imag_hi + 4);
+    const __m256d c_imag_lo0 = _mm256_loadu_pd(imag_lo), c_imag_lo1 = _mm256_loadu_pd(imag_lo + 4);
+    const __m256d limit = _mm256_set1_pd(SIZE_SQ);
+    const __m256i iters_v = _mm256_set1_epi64x(iters);
+    const __m256i done0 = _mm256_loadu_si256((const __m256i*) done);
+    const __m256i done1 = _mm256_loadu_si256((const __m256i*) (done + 4));
+    __m256d z_real_hi0 = _mm256_setzero_pd(), z_real_lo0 = _mm256_setzero_pd(), z_imag_hi0 = _mm256_setzero_pd(), z_imag_lo0 = _mm256_setzero_pd();
+    __m256d z_real_hi1 = _mm256_setzero_pd(), z_real_lo1 = _mm256_setzero_pd(), z_imag_hi1 = _mm256_setzero_pd(), z_imag_lo1 = _mm256_setzero_pd();
+    __m256d active0 = _mm256_castsi256_pd(_mm256_xor_si256(done0, _mm256_set1_epi32(-1)));
+    __m256d active1 = _mm256_castsi256_pd(_mm256_xor_si256(done1, _mm256_set1_epi32(-1)));
+    __m256i k0 = _mm256_and_si256(done0, iters_v);
+    __m256i k1 = _mm256_and_si256(done1, iters_v);
+#if WITH_PERIODICITY
+    const __m256d eps = _mm256_set1_pd(PERIODICITY_EPS);
+    const __m256d sign = _mm256_set1_pd(-0.0);
+    __m256d check_real0 = z_real_hi0, check_imag0 = z_imag_hi0;
+    __m256d check_real1 = z_real_hi1, check_imag1 = z_imag_hi1;
+    long long check_at = 1;
+#endif
+
+    for (int i = 0; i < iters && _mm256_movemask_pd(_mm256_or_pd(active0, active1)) != 0; ++i) {
+        __m256d lengthsq0 = ddStepAVX2(&z_real_hi0, &z_real_lo0, &z_imag_hi0, &z_imag_lo0, c_real_hi0, c_real_lo0, c_imag_hi0, c_imag_lo0);
+        __m256d lengthsq1 = ddStepAVX2(&z_real_hi1, &z_real_lo1, &z_imag_hi1, &z_imag_lo1, c_real_hi1, c_real_lo1, c_imag_hi1, c_imag_lo1);
+
+        k0 = _mm256_sub_epi64(k0, _mm256_castpd_si256(active0));
+        k1 = _mm256_sub_epi64(k1, _mm256_castpd_si256(active1));
+        active0 = _mm256_and_pd(active0, _mm256_cmp_pd(lengthsq0, limit, _CMP_LT_OQ));
+        active1 = _mm256_and_pd(active1, _mm256_cmp_pd(lengthsq1, limit, _CMP_LT_OQ));
+#if WITH_PERIODICITY
+        // The high parts are close enough to tell a cycle
+        __m256d periodic0 = _mm256_and_pd(active0, _mm256_and_pd(
+                _mm256_cmp_pd(_mm256_andnot_pd(sign, _mm256_sub_pd(z_real_hi0, check_real0)), eps, _CMP_LT_OQ),
+                _mm256_cmp_pd(_mm256_andnot_pd(sign, _mm256_sub_pd(z_imag_hi0, check_imag0)), eps, _CMP_LT_OQ)));
+        __m256d periodic1 = _mm256_and_pd(active1, _mm256_and_pd(
+                _mm256_cmp_pd(_mm256_andnot_pd(sign, _mm256_sub_pd(z_real_hi1, check_real1)), eps, _CMP_LT_OQ),
+                _mm256_cmp_pd(_mm256_andnot_pd(sign, _mm256_sub_pd(z_imag_hi1, check_imag1)), eps, _CMP_LT_OQ)));
+        k0 = _mm256_castpd_si256(_mm256_blendv_pd(_mm256_castsi256_pd(k0), _mm256_castsi256_pd(iters_v), periodic0));
+        k1 = _mm256_castpd_si256(_mm256_blendv_pd(_mm256_castsi256_pd(k1), _mm256_castsi256_pd(iters_v), periodic1));
+        active0 = _mm256_andnot_pd(periodic0, active0);
+        active1 = _mm256_andnot_pd(periodic1, active1);
+        if ( i + 1 == check_at ) {
+            check_real0 = z_real_hi0;
+            check_imag0 = z_imag_hi0;
+            check_real1 = z_real_hi1;
+            check_imag1 = z_imag_hi1;
+            check_at <<= 1;
+        }
+#endif
+    }
+
+    long long lanes[8];
+    _mm256_storeu_si256((__m256i*) &lanes[0], k0);
+    _mm256_storeu_si256((__m256i*) &lanes[4], k1);
+    for (int j = 0; j < num; ++j) {
+        counts[j] = (int) lanes[j];
+    }
+}
+
+/**
+ * AVX-512 float, 2 x 16 points per group
+ */
+__attribute__((target("avx512f"), optimize("fp-contract=off")))
+static void groupFloatAVX512(const float* c_real, const float* c_imag, int num, int iters, int* counts) {
+    float real[32], imag[32];
+    long long done[32];
+    doneLanes<float>(c_real, c_imag, num, 32, done);
+    __mmask16 active0 = 0, active1 = 0;
+    for (int j = 0; j < 32; ++j) {
+        real[j] = (j < num) ? c_real[j] : 0;
+        imag[j] = (j < num) ? c_imag[j] : 0;
+        if ( done[j] == 0 ) {
+            if ( j < 16 )
+                active0 |= (__mmask16) (1 << j);
+            else
+                active1 |= (__mmask16) (1 << (j - 16));
+        }
+    }
+
+    const __m512 c_real0 = _mm512_loadu_ps(real), c_real1 = _mm512_loadu_ps(real + 16);
+    const __m512 c_imag0 = _mm512_loadu_ps(imag), c_imag1 = _mm512_loadu_ps(imag + 16);
+    const __m512 limit = _mm512_set1_ps(SIZE_SQ);
+    const __m512i one = _mm512_set1_epi32(1);
+    const __m512i iters_v = _mm512_set1_epi32(iters);
+    __m512 z_real0 = _mm512_setzero_ps(), z_imag0 = _mm512_setzero_ps();
+    __m512 z_real1 = _mm512_setzero_ps(), z_imag1 = _mm512_setzero_ps();
+    __m512i k0 = _mm512_maskz_mov_epi32((__mmask16) ~active0, iters_v);
+    __m512i k1 = _mm512_maskz_mov_epi32((__mmask16) ~active1, iters_v);
+#if WITH_PERIODICITY
+    const __m512 eps = _mm512_set1_ps(PERIODICITY_EPS);
+    __m512 check_real0 = z_real0, check_imag0 = z_imag0;
+    __m512 check_real1 = z_real1, check_imag1 = z_imag1;
+    long long check_at = 1;
+#endif
+
+    for (int i = 0; i < iters && (active0 | active1) != 0; ++i) {
+        __m512 temp0 = _mm512_add_ps(_mm512_sub_ps(_mm512_mul_ps(z_real0, z_real0), _mm512_mul_ps(z_imag0, z_imag0)), c_real0);
+        __m512 temp1 = _mm512_add_ps(_mm512_sub_ps(_mm512_mul_ps(z_real1, z_real1), _mm512_mul_ps(z_imag1, z_imag1)), c_real1);
+        z_imag0 = _mm512_add_ps(_mm512_mul_ps(_mm512_add_ps(z_real0, z_real0), z_imag0), c_imag0);
+        z_imag1 = _mm512_add_ps(_mm512_mul_ps(_mm512_add_ps(z_real1, z_real1), z_imag1), c_imag1);
+        z_real0 = temp0;
+        z_real1 = temp1;
+        __m512 lengthsq0 = _mm512_add_ps(_mm512_mul_ps(z_real0, z_real0), _mm512_mul_ps(z_imag0, z_imag0));
+        __m512 lengthsq1 = _mm512_add_ps(_mm512_mul_ps(z_real1, z_real1), _mm512_mul_ps(z_imag1, z_imag1));
+
+        k0 = _mm512_mask_add_epi32(k0, active0, k0, one);
+        k1 = _mm512_mask_add_epi32(k1, active1, k1, one);
+        active0 = _mm512_mask_cmp_ps_mask(active0, lengthsq0, limit, _CMP_LT_OQ);
+        active1 = _mm512_mask_cmp_ps_mask(active1, lengthsq1, limit, _CMP_LT_OQ);
+#if WITH_PERIODICITY
+        __mmask16 periodic0 = _mm512_mask_cmp_ps_mask(
+                _mm512_mask_cmp_ps_mask(active0, _mm512_abs_ps(_mm512_sub_ps(z_real0, check_real0)), eps, _CMP_LT_OQ),
+                _mm512_abs_ps(_mm512_sub_ps(z_imag0, check_imag0)), eps, _CMP_LT_OQ);
+        __mmask16 periodic1 = _mm512_mask_cmp_ps_mask(
+                _mm512_mask_cmp_ps_mask(active1, _mm512_abs_ps(_mm512_sub_ps(z_real1, check_real1)), eps, _CMP_LT_OQ),
+                _mm512_abs_ps(_mm512_sub_ps(z_imag1, check_imag1)), eps, _CMP_LT_OQ);
+        k0 = _mm512_mask_mov_epi32(k0, periodic0, iters_v);
+        k1 = _mm512_mask_mov_epi32(k1, periodic1, iters_v);
+        active0 &= (__mmask16) ~periodic0;
+        active1 &= (__mmask16) ~periodic1;
+        if ( i + 1 == check_at ) {
+            check_real0 = z_real0;
+            check_imag0 = z_imag0;
+            check_real1 = z_real1;
+            check_imag1 = z_imag1;
+            check_at <<= 1;
+        }
+#endif
+    }
+
+    int lanes[32];
+    _mm512_storeu_si512((void*) &lanes[0], k0);
+    _mm512_storeu_si512((void*) &lanes[16], k1);
+    memcpy(counts, lanes, num * sizeof(int));
+}
+
+/**
+ * AVX-512 double-double operations on 8 lanes
+ */
+__attribute__((target("avx512f"), optimize("fp-contract=off")))
+static inline void ddQuickTwoSumAVX512(__m512d a, __m512d b, __m512d* hi, __m512d* lo) {
+    *hi = _mm512_add_pd(a, b);
+    *lo = _mm512_sub_pd(b, _mm512_sub_pd(*hi, a));
+}
+
+__attribute__((target("avx512f"), optimize("fp-contract=off")))
+static inline void ddAddAVX512(__m512d a_hi, __m512d a_lo, __m512d b_hi, __m512d b_lo, __m512d* hi, __m512d* lo) {
+    __m512d s = _mm512_add_pd(a_hi, b_hi);
+    __m512d v = _mm512_sub_pd(s, a_hi);
+    __m512d e = _mm512_add_pd(_mm512_sub_pd(a_hi, _mm512_sub_pd(s, v)), _mm512_sub_pd(b_hi, v));
+    __m512d t = _mm512_add_pd(a_lo, b_lo);
+    __m512d w = _mm512_sub_pd(t, a_lo);
+    __m512d f = _mm512_add_pd(_mm512_sub_pd(a_lo, _mm512_sub_pd(t, w)), _mm512_sub_pd(b_lo, w));
+    ddQuickTwoSumAVX512(s, _mm512_add_pd(e, t), &s, &e);
+    ddQuickTwoSumAVX512(s, _mm512_add_pd(e, f), hi, lo);
+}
+
+__attribute__((target("avx512f"), optimize("fp-contract=off")))
+static inline void ddMulAVX512(__m512d a_hi, __m512d a_lo, __m512d b_hi, __m512d b_lo, __m512d* hi, __m512d* lo) {
+    __m512d p = _mm512_mul_pd(a_hi, b_hi);
+    __m512d e = _mm512_fmsub_pd(a_hi, b_hi, p);
+    e = _mm512_add_pd(e, _mm512_add_pd(_mm512_mul_pd(a_hi, b_lo), _mm512_mul_pd(a_lo, b_hi)));
+    ddQuickTwoSumAVX512(p, e, hi, lo);
+}
+
+__attribute__((target("avx512f"), optimize("fp-contract=off")))
+static inline __m512d ddStepAVX512(__m512d* z_real_hi, __m512d* z_real_lo, __m512d* z_imag_hi, __m512d* z_imag_lo,
+                                   __m512d c_real_hi, __m512d c_real_lo, __m512d c_imag_hi, __m512d c_imag_lo) {
+    __m512d real_sq_hi, real_sq_lo, imag_sq_hi, imag_sq_lo, temp_hi, temp_lo;
+    ddMulAVX512(*z_real_hi, *z_real_lo, *z_real_hi, *z_real_lo, &real_sq_hi, &real_sq_lo);
+    ddMulAVX512(*z_imag_hi, *z_imag_lo, *z_imag_hi, *z_imag_lo, &imag_sq_hi, &imag_sq_lo);
+    ddAddAVX512(real_sq_hi, real_sq_lo, _mm512_sub_pd(_mm512_setzero_pd(), imag_sq_hi), _mm512_sub_pd(_mm512_setzero_pd(), imag_sq_lo), &temp_hi, &temp_lo);
+    ddAddAVX512(temp_hi, temp_lo, c_real_hi, c_real_lo, &temp_hi, &temp_lo);
+    ddMulAVX512(_mm512_add_pd(*z_real_hi, *z_real_hi), _mm512_add_pd(*z_real_lo, *z_real_lo), *z_imag_hi, *z_imag_lo, z_imag_hi, z_imag_lo);
+    ddAddAVX512(*z_imag_hi, *z_imag_lo, c_imag_hi, c_imag_lo, z_imag_hi, z_imag_lo);
+    *z_real_hi = temp_hi;
+    *z_real_lo = temp_lo;
+    return _mm512_add_pd(_mm512_mul_pd(*z_real_hi, *z_real_hi), _mm512_mul_pd(*z_imag_hi, *z_imag_hi));
+}
+
+/**
+ * AVX-512 double-double, 2 x 8 points per group
+ */
+__attribute__((target("avx512f"), optimize("fp-contract=off")))
+static void groupDDAVX512(const DD_REAL* c_real, const DD_REAL* c_imag, int num, int iters, int* counts) {
+    double real_hi[16], real_lo[16], imag_hi[16], imag_lo[16];
+    long long done[16];
+    doneLanes<DD_REAL>(c_real, c_imag, num, 16, done);
+    __mmask8 active0 = 0, active1 = 0;
+    for (int j = 0; j < 16; ++j) {
+        real_hi[j] = (j < num) ? c_real[j].hi : 0;
+        real_lo[j] = (j < num) ? c_real[j].lo : 0;
+        imag_hi[j] = (j < num) ? c_imag[j].hi : 0;
+        imag_lo[j] = (j < num) ? c_imag[j].lo : 0;
+        if ( done[j] == 0 ) {
+            if ( j < 8 )
+                active0 |= (__mmask8) (1 << j);
+            else
+                active1 |= (__mmask8) (1 << (j - 8));
+        }
+    }
+
+    const __m512d c_real_hi0 = _mm512_loadu_pd(real_hi), c_real_hi1 = _mm512_loadu_pd(real_hi + 8);
+    const __m512d c_real_lo0 = _mm512_loadu_pd(real_lo), c_real_lo1 = _mm512_loadu_pd(real_lo + 8);
+    const __m512d c_imag_hi0 = _mm512_loadu_pd(imag_hi), c_imag_hi1 = _mm512_loadu_pd(imag_hi + 8);
+    const __m512d c_imag_lo0 = _mm512_loadu_pd(imag_lo), c_imag_lo1 = _mm512_loadu_pd(imag_lo + 8);
+    const __m512d limit = _mm512_set1_pd(SIZE_SQ);
+    const __m512i one = _mm512_set1_epi64(1);
+    const __m512i iters_v = _mm512_set1_epi64(iters);
+    __m512d z_real_hi0 = _mm512_setzero_pd(), z_real_lo0 = _mm512_setzero_pd(), z_imag_hi0 = _mm512_setzero_pd(), z_imag_lo0 = _mm512_setzero_pd();
+    __m512d z_real_hi1 = _mm512_setzero_pd(), z_real_lo1 = _mm512_setzero_pd(), z_imag_hi1 = _mm512_setzero_pd(), z_imag_lo1 = _mm512_setzero_pd();
+    __m512i k0 = _mm512_maskz_mov_epi64((__mmask8) ~active0, iters_v);
+    __m512i k1 = _mm512_maskz_mov_epi64((__mmask8) ~active1, iters_v);
+#if WITH_PERIODICITY
+    const __m512d eps = _mm512_set1_pd(PERIODICITY_EPS);
+    __m512d check_real0 = z_real_hi0, check_imag0 = z_imag_hi0;
+    __m512d check_real1 = z_real_hi1, check_imag1 = z_imag_hi1;
+    long long check_at = 1;
+#endif
+
+    for (int i = 0; i < iters && (active0 | active1) != 0; ++i) {
+        __m512d lengthsq0 = ddStepAVX512(&z_real_hi0, &z_real_lo0, &z_imag_hi0, &z_imag_lo0, c_real_hi0, c_real_lo0, c_imag_hi0, c_imag_lo0);
+        __m512d lengthsq1 = ddStepAVX512(&z_real_hi1, &z_real_lo1, &z_imag_hi1, &z_imag_lo1, c_real_hi1, c_real_lo1, c_imag_hi1, c_imag_lo1);
+
+        k0 = _mm512_mask_add_epi64(k0, active0, k0, one);
+        k1 = _mm512_mask_add_epi64(k1, active1, k1, one);
+        active0 = _mm512_mask_cmp_pd_mask(active0, lengthsq0, limit, _CMP_LT_OQ);
+        active1 = _mm512_mask_cmp_pd_mask(active1, lengthsq1, limit, _CMP_LT_OQ);
+#if WITH_PERIODICITY
+        __mmask8 periodic0 = _mm512_mask_cmp_pd_mask(
+                _mm512_mask_cmp_pd_mask(active0, _mm512_abs_pd(_mm512_sub_pd(z_real_hi0, check_real0)), eps, _CMP_LT_OQ),
+                _mm512_abs_pd(_mm512_sub_pd(z_imag_hi0, check_imag0)), eps, _CMP_LT_OQ);
+        __mmask8 periodic1 = _mm512_mask_cmp_pd_mask(
+                _mm512_mask_cmp_pd_mask(active1, _mm512_abs_pd(_mm512_sub_pd(z_real_hi1, check_real1)), eps, _CMP_LT_OQ),
+                _mm512_abs_pd(_mm512_sub_pd(z_imag_hi1, check_imag1)), eps, _CMP_LT_OQ);
+        k0 = _mm512_mask_mov_epi64(k0, periodic0, iters_v);
+        k1 = _mm512_mask_mov_epi64(k1, periodic1, iters_v);
+        active0 &= (__mmask8) ~periodic0;
+        active1 &= (__mmask8) ~periodic1;
+        if ( i + 1 == check_at ) {
+            check_real0 = z_real_hi0;
+            check_imag0 = z_imag_hi0;
+            check_real1 = z_real_hi1;
+            check_imag1 = z_imag_hi1;
+            check_at <<= 1;
+        }
+#endif
+    }
+
+    long long lanes[16];
+    _mm512_storeu_si512((void*) &lanes[0], k0);
+    _mm512_storeu_si512((void*) &lanes[8], k1);
+    for (int j = 0; j < num; ++j) {
+        counts[j] = (int) lanes[j];
+    }
+}
+
+#endif // WITH_SIMD
+
+/**
+ * Pick the cheapest precision fine enough for the pixel spacing
+ */
+int choosePrecision(double spacing, double magnitude, int max_precision) {
+    const char* forced = getenv("MANDLE_PRECISION");
+    if ( forced != NULL ) {
+        for (int p = PRECISION_FLOAT; p <= PRECISION_PERTURB; ++p) {
+            if ( strcmp(forced, getPrecisionName(p)) == 0 ) {
+                if ( p > max_precision ) {
+                    ERROR("MANDLE_PRECISION='%s' needs a center, using '%s'\n", forced, getPrecisionName(max_precision));
+                    return max_precision;
+                }
+                return p;
+            }
+        }
+        ERROR("MANDLE_PRECISION='%s' not valid, picking one\n", forced);
+    }
+
+    // Relative resolution of each type, the double-double one is that of a 106 bit mantissa
+    static const double epsilon[] = { FLT_EPSILON, DBL_EPSILON, DBL_EPSILON * DBL_EPSILON };
+    if ( magnitude < SIZE )
+        magnitude = SIZE;
+    for (int p = PRECISION_FLOAT; p < max_precision && p <= PRECISION_DD; ++p) {
+        if ( spacing >= epsilon[p] * magnitude * PRECISION_ULPS )
+            return p;
+    }
+    return max_precision;
+}
+
+/**
+ * Name of a precision
+ */
+const char* getPrecisionName(int precision) {
+    static const char* names[] = { "float", "double", "dd", "perturb" };
+    return (precision >= PRECISION_FLOAT && precision <= PRECISION_PERTURB) ? names[precision] : "unknown";
+}
+
+/**
+ * Parse a decimal number with an optional exponent into a double-double
+ */
+bool ddParse(DD_REAL* value, const char* text) {
+    DD_REAL r = ddFromDouble(0);
+    const DD_REAL ten = ddFromDouble(10);
+    bool negative = (*text == '-');
+    if ( *text == '-' || *text == '+' )
+        ++text;
+
+    const char* digits = text;
+    while ( *text >= '0' && *text <= '9' ) {
+        r = r * ten + ddFromDouble(*text++ - '0');
+    }
+
+    // The fraction is built from its last digit up, like the fixed point parser of mandle_perturb
+    if ( *text == '.' ) {
+        const char* first = ++text;
+        while ( *text >= '0' && *text <= '9' ) {
+            ++text;
+        }
+        DD_REAL fraction = ddFromDouble(0);
+        for (const char* digit = text - 1; digit >= first; --digit) {
+            fraction = ddDivide(fraction + ddFromDouble(*digit - '0'), 10);
+        }
+        r = r + fraction;
+        if ( text == first && first - 1 == digits )
+            return false;
+    } else if ( text == digits ) {
+        return false;
+    }
+
+    if ( *text == 'e' || *text == 'E' ) {
+        char* end;
+        long exponent = strtol(text + 1, &end, 10);
+        if ( end == text + 1 )
+            return false;
+        text = end;
+        for (; exponent > 0; --exponent) {
+            r = r * ten;
+        }
+        for (; exponent < 0; ++exponent) {
+            r = ddDivide(r, 10);
+        }
+    }
+    *value = negative ? -r : r;
+    return *text == '\0';
+}
+
+/**
+ * Install the kernels of a precision
+ */
+void setPrecision(int new_precision) {
+    // Go back to the normal kernels first, their name tells which vector units we may use
+    setMandleKernels(NULL, NULL, NULL, NULL);
+    precision = new_precision;
+#if WITH_SIMD
+    const char* simd = getMandleRowKernelName();
+    const bool avx512 = strcmp(simd, "avx512") == 0;
+    const bool avx2 = avx512 || strcmp(simd, "avx2") == 0;
+    if ( precision == PRECISION_FLOAT && avx512 ) {
+        setMandleKernels(precisionRow<float, 32, groupFloatAVX512>, precisionColumn<float, 32, groupFloatAVX512>,
+                         precisionCount<float, 32, groupFloatAVX512>, "float avx512");
+        return;
+    }
+    if ( precision == PRECISION_DD && avx512 ) {
+        setMandleKernels(precisionRow<DD_REAL, 16, groupDDAVX512>, precisionColumn<DD_REAL, 16, groupDDAVX512>,
+                         precisionCount<DD_REAL, 16, groupDDAVX512>, "dd avx512");
+        return;
+    }
+    if ( precision == PRECISION_FLOAT && avx2 ) {
+        setMandleKernels(precisionRow<float, 16, groupFloatAVX2>, precisionColumn<float, 16, groupFloatAVX2>,
+                         precisionCount<float, 16, groupFloatAVX2>, "float avx2");
+        return;
+    }
+    if ( precision == PRECISION_DD && avx2 && __builtin_cpu_supports("fma") ) {
+        setMandleKernels(precisionRow<DD_REAL, 8, groupDDAVX2>, precisionColumn<DD_REAL, 8, groupDDAVX2>,
+                         precisionCount<DD_REAL, 8, groupDDAVX2>, "dd avx2");
+        return;
+    }
+#endif
+    if ( precision == PRECISION_FLOAT ) {
+        setMandleKernels(precisionRow<float, 8, groupScalar<float> >, precisionColumn<float, 8, groupScalar<float> >,
+                         precisionCount<float, 8, groupScalar<float> >, "float scalar");
+    } else if ( precision == PRECISION_DD ) {
+        setMandleKernels(precisionRow<DD_REAL, 8, groupScalar<DD_REAL> >, precisionColumn<DD_REAL, 8, groupScalar<DD_REAL> >,
+                         precisionCount<DD_REAL, 8, groupScalar<DD_REAL> >, "dd scalar");
+    }
+}
+
+/**
+ * The precision set with setPrecision
+ */
+int getPrecision() {
+    return precision;
+}
+
+/**
+ * Origin of the double-double kernels
+ */
+void setPrecisionOrigin(const DD_REAL* real, const DD_REAL* imag) {
+    origin_real = *real;
+    origin_imag = *imag;
+}
+
+/**
+ * Iterations of a single point in the current precision
+ */
+int computePrecisionIterations(double real, double imag, int iters) {
+    if ( precision == PRECISION_FLOAT ) {
+        return pointIterations<float>((float) real, (float) imag, iters);
+    }
+    if ( precision == PRECISION_DD ) {
+        return pointIterations<DD_REAL>(pixelCoord<DD_REAL>(0, 0, real, origin_real), pixelCoord<DD_REAL>(0, 0, imag, origin_imag), iters);
+    }
+    return computeMandleIterations(real, imag, iters);
+}
\ No newline at end of file
@@ -0,0 +1,97 @@
+/**
+ * Mandlebort implementation over MPI and OpenMP
+ *
+ * Copyright (c) 2012, Moritz Wundke
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the owner nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Moritz Wundke BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+#ifndef MANDLE_PRECISION_H
+#define MANDLE_PRECISION_H
+
+/** Our own includes */
+#include "mandle_utils.h"
+
+/** Scalar types the kernels can iterate with, from the cheapest to the most accurate */
+#define PRECISION_FLOAT		0
+#define PRECISION_DOUBLE	1
+#define PRECISION_DD		2
+#define PRECISION_PERTURB	3
+
+/** A precision is used while the pixel spacing is at least this many of its ulps at the largest coordinate */
+#ifndef PRECISION_ULPS
+	#define PRECISION_ULPS	1024
+#endif
+
+/**
+ * Double-double number, the unevaluated sum hi + lo with |lo| at most half an ulp of hi.
+ * Gives about 106 bits of mantissa at a few times the cost of a double.
+ */
+typedef struct {
+    double hi;
+    double lo;
+} DD_REAL;
+
+/**
+ * Pick the cheapest precision whose resolution is fine enough for pixels 'spacing' apart at coordinates
+ * up to 'magnitude', but not above 'max_precision'. MANDLE_PRECISION (float, double, dd or perturb)
+ * in the environment forces one.
+ */
+int choosePrecision(double spacing, double magnitude, int max_precision);
+
+/**
+ * Name of a precision
+ */
+const char* getPrecisionName(int precision);
+
+/**
+ * Parse a decimal number with an optional exponent into a double-double, returns false if it is not one
+ */
+bool ddParse(DD_REAL* value, const char* text);
+
+/**
+ * Make the row, column and count kernels (see mandle_simd.h) iterate in 'precision', PRECISION_DOUBLE
+ * selects the normal kernels. The perturbation mode is set up with setPerturbReference instead.
+ */
+void setPrecision(int precision);
+
+/**
+ * The precision set with setPrecision
+ */
+int getPrecision();
+
+/**
+ * Point the double-double kernels get their real_min and imag_min relative to, so a view can be
+ * centered with more digits than a double holds. Zero unless set.
+ */
+void setPrecisionOrigin(const DD_REAL* real, const DD_REAL* imag);
+
+/**
+ * Number of iterations until the point escapes in the precision set with setPrecision,
+ * 'iters' if it does not escape
+ */
+int computePrecisionIterations(double real, double imag, int iters);
+
+#endif // MANDLE_PRECISION_H
\ No newline at end of file
@@ -0,0 +1,233 @@
+/**
+ * Mandlebort implementation over MPI and OpenMP
+ *
+ * Copyright (c) 2012, Moritz Wundke
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the owner nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Moritz Wundke BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+/** Our own includes */
+#include "mandle_progressive.h"
+#include "mandle_simd.h"
+
+#include <string.h>
+
+/**
+ * Samples of a row or column of 'size' points, 'step' points apart
+ */
+static int numSamples(int size, int step) {
+    return (size + step - 1) / step;
+}
+
+/**
+ * Locate a work item: its level, whether it is a row, its row or column in the image,
+ * the distance of its samples and their number
+ */
+static void progressiveItem(const PROGRESSIVE* progressive, int item, int* level, bool* is_row, int* index, int* step, int* num) {
+    int l = 0;
+    while ( l < PROGRESSIVE_LEVELS-1 && item >= progressive->first_item[l+1] ) {
+        ++l;
+    }
+    int k = item - progressive->first_item[l];
+    int s = progressiveStep(l);
+    int coarse = s * PROGRESSIVE_FACTOR;
+    int per_block = PROGRESSIVE_FACTOR - 1;
+    *level = l;
+    if ( k < progressive->num_rows[l] ) {
+        // Rows of the level, counted from the bottom. Apart from the coarsest level the ones on the coarser grid are skipped.
+        int flipped = (l == 0) ? k * s : (k / per_block) * coarse + (k % per_block + 1) * s;
+        *is_row = true;
+        *index = progressive->height - 1 - flipped;
+        *step = s;
+        *num = numSamples(progressive->width, s);
+    } else {
+        // Columns not on the coarser grid, sampled on the rows of the coarser grid
+        k -= progressive->num_rows[l];
+        *is_row = false;
+        *index = (k / per_block) * coarse + (k % per_block + 1) * s;
+        *step = coarse;
+        *num = numSamples(progressive->height, coarse);
+    }
+}
+
+/**
+ * Create the levels of a 'width' x 'height' image
+ */
+PROGRESSIVE* progressiveCreate(int width, int height, bool collect) {
+    PROGRESSIVE* progressive = (PROGRESSIVE*)malloc(sizeof(*progressive));
+    progressive->width = width;
+    progressive->height = height;
+    progressive->first_item[0] = 0;
+    for (int l = 0; l < PROGRESSIVE_LEVELS; ++l) {
+        int s = progressiveStep(l);
+        int num_cols = 0;
+        progressive->num_rows[l] = numSamples(height, s);
+        if ( l > 0 ) {
+            progressive->num_rows[l] -= numSamples(height, s * PROGRESSIVE_FACTOR);
+            num_cols = numSamples(width, s) - numSamples(width, s * PROGRESSIVE_FACTOR);
+        }
+        progressive->items_left[l] = progressive->num_rows[l] + num_cols;
+        progressive->first_item[l+1] = progressive->first_item[l] + progressive->items_left[l];
+    }
+    progressive->next_level = 0;
+    progressive->image = collect ? (char*)calloc((long long) width * height, sizeof(char)) : NULL;
+    return progressive;
+}
+
+/**
+ * Free the levels
+ */
+void progressiveFree(PROGRESSIVE* progressive) {
+    if ( progressive == NULL )
+        return;
+    free(progressive->image);
+    free(progressive);
+}
+
+/**
+ * Distance between the samples of a level
+ */
+int progressiveStep(int level) {
+    int step = 1;
+    for (int l = level; l < PROGRESSIVE_LEVELS-1; ++l) {
+        step *= PROGRESSIVE_FACTOR;
+    }
+    return step;
+}
+
+/**
+ * Total number of work items of all levels
+ */
+int progressiveNumItems(const PROGRESSIVE* progressive) {
+    return progressive->first_item[PROGRESSIVE_LEVELS];
+}
+
+/**
+ * Most samples a work item has, a full row or a column sampled on the rows of the second level
+ */
+int progressiveMaxSamples(int width, int height) {
+    int column = numSamples(height, PROGRESSIVE_FACTOR);
+    return (width > column) ? width : column;
+}
+
+/**
+ * Compute the samples of a work item. The steps are powers of two, so scaling the pixel size by
+ * them is exact and every sample gets the very coordinates it has in the full image.
+ */
+int computeProgressiveItem(const PROGRESSIVE* progressive, int item, char *data, double scale_real, double scale_imag, int iters, double real_min, double imag_min) {
+    int level, index, step, num;
+    bool is_row;
+    progressiveItem(progressive, item, &level, &is_row, &index, &step, &num);
+    int blocks = (num + OMP_TILE_COLS - 1) / OMP_TILE_COLS;
+
+    if ( is_row ) {
+        // Sample j of the row is column j*step
+        MANDLE_ROW_KERNEL kernel = getMandleRowKernel();
+#if WITH_OMP
+        #pragma omp taskloop num_tasks(ompNumTasks(blocks))
+#endif
+        for (int block = 0; block < blocks; ++block) {
+            int first = block * OMP_TILE_COLS;
+            int count = (num - first < OMP_TILE_COLS) ? num - first : OMP_TILE_COLS;
+            kernel(data + first, first, count, index, scale_real * step, scale_imag, iters, progressive->height, real_min, imag_min);
+        }
+    } else {
+        // Sample i of the column is the (num-1-i)-th row of the coarser grid from the bottom, the column
+        // kernel sees a 'num' rows high image of rows 'step' apart
+        MANDLE_COLUMN_KERNEL kernel = getMandleColumnKernel();
+#if WITH_OMP
+        #pragma omp taskloop num_tasks(ompNumTasks(blocks))
+#endif
+        for (int block = 0; block < blocks; ++block) {
+            int first = block * OMP_TILE_COLS;
+            int count = (num - first < OMP_TILE_COLS) ? num - first : OMP_TILE_COLS;
+            kernel(data + first, 1, index, first, count, scale_real, scale_imag * step, iters, num, real_min, imag_min);
+        }
+    }
+    return num;
+}
+
+/**
+ * Store the samples of a work item
+ */
+bool progressiveStore(PROGRESSIVE* progressive, int item, const char *data, int num_samples) {
+    if ( item < 0 || item >= progressiveNumItems(progressive) ) {
+        return false;
+    }
+    int level, index, step, num;
+    bool is_row;
+    progressiveItem(progressive, item, &level, &is_row, &index, &step, &num);
+    if ( num_samples != num ) {
+        return false;
+    }
+
+    int width = progressive->width;
+    int height = progressive->height;
+    if ( is_row ) {
+        char* row = progressive->image + (long long) index * width;
+        for (int j = 0; j < num; ++j) {
+            row[(long long) j * step] = data[j];
+        }
+    } else {
+        for (int i = 0; i < num; ++i) {
+            progressive->image[(long long) (height - 1 - (num - 1 - i) * step) * width + index] = data[i];
+        }
+    }
+    --progressive->items_left[level];
+    return true;
+}
+
+/**
+ * Next level whose samples and those of all coarser levels are stored
+ */
+int progressiveNextLevel(PROGRESSIVE* progressive) {
+    int level = progressive->next_level;
+    if ( level >= PROGRESSIVE_LEVELS || progressive->items_left[level] > 0 ) {
+        return -1;
+    }
+    ++progressive->next_level;
+    return level;
+}
+
+/**
+ * Fill the image with the samples of a level
+ */
+void progressivePreview(const PROGRESSIVE* progressive, int level, char *preview) {
+    int width = progressive->width;
+    int height = progressive->height;
+    int step = progressiveStep(level);
+    if ( step == 1 ) {
+        memcpy(preview, progressive->image, (long long) width * height);
+        return;
+    }
+    for (int row = 0; row < height; ++row) {
+        int flipped = height - 1 - row;
+        const char* samples = progressive->image + (long long) (height - 1 - (flipped - flipped % step)) * width;
+        char* out = preview + (long long) row * width;
+        for (int col = 0; col < width; ++col) {
+            out[col] = samples[col - col % step];
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,115 @@
+/**
+ * Mandlebort implementation over MPI and OpenMP
+ *
+ * Copyright (c) 2012, Moritz Wundke
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the owner nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Moritz Wundke BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+#ifndef MANDLE_PROGRESSIVE_H
+#define MANDLE_PROGRESSIVE_H
+
+/** Our own includes */
+#include "mandle_utils.h"
+
+/** Levels of the progressive strategy, the last one is the full image */
+#ifndef PROGRESSIVE_LEVELS
+	#define PROGRESSIVE_LEVELS	3
+#endif
+
+/** Each level has this many times the resolution of the one before on both axes, a power of two */
+#ifndef PROGRESSIVE_FACTOR
+	#define PROGRESSIVE_FACTOR	4
+#endif
+
+#if PROGRESSIVE_FACTOR < 2 || (PROGRESSIVE_FACTOR & (PROGRESSIVE_FACTOR - 1)) != 0
+	#error "PROGRESSIVE_FACTOR must be a power of two, the samples of the coarse levels are then exactly those of the full image"
+#endif
+
+/**
+ * Coarse to fine rendering. Level l samples every progressiveStep(l)-th column of every progressiveStep(l)-th
+ * row, counted from the bottom left corner, so every sample of a level is also one of all finer levels.
+ * A level only computes the samples the coarser levels do not have: its rows that are not on the coarser
+ * grid (a work item per row) and the missing columns of the rows that are (a work item per column).
+ * All levels together compute every point exactly once.
+ */
+typedef struct {
+    int width;
+    int height;
+    int first_item[PROGRESSIVE_LEVELS+1];   // Items of level l are [first_item[l], first_item[l+1])
+    int num_rows[PROGRESSIVE_LEVELS];       // The first num_rows[l] items of a level are rows, the others columns
+    int items_left[PROGRESSIVE_LEVELS];     // Items not stored yet
+    int next_level;                         // Next level progressiveNextLevel reports
+    char* image;                            // Samples stored so far, 0 or 1 for each point
+} PROGRESSIVE;
+
+/**
+ * Create the levels of a 'width' x 'height' image, with 'collect' the samples can be stored and previewed
+ */
+PROGRESSIVE* progressiveCreate(int width, int height, bool collect);
+
+/**
+ * Free the levels
+ */
+void progressiveFree(PROGRESSIVE* progressive);
+
+/**
+ * Distance between the samples of a level
+ */
+int progressiveStep(int level);
+
+/**
+ * Total number of work items of all levels, coarse levels first
+ */
+int progressiveNumItems(const PROGRESSIVE* progressive);
+
+/**
+ * Most samples a work item of a 'width' x 'height' image has
+ */
+int progressiveMaxSamples(int width, int height);
+
+/**
+ * Compute the samples of work item 'item' into 'data', returns the number of samples
+ */
+int computeProgressiveItem(const PROGRESSIVE* progressive, int item, char *data, double scale_real, double scale_imag, int iters, double real_min, double imag_min);
+
+/**
+ * Store the 'num_samples' samples of work item 'item', returns false if they do not match the item
+ */
+bool progressiveStore(PROGRESSIVE* progressive, int item, const char *data, int num_samples);
+
+/**
+ * Next level whose samples and those of all coarser levels are stored, -1 if there is none.
+ * Every level is reported once and in order.
+ */
+int progressiveNextLevel(PROGRESSIVE* progressive);
+
+/**
+ * Fill the full image 'preview' with the samples of 'level', every point gets the nearest
+ * sample below and left of it
+ */
+void progressivePreview(const PROGRESSIVE* progressive, int level, char *preview);
+
+#endif // MANDLE_PROGRESSIVE_H
\ No newline at end of file
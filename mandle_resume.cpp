@@ -0,0 +1,338 @@
+/**
+ * Mandlebort implementation over MPI and OpenMP
+ *
+ * Copyright (c) 2012, Moritz Wundke
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the owner nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Moritz Wundke BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+/** STD includes */
+#include <string.h>
+
+/** Our own includes */
+#include "mandle_resume.h"
+#include "mandle_simd.h"
+
+#if WITH_SIMD
+	#include <immintrin.h>
+#endif
+
+/** Points iterated together */
+#define RESUME_GROUP_SIZE	8
+
+/**
+ * Iterate 'num' points from their z at iteration 'k' up to 'iters', storing the iteration they stopped at
+ */
+typedef void (*RESUME_GROUP)(const double* c_real, const double* c_imag, double* z_real, double* z_imag, int num, int k, int iters, int* counts);
+
+/** First bytes of a state file */
+static const char RESUME_MAGIC[8] = { 'M', 'A', 'N', 'D', 'L', 'E', 'R', '1' };
+
+/**
+ * Start of a state file, followed by the pixel of every point and then its z
+ */
+typedef struct {
+    char magic[8];
+    int width;
+    int height;
+    double real_min;
+    double real_max;
+    double imag_min;
+    double imag_max;
+    long long num_points;
+    int iters;
+    int reserved;
+} RESUME_HEADER;
+
+/**
+ * Iterate z from iteration 'k' until it escapes or reaches 'iters', the same loop as pointIterations
+ * in double so a resumed point ends exactly where a render from z = 0 would
+ */
+static inline int iterateFrom(double c_real, double c_imag, double *z_real, double *z_imag, int k, int iters) {
+    // Points of the cardioid and the bulb are never iterated, they stay at z = 0
+    if ( inMainCardioidOrBulb(c_real, c_imag) ) {
+        return iters;
+    }
+    double zr = *z_real, zi = *z_imag, temp;
+    double lengthsq;
+    do {
+        temp = zr*zr - zi*zi + c_real;
+        zi = (zr + zr)*zi + c_imag;
+        zr = temp;
+        lengthsq = zr*zr + zi*zi;
+        ++k;
+    } while (lengthsq < SIZE_SQ && k < iters);
+    *z_real = zr;
+    *z_imag = zi;
+    return k;
+}
+
+/**
+ * One point after the other
+ */
+static void groupScalar(const double* c_real, const double* c_imag, double* z_real, double* z_imag, int num, int k, int iters, int* counts) {
+    for (int j = 0; j < num; ++j) {
+        counts[j] = iterateFrom(c_real[j], c_imag[j], &z_real[j], &z_imag[j], k, iters);
+    }
+}
+
+#if WITH_SIMD
+/**
+ * AVX2, 2 x 4 points in lockstep. Lanes keep iterating once they escaped, only the z of the points
+ * that reach 'iters' is used.
+ */
+__attribute__((target("avx2"), optimize("fp-contract=off")))
+static void groupAVX2(const double* c_real, const double* c_imag, double* z_real, double* z_imag, int num, int k, int iters, int* counts) {
+    double real[8], imag[8], zr[8], zi[8];
+    long long done[8], k_out[8];
+    for (int j = 0; j < 8; ++j) {
+        done[j] = ( j >= num || inMainCardioidOrBulb(c_real[j], c_imag[j]) ) ? -1 : 0;
+        real[j] = (j < num) ? c_real[j] : 0;
+        imag[j] = (j < num) ? c_imag[j] : 0;
+        zr[j] = (j < num) ? z_real[j] : 0;
+        zi[j] = (j < num) ? z_imag[j] : 0;
+    }
+
+    const __m256d c_real0 = _mm256_loadu_pd(real), c_real1 = _mm256_loadu_pd(real + 4);
+    const __m256d c_imag0 = _mm256_loadu_pd(imag), c_imag1 = _mm256_loadu_pd(imag + 4);
+    const __m256d limit = _mm256_set1_pd(SIZE_SQ);
+    const __m256i done0 = _mm256_loadu_si256((const __m256i*) done);
+    const __m256i done1 = _mm256_loadu_si256((const __m256i*) (done + 4));
+    __m256d z_real0 = _mm256_loadu_pd(zr), z_real1 = _mm256_loadu_pd(zr + 4);
+    __m256d z_imag0 = _mm256_loadu_pd(zi), z_imag1 = _mm256_loadu_pd(zi + 4);
+    __m256d active0 = _mm256_castsi256_pd(_mm256_xor_si256(done0, _mm256_set1_epi64x(-1)));
+    __m256d active1 = _mm256_castsi256_pd(_mm256_xor_si256(done1, _mm256_set1_epi64x(-1)));
+    __m256i k0 = _mm256_blendv_epi8(_mm256_set1_epi64x(k), _mm256_set1_epi64x(iters), done0);
+    __m256i k1 = _mm256_blendv_epi8(_mm256_set1_epi64x(k), _mm256_set1_epi64x(iters), done1);
+
+    for (int i = k; i < iters && _mm256_movemask_pd(_mm256_or_pd(active0, active1)) != 0; ++i) {
+        __m256d temp0 = _mm256_add_pd(_mm256_sub_pd(_mm256_mul_pd(z_real0, z_real0), _mm256_mul_pd(z_imag0, z_imag0)), c_real0);
+        __m256d temp1 = _mm256_add_pd(_mm256_sub_pd(_mm256_mul_pd(z_real1, z_real1), _mm256_mul_pd(z_imag1, z_imag1)), c_real1);
+        z_imag0 = _mm256_add_pd(_mm256_mul_pd(_mm256_add_pd(z_real0, z_real0), z_imag0), c_imag0);
+        z_imag1 = _mm256_add_pd(_mm256_mul_pd(_mm256_add_pd(z_real1, z_real1), z_imag1), c_imag1);
+        z_real0 = temp0;
+        z_real1 = temp1;
+        __m256d lengthsq0 = _mm256_add_pd(_mm256_mul_pd(z_real0, z_real0), _mm256_mul_pd(z_imag0, z_imag0));
+        __m256d lengthsq1 = _mm256_add_pd(_mm256_mul_pd(z_real1, z_real1), _mm256_mul_pd(z_imag1, z_imag1));
+
+        // Active lanes are all ones, subtracting them counts one iteration
+        k0 = _mm256_sub_epi64(k0, _mm256_castpd_si256(active0));
+        k1 = _mm256_sub_epi64(k1, _mm256_castpd_si256(active1));
+        active0 = _mm256_and_pd(active0, _mm256_cmp_pd(lengthsq0, limit, _CMP_LT_OQ));
+        active1 = _mm256_and_pd(active1, _mm256_cmp_pd(lengthsq1, limit, _CMP_LT_OQ));
+    }
+
+    _mm256_storeu_si256((__m256i*) k_out, k0);
+    _mm256_storeu_si256((__m256i*) (k_out + 4), k1);
+    _mm256_storeu_pd(zr, z_real0);
+    _mm256_storeu_pd(zr + 4, z_real1);
+    _mm256_storeu_pd(zi, z_imag0);
+    _mm256_storeu_pd(zi + 4, z_imag1);
+    for (int j = 0; j < num; ++j) {
+        counts[j] = (int) k_out[j];
+        if ( !done[j] ) {
+            z_real[j] = zr[j];
+            z_imag[j] = zi[j];
+        }
+    }
+}
+#endif
+
+/**
+ * The AVX2 group wherever the row kernels run AVX2 or better
+ */
+static RESUME_GROUP resumeGroup() {
+#if WITH_SIMD
+    const char* simd = getMandleRowKernelName();
+    if ( strcmp(simd, "avx2") == 0 || strcmp(simd, "avx512") == 0 )
+        return groupAVX2;
+#endif
+    return groupScalar;
+}
+
+/**
+ * Whether z escaped. A point that escapes on the last allowed iteration counts as inside like in
+ * every other kernel, but it is not continued.
+ */
+static inline bool escaped(double z_real, double z_imag) {
+    return !(z_real*z_real + z_imag*z_imag < SIZE_SQ);
+}
+
+/**
+ * Create an empty state of a view
+ */
+RESUME_STATE* resumeCreate(int width, int height, double real_min, double real_max, double imag_min, double imag_max, int iters, long long num_points) {
+    RESUME_STATE* state = (RESUME_STATE*)calloc(1, sizeof(*state));
+    state->width = width;
+    state->height = height;
+    state->real_min = real_min;
+    state->real_max = real_max;
+    state->imag_min = imag_min;
+    state->imag_max = imag_max;
+    state->iters = iters;
+    state->num_points = num_points;
+    state->index = (unsigned int*)malloc((num_points > 0 ? num_points : 1) * sizeof(*state->index));
+    state->z = (double*)malloc((num_points > 0 ? num_points : 1) * 2 * sizeof(*state->z));
+    return state;
+}
+
+/**
+ * Free a state
+ */
+void resumeFree(RESUME_STATE* state) {
+    if ( state == NULL )
+        return;
+    free(state->z);
+    free(state->index);
+    free(state);
+}
+
+/**
+ * Read a state file of the given view
+ */
+RESUME_STATE* resumeLoad(const char* filename, int width, int height, double real_min, double real_max, double imag_min, double imag_max) {
+    FILE* file = fopen(filename, "rb");
+    if ( file == NULL )
+        return NULL;
+
+    RESUME_HEADER header;
+    if ( fread(&header, sizeof(header), 1, file) != 1 || memcmp(header.magic, RESUME_MAGIC, sizeof(RESUME_MAGIC)) != 0 ) {
+        ERROR("'%s' is not a state file\n", filename);
+        fclose(file);
+        return NULL;
+    }
+    if ( header.width != width || header.height != height || header.real_min != real_min || header.real_max != real_max
+         || header.imag_min != imag_min || header.imag_max != imag_max || header.num_points < 0 || header.num_points > (long long) width * height ) {
+        ERROR("'%s' is the state of another view\n", filename);
+        fclose(file);
+        return NULL;
+    }
+
+    RESUME_STATE* state = resumeCreate(width, height, real_min, real_max, imag_min, imag_max, header.iters, header.num_points);
+    if ( fread(state->index, sizeof(*state->index), state->num_points, file) != (size_t) state->num_points
+         || fread(state->z, 2 * sizeof(*state->z), state->num_points, file) != (size_t) state->num_points ) {
+        ERROR("State file '%s' is truncated\n", filename);
+        resumeFree(state);
+        state = NULL;
+    }
+    fclose(file);
+    return state;
+}
+
+/**
+ * Write the state to a file, the pixels and the z of all points as two arrays so there is no padding
+ */
+bool resumeSave(const RESUME_STATE* state, const char* filename) {
+    FILE* file = fopen(filename, "wb");
+    if ( file == NULL ) {
+        ERROR("Failed to create state file '%s'\n", filename);
+        return false;
+    }
+
+    RESUME_HEADER header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, RESUME_MAGIC, sizeof(RESUME_MAGIC));
+    header.width = state->width;
+    header.height = state->height;
+    header.real_min = state->real_min;
+    header.real_max = state->real_max;
+    header.imag_min = state->imag_min;
+    header.imag_max = state->imag_max;
+    header.num_points = state->num_points;
+    header.iters = state->iters;
+    bool written = fwrite(&header, sizeof(header), 1, file) == 1
+                   && fwrite(state->index, sizeof(*state->index), state->num_points, file) == (size_t) state->num_points
+                   && fwrite(state->z, 2 * sizeof(*state->z), state->num_points, file) == (size_t) state->num_points;
+    if ( fclose(file) != 0 || !written ) {
+        ERROR("Failed to write state file '%s'\n", filename);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Iterate pixels of a row from z = 0, keeping the ones that did not escape
+ */
+int resumeStartRow(char *data, unsigned int *index, double *z, int first_col, int num_cols, int row, int width, double scale_real, double scale_imag, int iters, int height, double real_min, double imag_min) {
+    RESUME_GROUP group = resumeGroup();
+    double c_real[RESUME_GROUP_SIZE], c_imag[RESUME_GROUP_SIZE], z_real[RESUME_GROUP_SIZE], z_imag[RESUME_GROUP_SIZE];
+    int counts[RESUME_GROUP_SIZE];
+    const double imag = imag_min + ((double) (height-1-row) * scale_imag);
+    int num_points = 0;
+    for (int col = 0; col < num_cols; col += RESUME_GROUP_SIZE) {
+        const int num = (num_cols - col < RESUME_GROUP_SIZE) ? num_cols - col : RESUME_GROUP_SIZE;
+        for (int j = 0; j < num; ++j) {
+            c_real[j] = real_min + ((double) (first_col + col + j) * scale_real);
+            c_imag[j] = imag;
+            z_real[j] = z_imag[j] = 0;
+        }
+        group(c_real, c_imag, z_real, z_imag, num, 0, iters, counts);
+        for (int j = 0; j < num; ++j) {
+            data[col + j] = (counts[j] == iters);
+            if ( data[col + j] && !escaped(z_real[j], z_imag[j]) ) {
+                index[num_points] = (unsigned int) row * width + first_col + col + j;
+                z[2*num_points] = z_real[j];
+                z[2*num_points+1] = z_imag[j];
+                ++num_points;
+            }
+        }
+    }
+    return num_points;
+}
+
+/**
+ * Continue points of a state, compacting the ones that still did not escape
+ */
+long long resumeContinue(char *data, unsigned int *index, double *z, long long num_points, int width, double scale_real, double scale_imag, int iters_done, int iters, int height, double real_min, double imag_min) {
+    RESUME_GROUP group = resumeGroup();
+    double c_real[RESUME_GROUP_SIZE], c_imag[RESUME_GROUP_SIZE], z_real[RESUME_GROUP_SIZE], z_imag[RESUME_GROUP_SIZE];
+    int counts[RESUME_GROUP_SIZE];
+    long long kept = 0;
+    for (long long i = 0; i < num_points; i += RESUME_GROUP_SIZE) {
+        const int num = (num_points - i < RESUME_GROUP_SIZE) ? (int) (num_points - i) : RESUME_GROUP_SIZE;
+        for (int j = 0; j < num; ++j) {
+            const int row = index[i+j] / width;
+            const int col = index[i+j] % width;
+            c_real[j] = real_min + ((double) col * scale_real);
+            c_imag[j] = imag_min + ((double) (height-1-row) * scale_imag);
+            z_real[j] = z[2*(i+j)];
+            z_imag[j] = z[2*(i+j)+1];
+        }
+        group(c_real, c_imag, z_real, z_imag, num, iters_done, iters, counts);
+
+        // Points are only moved towards the front, behind the group we just read
+        for (int j = 0; j < num; ++j) {
+            const unsigned int pixel = index[i+j];
+            data[pixel] = (counts[j] == iters);
+            if ( data[pixel] && !escaped(z_real[j], z_imag[j]) ) {
+                index[kept] = pixel;
+                z[2*kept] = z_real[j];
+                z[2*kept+1] = z_imag[j];
+                ++kept;
+            }
+        }
+    }
+    return kept;
+}
\ No newline at end of file
@@ -0,0 +1,95 @@
+/**
+ * Mandlebort implementation over MPI and OpenMP
+ *
+ * Copyright (c) 2012, Moritz Wundke
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the owner nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Moritz Wundke BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+#ifndef MANDLE_RESUME_H
+#define MANDLE_RESUME_H
+
+/** Our own includes */
+#include "mandle_utils.h"
+
+/** Points a thread continues at once when a render is resumed */
+#ifndef RESUME_CHUNK
+	#define RESUME_CHUNK	4096
+#endif
+
+/**
+ * Where a render stopped: every point that did not escape within 'iters' iterations with the z it
+ * got to. Points that escaped are 0 for any higher limit and need no state. A later render of the
+ * same view with a higher limit only continues these points. The state is kept in double, so
+ * views that need a deeper precision can not be resumed.
+ */
+typedef struct {
+    int width;
+    int height;
+    double real_min;
+    double real_max;
+    double imag_min;
+    double imag_max;
+    int iters;                  // Iterations every point of the state has done
+    long long num_points;
+    unsigned int* index;        // Pixel of each point, row * width + col
+    double* z;                  // Real and imaginary part of z of each point
+} RESUME_STATE;
+
+/**
+ * Create an empty state of a view with room for 'num_points' points
+ */
+RESUME_STATE* resumeCreate(int width, int height, double real_min, double real_max, double imag_min, double imag_max, int iters, long long num_points);
+
+/**
+ * Free a state
+ */
+void resumeFree(RESUME_STATE* state);
+
+/**
+ * Read the state file 'filename' if it is one of the given view, NULL if it does not exist or is
+ * of another view
+ */
+RESUME_STATE* resumeLoad(const char* filename, int width, int height, double real_min, double real_max, double imag_min, double imag_max);
+
+/**
+ * Write the state to 'filename', returns false on failure
+ */
+bool resumeSave(const RESUME_STATE* state, const char* filename);
+
+/**
+ * Iterate 'num_cols' pixels of a row from z = 0 up to 'iters' and store 0 or 1 for each in 'data'. The
+ * pixels that did not escape are appended to 'index' and 'z', returns their number.
+ */
+int resumeStartRow(char *data, unsigned int *index, double *z, int first_col, int num_cols, int row, int width, double scale_real, double scale_imag, int iters, int height, double real_min, double imag_min);
+
+/**
+ * Continue 'num_points' points of a state from 'iters_done' to more 'iters' iterations and store 0 or 1
+ * for their pixels in the image 'data'. The points that still did not escape are moved to the front,
+ * returns their number.
+ */
+long long resumeContinue(char *data, unsigned int *index, double *z, long long num_points, int width, double scale_real, double scale_imag, int iters_done, int iters, int height, double real_min, double imag_min);
+
+#endif // MANDLE_RESUME_H
\ No newline at end of file
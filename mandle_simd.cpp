@@ -0,0 +1,586 @@
+/**
+ * Mandlebort implementation over MPI and OpenMP
+ *
+ * Copyright (c) 2012, Moritz Wundke
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the owner nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Moritz Wundke BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+/** Our own includes */
+#include "mandle_simd.h"
+#include "mandle_counts.h"
+
+#include <string.h>
+
+#if WITH_SIMD
+	#include <immintrin.h>
+#endif
+
+/**
+ * Plain scalar row kernel, used when no vector unit is available
+ */
+static void mandleRowScalar(char *data, int first_col, int num_cols, int row, double scale_real, double scale_imag, int iters, int height, double real_min, double imag_min) {
+    for (int j = 0; j < num_cols; ++j) {
+        data[j] = computeMandle(row, first_col + j, scale_real, scale_imag, iters, height, real_min, imag_min);
+    }
+}
+
+/**
+ * Plain scalar column kernel, used when no vector unit is available
+ */
+static void mandleColumnScalar(char *data, int stride, int col, int first_row, int num_rows, double scale_real, double scale_imag, int iters, int height, double real_min, double imag_min) {
+    for (int i = 0; i < num_rows; ++i) {
+        data[(long long) i * stride] = computeMandle(first_row + i, col, scale_real, scale_imag, iters, height, real_min, imag_min);
+    }
+}
+
+/**
+ * Plain scalar count kernel, used when no vector unit is available
+ */
+static void mandleCountScalar(unsigned char *counts, int count_bytes, int first_col, int num_cols, int row, double scale_real, double scale_imag, int iters, int height, double real_min, double imag_min) {
+    const double c_imag = imag_min + ((double) (height-1-row) * scale_imag);
+    for (int j = 0; j < num_cols; ++j) {
+        setCount(counts, count_bytes, j, computeMandleIterations(real_min + ((double) (first_col + j) * scale_real), c_imag, iters));
+    }
+}
+
+#if WITH_SIMD
+
+/**
+ * The vector kernels iterate two registers at once to hide the latency of the
+ * multiply/add chain. Each lane counts its iterations until it escapes, the group
+ * is done once every lane escaped or the iteration budget is used up. A point is
+ * inside the set when its count reached 'iters', the same test computeMandle does.
+ * FMA contraction is disabled so every lane rounds exactly like the scalar code.
+ *
+ * Each instruction set has one group function doing the iterations, the row and
+ * column kernels only differ in how they lay out the points of a group. Lanes in
+ * the main cardioid or the period-2 bulb and, with WITH_PERIODICITY, lanes caught
+ * in a cycle are marked done with a full count like computeMandle does.
+ */
+
+/**
+ * Store the result of the first 'num' points of a group, 'step' chars apart
+ */
+static inline void storeGroup(char *data, long long step, const long long *counts, int num, int iters) {
+    for (int j = 0; j < num; ++j) {
+        data[j * step] = (counts[j] == iters);
+    }
+}
+
+/**
+ * Store the counts of the first 'num' points of a group
+ */
+static inline void storeCountGroup(unsigned char *data, int count_bytes, const long long *counts, int num) {
+    for (int j = 0; j < num; ++j) {
+        setCount(data, count_bytes, j, counts[j]);
+    }
+}
+
+/**
+ * Lanes inside the main cardioid or the period-2 bulb, same math as inMainCardioidOrBulb
+ */
+static inline __m128d interiorSSE2(__m128d c_real, __m128d c_imag) {
+    const __m128d x = _mm_sub_pd(c_real, _mm_set1_pd(0.25));
+    const __m128d imag_sq = _mm_mul_pd(c_imag, c_imag);
+    const __m128d q = _mm_add_pd(_mm_mul_pd(x, x), imag_sq);
+    const __m128d cardioid = _mm_cmple_pd(_mm_mul_pd(q, _mm_add_pd(q, x)), _mm_mul_pd(_mm_set1_pd(0.25), imag_sq));
+    const __m128d x_bulb = _mm_add_pd(c_real, _mm_set1_pd(1.0));
+    const __m128d bulb = _mm_cmple_pd(_mm_add_pd(_mm_mul_pd(x_bulb, x_bulb), imag_sq), _mm_set1_pd(0.0625));
+    return _mm_or_pd(cardioid, bulb);
+}
+
+/**
+ * SSE2, 2 x 2 points per lane group
+ */
+static inline void mandleGroupSSE2(__m128d c_real0, __m128d c_real1, __m128d c_imag0, __m128d c_imag1, int iters, long long *counts) {
+    const __m128d limit = _mm_set1_pd(SIZE_SQ);
+    const __m128d two = _mm_set1_pd(2.0);
+    const __m128d all = _mm_castsi128_pd(_mm_set1_epi32(-1));
+    const __m128i iters_v = _mm_set1_epi64x(iters);
+    __m128d z_real0 = _mm_setzero_pd(), z_imag0 = _mm_setzero_pd();
+    __m128d z_real1 = _mm_setzero_pd(), z_imag1 = _mm_setzero_pd();
+
+    // Lanes in the main cardioid or the period-2 bulb start done with a full count
+    const __m128d interior0 = interiorSSE2(c_real0, c_imag0);
+    const __m128d interior1 = interiorSSE2(c_real1, c_imag1);
+    __m128d active0 = _mm_andnot_pd(interior0, all), active1 = _mm_andnot_pd(interior1, all);
+    __m128i k0 = _mm_and_si128(_mm_castpd_si128(interior0), iters_v);
+    __m128i k1 = _mm_and_si128(_mm_castpd_si128(interior1), iters_v);
+#if WITH_PERIODICITY
+    const __m128d eps = _mm_set1_pd(PERIODICITY_EPS);
+    const __m128d sign = _mm_set1_pd(-0.0);
+    __m128d check_real0 = z_real0, check_imag0 = z_imag0;
+    __m128d check_real1 = z_real1, check_imag1 = z_imag1;
+    long long check_at = 1;
+#endif
+
+    for (int i = 0; i < iters && _mm_movemask_pd(_mm_or_pd(active0, active1)) != 0; ++i) {
+        __m128d temp0 = _mm_add_pd(_mm_sub_pd(_mm_mul_pd(z_real0, z_real0), _mm_mul_pd(z_imag0, z_imag0)), c_real0);
+        __m128d temp1 = _mm_add_pd(_mm_sub_pd(_mm_mul_pd(z_real1, z_real1), _mm_mul_pd(z_imag1, z_imag1)), c_real1);
+        z_imag0 = _mm_add_pd(_mm_mul_pd(_mm_mul_pd(two, z_real0), z_imag0), c_imag0);
+        z_imag1 = _mm_add_pd(_mm_mul_pd(_mm_mul_pd(two, z_real1), z_imag1), c_imag1);
+        z_real0 = temp0;
+        z_real1 = temp1;
+        __m128d lengthsq0 = _mm_add_pd(_mm_mul_pd(z_real0, z_real0), _mm_mul_pd(z_imag0, z_imag0));
+        __m128d lengthsq1 = _mm_add_pd(_mm_mul_pd(z_real1, z_real1), _mm_mul_pd(z_imag1, z_imag1));
+
+        // Active lanes are all ones, subtracting them counts one iteration
+        k0 = _mm_sub_epi64(k0, _mm_castpd_si128(active0));
+        k1 = _mm_sub_epi64(k1, _mm_castpd_si128(active1));
+        active0 = _mm_and_pd(active0, _mm_cmplt_pd(lengthsq0, limit));
+        active1 = _mm_and_pd(active1, _mm_cmplt_pd(lengthsq1, limit));
+#if WITH_PERIODICITY
+        // Lanes back at the saved orbit point are periodic, they get a full count
+        __m128d periodic0 = _mm_and_pd(active0, _mm_and_pd(
+                _mm_cmplt_pd(_mm_andnot_pd(sign, _mm_sub_pd(z_real0, check_real0)), eps),
+                _mm_cmplt_pd(_mm_andnot_pd(sign, _mm_sub_pd(z_imag0, check_imag0)), eps)));
+        __m128d periodic1 = _mm_and_pd(active1, _mm_and_pd(
+                _mm_cmplt_pd(_mm_andnot_pd(sign, _mm_sub_pd(z_real1, check_real1)), eps),
+                _mm_cmplt_pd(_mm_andnot_pd(sign, _mm_sub_pd(z_imag1, check_imag1)), eps)));
+        k0 = _mm_or_si128(_mm_andnot_si128(_mm_castpd_si128(periodic0), k0), _mm_and_si128(_mm_castpd_si128(periodic0), iters_v));
+        k1 = _mm_or_si128(_mm_andnot_si128(_mm_castpd_si128(periodic1), k1), _mm_and_si128(_mm_castpd_si128(periodic1), iters_v));
+        active0 = _mm_andnot_pd(periodic0, active0);
+        active1 = _mm_andnot_pd(periodic1, active1);
+        if ( i + 1 == check_at ) {
+            check_real0 = z_real0;
+            check_imag0 = z_imag0;
+            check_real1 = z_real1;
+            check_imag1 = z_imag1;
+            check_at <<= 1;
+        }
+#endif
+    }
+
+    _mm_storeu_si128((__m128i*) &counts[0], k0);
+    _mm_storeu_si128((__m128i*) &counts[2], k1);
+}
+
+static void mandleRowSSE2(char *data, int first_col, int num_cols, int row, double scale_real, double scale_imag, int iters, int height, double real_min, double imag_min) {
+    const __m128d c_imag = _mm_set1_pd(imag_min + ((double) (height-1-row) * scale_imag));
+    long long counts[4];
+
+    for (int col = 0; col < num_cols; col += 4) {
+        const double column = (double) (first_col + col);
+        const __m128d c_real0 = _mm_set_pd(real_min + ((column+1) * scale_real), real_min + (column * scale_real));
+        const __m128d c_real1 = _mm_set_pd(real_min + ((column+3) * scale_real), real_min + ((column+2) * scale_real));
+        mandleGroupSSE2(c_real0, c_real1, c_imag, c_imag, iters, counts);
+        storeGroup(data + col, 1, counts, (num_cols - col < 4) ? num_cols - col : 4, iters);
+    }
+}
+
+static void mandleCountSSE2(unsigned char *data, int count_bytes, int first_col, int num_cols, int row, double scale_real, double scale_imag, int iters, int height, double real_min, double imag_min) {
+    const __m128d c_imag = _mm_set1_pd(imag_min + ((double) (height-1-row) * scale_imag));
+    long long counts[4];
+
+    for (int col = 0; col < num_cols; col += 4) {
+        const double column = (double) (first_col + col);
+        const __m128d c_real0 = _mm_set_pd(real_min + ((column+1) * scale_real), real_min + (column * scale_real));
+        const __m128d c_real1 = _mm_set_pd(real_min + ((column+3) * scale_real), real_min + ((column+2) * scale_real));
+        mandleGroupSSE2(c_real0, c_real1, c_imag, c_imag, iters, counts);
+        storeCountGroup(data + (long long) col * count_bytes, count_bytes, counts, (num_cols - col < 4) ? num_cols - col : 4);
+    }
+}
+
+static void mandleColumnSSE2(char *data, int stride, int col, int first_row, int num_rows, double scale_real, double scale_imag, int iters, int height, double real_min, double imag_min) {
+    const __m128d c_real = _mm_set1_pd(real_min + ((double) col * scale_real));
+    long long counts[4];
+
+    for (int row = 0; row < num_rows; row += 4) {
+        const double flipped = (double) (height-1-(first_row+row));
+        const __m128d c_imag0 = _mm_set_pd(imag_min + ((flipped-1) * scale_imag), imag_min + (flipped * scale_imag));
+        const __m128d c_imag1 = _mm_set_pd(imag_min + ((flipped-3) * scale_imag), imag_min + ((flipped-2) * scale_imag));
+        mandleGroupSSE2(c_real, c_real, c_imag0, c_imag1, iters, counts);
+        storeGroup(data + (long long) row * stride, stride, counts, (num_rows - row < 4) ? num_rows - row : 4, iters);
+    }
+}
+
+/**
+ * Lanes inside the main cardioid or the period-2 bulb, as interiorSSE2
+ */
+__attribute__((target("avx2"), optimize("fp-contract=off")))
+static inline __m256d interiorAVX2(__m256d c_real, __m256d c_imag) {
+    const __m256d x = _mm256_sub_pd(c_real, _mm256_set1_pd(0.25));
+    const __m256d imag_sq = _mm256_mul_pd(c_imag, c_imag);
+    const __m256d q = _mm256_add_pd(_mm256_mul_pd(x, x), imag_sq);
+    const __m256d cardioid = _mm256_cmp_pd(_mm256_mul_pd(q, _mm256_add_pd(q, x)), _mm256_mul_pd(_mm256_set1_pd(0.25), imag_sq), _CMP_LE_OQ);
+    const __m256d x_bulb = _mm256_add_pd(c_real, _mm256_set1_pd(1.0));
+    const __m256d bulb = _mm256_cmp_pd(_mm256_add_pd(_mm256_mul_pd(x_bulb, x_bulb), imag_sq), _mm256_set1_pd(0.0625), _CMP_LE_OQ);
+    return _mm256_or_pd(cardioid, bulb);
+}
+
+/**
+ * AVX2, 2 x 4 points per lane group
+ */
+__attribute__((target("avx2"), optimize("fp-contract=off")))
+static inline void mandleGroupAVX2(__m256d c_real0, __m256d c_real1, __m256d c_imag0, __m256d c_imag1, int iters, long long *counts) {
+    const __m256d limit = _mm256_set1_pd(SIZE_SQ);
+    const __m256d two = _mm256_set1_pd(2.0);
+    const __m256d all = _mm256_castsi256_pd(_mm256_set1_epi32(-1));
+    const __m256i iters_v = _mm256_set1_epi64x(iters);
+    __m256d z_real0 = _mm256_setzero_pd(), z_imag0 = _mm256_setzero_pd();
+    __m256d z_real1 = _mm256_setzero_pd(), z_imag1 = _mm256_setzero_pd();
+
+    const __m256d interior0 = interiorAVX2(c_real0, c_imag0);
+    const __m256d interior1 = interiorAVX2(c_real1, c_imag1);
+    __m256d active0 = _mm256_andnot_pd(interior0, all), active1 = _mm256_andnot_pd(interior1, all);
+    __m256i k0 = _mm256_and_si256(_mm256_castpd_si256(interior0), iters_v);
+    __m256i k1 = _mm256_and_si256(_mm256_castpd_si256(interior1), iters_v);
+#if WITH_PERIODICITY
+    const __m256d eps = _mm256_set1_pd(PERIODICITY_EPS);
+    const __m256d sign = _mm256_set1_pd(-0.0);
+    __m256d check_real0 = z_real0, check_imag0 = z_imag0;
+    __m256d check_real1 = z_real1, check_imag1 = z_imag1;
+    long long check_at = 1;
+#endif
+
+    for (int i = 0; i < iters && _mm256_movemask_pd(_mm256_or_pd(active0, active1)) != 0; ++i) {
+        __m256d temp0 = _mm256_add_pd(_mm256_sub_pd(_mm256_mul_pd(z_real0, z_real0), _mm256_mul_pd(z_imag0, z_imag0)), c_real0);
+        __m256d temp1 = _mm256_add_pd(_mm256_sub_pd(_mm256_mul_pd(z_real1, z_real1), _mm256_mul_pd(z_imag1, z_imag1)), c_real1);
+        z_imag0 = _mm256_add_pd(_mm256_mul_pd(_mm256_mul_pd(two, z_real0), z_imag0), c_imag0);
+        z_imag1 = _mm256_add_pd(_mm256_mul_pd(_mm256_mul_pd(two, z_real1), z_imag1), c_imag1);
+        z_real0 = temp0;
+        z_real1 = temp1;
+        __m256d lengthsq0 = _mm256_add_pd(_mm256_mul_pd(z_real0, z_real0), _mm256_mul_pd(z_imag0, z_imag0));
+        __m256d lengthsq1 = _mm256_add_pd(_mm256_mul_pd(z_real1, z_real1), _mm256_mul_pd(z_imag1, z_imag1));
+
+        k0 = _mm256_sub_epi64(k0, _mm256_castpd_si256(active0));
+        k1 = _mm256_sub_epi64(k1, _mm256_castpd_si256(active1));
+        active0 = _mm256_and_pd(active0, _mm256_cmp_pd(lengthsq0, limit, _CMP_LT_OQ));
+        active1 = _mm256_and_pd(active1, _mm256_cmp_pd(lengthsq1, limit, _CMP_LT_OQ));
+#if WITH_PERIODICITY
+        __m256d periodic0 = _mm256_and_pd(active0, _mm256_and_pd(
+                _mm256_cmp_pd(_mm256_andnot_pd(sign, _mm256_sub_pd(z_real0, check_real0)), eps, _CMP_LT_OQ),
+                _mm256_cmp_pd(_mm256_andnot_pd(sign, _mm256_sub_pd(z_imag0, check_imag0)), eps, _CMP_LT_OQ)));
+        __m256d periodic1 = _mm256_and_pd(active1, _mm256_and_pd(
+                _mm256_cmp_pd(_mm256_andnot_pd(sign, _mm256_sub_pd(z_real1, check_real1)), eps, _CMP_LT_OQ),
+                _mm256_cmp_pd(_mm256_andnot_pd(sign, _mm256_sub_pd(z_imag1, check_imag1)), eps, _CMP_LT_OQ)));
+        k0 = _mm256_castpd_si256(_mm256_blendv_pd(_mm256_castsi256_pd(k0), _mm256_castsi256_pd(iters_v), periodic0));
+        k1 = _mm256_castpd_si256(_mm256_blendv_pd(_mm256_castsi256_pd(k1), _mm256_castsi256_pd(iters_v), periodic1));
+        active0 = _mm256_andnot_pd(periodic0, active0);
+        active1 = _mm256_andnot_pd(periodic1, active1);
+        if ( i + 1 == check_at ) {
+            check_real0 = z_real0;
+            check_imag0 = z_imag0;
+            check_real1 = z_real1;
+            check_imag1 = z_imag1;
+            check_at <<= 1;
+        }
+#endif
+    }
+
+    _mm256_storeu_si256((__m256i*) &counts[0], k0);
+    _mm256_storeu_si256((__m256i*) &counts[4], k1);
+}
+
+__attribute__((target("avx2"), optimize("fp-contract=off")))
+static void mandleRowAVX2(char *data, int first_col, int num_cols, int row, double scale_real, double scale_imag, int iters, int height, double real_min, double imag_min) {
+    const __m256d c_imag = _mm256_set1_pd(imag_min + ((double) (height-1-row) * scale_imag));
+    const __m256d lanes0 = _mm256_set_pd(3, 2, 1, 0);
+    const __m256d lanes1 = _mm256_set_pd(7, 6, 5, 4);
+    const __m256d real_min_v = _mm256_set1_pd(real_min);
+    const __m256d scale_real_v = _mm256_set1_pd(scale_real);
+    long long counts[8];
+
+    for (int col = 0; col < num_cols; col += 8) {
+        const __m256d column = _mm256_set1_pd((double) (first_col + col));
+        const __m256d c_real0 = _mm256_add_pd(real_min_v, _mm256_mul_pd(_mm256_add_pd(column, lanes0), scale_real_v));
+        const __m256d c_real1 = _mm256_add_pd(real_min_v, _mm256_mul_pd(_mm256_add_pd(column, lanes1), scale_real_v));
+        mandleGroupAVX2(c_real0, c_real1, c_imag, c_imag, iters, counts);
+        storeGroup(data + col, 1, counts, (num_cols - col < 8) ? num_cols - col : 8, iters);
+    }
+}
+
+__attribute__((target("avx2"), optimize("fp-contract=off")))
+static void mandleCountAVX2(unsigned char *data, int count_bytes, int first_col, int num_cols, int row, double scale_real, double scale_imag, int iters, int height, double real_min, double imag_min) {
+    const __m256d c_imag = _mm256_set1_pd(imag_min + ((double) (height-1-row) * scale_imag));
+    const __m256d lanes0 = _mm256_set_pd(3, 2, 1, 0);
+    const __m256d lanes1 = _mm256_set_pd(7, 6, 5, 4);
+    const __m256d real_min_v = _mm256_set1_pd(real_min);
+    const __m256d scale_real_v = _mm256_set1_pd(scale_real);
+    long long counts[8];
+
+    for (int col = 0; col < num_cols; col += 8) {
+        const __m256d column = _mm256_set1_pd((double) (first_col + col));
+        const __m256d c_real0 = _mm256_add_pd(real_min_v, _mm256_mul_pd(_mm256_add_pd(column, lanes0), scale_real_v));
+        const __m256d c_real1 = _mm256_add_pd(real_min_v, _mm256_mul_pd(_mm256_add_pd(column, lanes1), scale_real_v));
+        mandleGroupAVX2(c_real0, c_real1, c_imag, c_imag, iters, counts);
+        storeCountGroup(data + (long long) col * count_bytes, count_bytes, counts, (num_cols - col < 8) ? num_cols - col : 8);
+    }
+}
+
+__attribute__((target("avx2"), optimize("fp-contract=off")))
+static void mandleColumnAVX2(char *data, int stride, int col, int first_row, int num_rows, double scale_real, double scale_imag, int iters, int height, double real_min, double imag_min) {
+    const __m256d c_real = _mm256_set1_pd(real_min + ((double) col * scale_real));
+    const __m256d lanes0 = _mm256_set_pd(3, 2, 1, 0);
+    const __m256d lanes1 = _mm256_set_pd(7, 6, 5, 4);
+    const __m256d imag_min_v = _mm256_set1_pd(imag_min);
+    const __m256d scale_imag_v = _mm256_set1_pd(scale_imag);
+    long long counts[8];
+
+    for (int row = 0; row < num_rows; row += 8) {
+        const __m256d flipped = _mm256_set1_pd((double) (height-1-(first_row+row)));
+        const __m256d c_imag0 = _mm256_add_pd(imag_min_v, _mm256_mul_pd(_mm256_sub_pd(flipped, lanes0), scale_imag_v));
+        const __m256d c_imag1 = _mm256_add_pd(imag_min_v, _mm256_mul_pd(_mm256_sub_pd(flipped, lanes1), scale_imag_v));
+        mandleGroupAVX2(c_real, c_real, c_imag0, c_imag1, iters, counts);
+        storeGroup(data + (long long) row * stride, stride, counts, (num_rows - row < 8) ? num_rows - row : 8, iters);
+    }
+}
+
+/**
+ * Lanes inside the main cardioid or the period-2 bulb, as interiorSSE2
+ */
+__attribute__((target("avx512f"), optimize("fp-contract=off")))
+static inline __mmask8 interiorAVX512(__m512d c_real, __m512d c_imag) {
+    const __m512d x = _mm512_sub_pd(c_real, _mm512_set1_pd(0.25));
+    const __m512d imag_sq = _mm512_mul_pd(c_imag, c_imag);
+    const __m512d q = _mm512_add_pd(_mm512_mul_pd(x, x), imag_sq);
+    const __mmask8 cardioid = _mm512_cmp_pd_mask(_mm512_mul_pd(q, _mm512_add_pd(q, x)), _mm512_mul_pd(_mm512_set1_pd(0.25), imag_sq), _CMP_LE_OQ);
+    const __m512d x_bulb = _mm512_add_pd(c_real, _mm512_set1_pd(1.0));
+    const __mmask8 bulb = _mm512_cmp_pd_mask(_mm512_add_pd(_mm512_mul_pd(x_bulb, x_bulb), imag_sq), _mm512_set1_pd(0.0625), _CMP_LE_OQ);
+    return cardioid | bulb;
+}
+
+/**
+ * AVX-512, 2 x 8 points per lane group
+ */
+__attribute__((target("avx512f"), optimize("fp-contract=off")))
+static inline void mandleGroupAVX512(__m512d c_real0, __m512d c_real1, __m512d c_imag0, __m512d c_imag1, int iters, long long *counts) {
+    const __m512d limit = _mm512_set1_pd(SIZE_SQ);
+    const __m512d two = _mm512_set1_pd(2.0);
+    const __m512i one = _mm512_set1_epi64(1);
+    const __m512i iters_v = _mm512_set1_epi64(iters);
+    __m512d z_real0 = _mm512_setzero_pd(), z_imag0 = _mm512_setzero_pd();
+    __m512d z_real1 = _mm512_setzero_pd(), z_imag1 = _mm512_setzero_pd();
+
+    const __mmask8 interior0 = interiorAVX512(c_real0, c_imag0);
+    const __mmask8 interior1 = interiorAVX512(c_real1, c_imag1);
+    __mmask8 active0 = (__mmask8) ~interior0, active1 = (__mmask8) ~interior1;
+    __m512i k0 = _mm512_maskz_mov_epi64(interior0, iters_v);
+    __m512i k1 = _mm512_maskz_mov_epi64(interior1, iters_v);
+#if WITH_PERIODICITY
+    const __m512d eps = _mm512_set1_pd(PERIODICITY_EPS);
+    __m512d check_real0 = z_real0, check_imag0 = z_imag0;
+    __m512d check_real1 = z_real1, check_imag1 = z_imag1;
+    long long check_at = 1;
+#endif
+
+    for (int i = 0; i < iters && (active0 | active1) != 0; ++i) {
+        __m512d temp0 = _mm512_add_pd(_mm512_sub_pd(_mm512_mul_pd(z_real0, z_real0), _mm512_mul_pd(z_imag0, z_imag0)), c_real0);
+        __m512d temp1 = _mm512_add_pd(_mm512_sub_pd(_mm512_mul_pd(z_real1, z_real1), _mm512_mul_pd(z_imag1, z_imag1)), c_real1);
+        z_imag0 = _mm512_add_pd(_mm512_mul_pd(_mm512_mul_pd(two, z_real0), z_imag0), c_imag0);
+        z_imag1 = _mm512_add_pd(_mm512_mul_pd(_mm512_mul_pd(two, z_real1), z_imag1), c_imag1);
+        z_real0 = temp0;
+        z_real1 = temp1;
+        __m512d lengthsq0 = _mm512_add_pd(_mm512_mul_pd(z_real0, z_real0), _mm512_mul_pd(z_imag0, z_imag0));
+        __m512d lengthsq1 = _mm512_add_pd(_mm512_mul_pd(z_real1, z_real1), _mm512_mul_pd(z_imag1, z_imag1));
+
+        k0 = _mm512_mask_add_epi64(k0, active0, k0, one);
+        k1 = _mm512_mask_add_epi64(k1, active1, k1, one);
+        active0 = _mm512_mask_cmp_pd_mask(active0, lengthsq0, limit, _CMP_LT_OQ);
+        active1 = _mm512_mask_cmp_pd_mask(active1, lengthsq1, limit, _CMP_LT_OQ);
+#if WITH_PERIODICITY
+        __mmask8 periodic0 = _mm512_mask_cmp_pd_mask(
+                _mm512_mask_cmp_pd_mask(active0, _mm512_abs_pd(_mm512_sub_pd(z_real0, check_real0)), eps, _CMP_LT_OQ),
+                _mm512_abs_pd(_mm512_sub_pd(z_imag0, check_imag0)), eps, _CMP_LT_OQ);
+        __mmask8 periodic1 = _mm512_mask_cmp_pd_mask(
+                _mm512_mask_cmp_pd_mask(active1, _mm512_abs_pd(_mm512_sub_pd(z_real1, check_real1)), eps, _CMP_LT_OQ),
+                _mm512_abs_pd(_mm512_sub_pd(z_imag1, check_imag1)), eps, _CMP_LT_OQ);
+        k0 = _mm512_mask_mov_epi64(k0, periodic0, iters_v);
+        k1 = _mm512_mask_mov_epi64(k1, periodic1, iters_v);
+        active0 &= (__mmask8) ~periodic0;
+        active1 &= (__mmask8) ~periodic1;
+        if ( i + 1 == check_at ) {
+            check_real0 = z_real0;
+            check_imag0 = z_imag0;
+            check_real1 = z_real1;
+            check_imag1 = z_imag1;
+            check_at <<= 1;
+        }
+#endif
+    }
+
+    _mm512_storeu_si512((void*) &counts[0], k0);
+    _mm512_storeu_si512((void*) &counts[8], k1);
+}
+
+__attribute__((target("avx512f"), optimize("fp-contract=off")))
+static void mandleRowAVX512(char *data, int first_col, int num_cols, int row, double scale_real, double scale_imag, int iters, int height, double real_min, double imag_min) {
+    const __m512d c_imag = _mm512_set1_pd(imag_min + ((double) (height-1-row) * scale_imag));
+    const __m512d lanes0 = _mm512_set_pd(7, 6, 5, 4, 3, 2, 1, 0);
+    const __m512d lanes1 = _mm512_set_pd(15, 14, 13, 12, 11, 10, 9, 8);
+    const __m512d real_min_v = _mm512_set1_pd(real_min);
+    const __m512d scale_real_v = _mm512_set1_pd(scale_real);
+    long long counts[16];
+
+    for (int col = 0; col < num_cols; col += 16) {
+        const __m512d column = _mm512_set1_pd((double) (first_col + col));
+        const __m512d c_real0 = _mm512_add_pd(real_min_v, _mm512_mul_pd(_mm512_add_pd(column, lanes0), scale_real_v));
+        const __m512d c_real1 = _mm512_add_pd(real_min_v, _mm512_mul_pd(_mm512_add_pd(column, lanes1), scale_real_v));
+        mandleGroupAVX512(c_real0, c_real1, c_imag, c_imag, iters, counts);
+        storeGroup(data + col, 1, counts, (num_cols - col < 16) ? num_cols - col : 16, iters);
+    }
+}
+
+__attribute__((target("avx512f"), optimize("fp-contract=off")))
+static void mandleCountAVX512(unsigned char *data, int count_bytes, int first_col, int num_cols, int row, double scale_real, double scale_imag, int iters, int height, double real_min, double imag_min) {
+    const __m512d c_imag = _mm512_set1_pd(imag_min + ((double) (height-1-row) * scale_imag));
+    const __m512d lanes0 = _mm512_set_pd(7, 6, 5, 4, 3, 2, 1, 0);
+    const __m512d lanes1 = _mm512_set_pd(15, 14, 13, 12, 11, 10, 9, 8);
+    const __m512d real_min_v = _mm512_set1_pd(real_min);
+    const __m512d scale_real_v = _mm512_set1_pd(scale_real);
+    long long counts[16];
+
+    for (int col = 0; col < num_cols; col += 16) {
+        const __m512d column = _mm512_set1_pd((double) (first_col + col));
+        const __m512d c_real0 = _mm512_add_pd(real_min_v, _mm512_mul_pd(_mm512_add_pd(column, lanes0), scale_real_v));
+        const __m512d c_real1 = _mm512_add_pd(real_min_v, _mm512_mul_pd(_mm512_add_pd(column, lanes1), scale_real_v));
+        mandleGroupAVX512(c_real0, c_real1, c_imag, c_imag, iters, counts);
+        storeCountGroup(data + (long long) col * count_bytes, count_bytes, counts, (num_cols - col < 16) ? num_cols - col : 16);
+    }
+}
+
+__attribute__((target("avx512f"), optimize("fp-contract=off")))
+static void mandleColumnAVX512(char *data, int stride, int col, int first_row, int num_rows, double scale_real, double scale_imag, int iters, int height, double real_min, double imag_min) {
+    const __m512d c_real = _mm512_set1_pd(real_min + ((double) col * scale_real));
+    const __m512d lanes0 = _mm512_set_pd(7, 6, 5, 4, 3, 2, 1, 0);
+    const __m512d lanes1 = _mm512_set_pd(15, 14, 13, 12, 11, 10, 9, 8);
+    const __m512d imag_min_v = _mm512_set1_pd(imag_min);
+    const __m512d scale_imag_v = _mm512_set1_pd(scale_imag);
+    long long counts[16];
+
+    for (int row = 0; row < num_rows; row += 16) {
+        const __m512d flipped = _mm512_set1_pd((double) (height-1-(first_row+row)));
+        const __m512d c_imag0 = _mm512_add_pd(imag_min_v, _mm512_mul_pd(_mm512_sub_pd(flipped, lanes0), scale_imag_v));
+        const __m512d c_imag1 = _mm512_add_pd(imag_min_v, _mm512_mul_pd(_mm512_sub_pd(flipped, lanes1), scale_imag_v));
+        mandleGroupAVX512(c_real, c_real, c_imag0, c_imag1, iters, counts);
+        storeGroup(data + (long long) row * stride, stride, counts, (num_rows - row < 16) ? num_rows - row : 16, iters);
+    }
+}
+
+/**
+ * Check if the kernel 'name' is supported and not disabled by the user
+ */
+static bool useRowKernel(const char* forced, const char* name, int rank) {
+    static const char* ranking[] = { "scalar", "sse2", "avx2", "avx512" };
+    if ( forced == NULL )
+        return true;
+    for (int i = 0; i < 4; ++i) {
+        if ( strcmp(forced, ranking[i]) == 0 )
+            return rank <= i;
+    }
+    ERROR("MANDLE_SIMD='%s' not valid, using '%s'\n", forced, name);
+    return true;
+}
+
+#endif // WITH_SIMD
+
+/** Selected kernels and their name */
+static MANDLE_ROW_KERNEL row_kernel = NULL;
+static MANDLE_COLUMN_KERNEL column_kernel = NULL;
+static MANDLE_COUNT_KERNEL count_kernel = NULL;
+static const char* row_kernel_name = "scalar";
+
+/**
+ * Pick the best kernels for the CPU we are running on
+ */
+static void selectRowKernel() {
+    row_kernel = mandleRowScalar;
+    column_kernel = mandleColumnScalar;
+    count_kernel = mandleCountScalar;
+    row_kernel_name = "scalar";
+#if WITH_SIMD
+    const char* forced = getenv("MANDLE_SIMD");
+    __builtin_cpu_init();
+    if ( __builtin_cpu_supports("avx512f") && useRowKernel(forced, "avx512", 3) ) {
+        row_kernel = mandleRowAVX512;
+        column_kernel = mandleColumnAVX512;
+        count_kernel = mandleCountAVX512;
+        row_kernel_name = "avx512";
+    } else if ( __builtin_cpu_supports("avx2") && useRowKernel(forced, "avx2", 2) ) {
+        row_kernel = mandleRowAVX2;
+        column_kernel = mandleColumnAVX2;
+        count_kernel = mandleCountAVX2;
+        row_kernel_name = "avx2";
+    } else if ( __builtin_cpu_supports("sse2") && useRowKernel(forced, "sse2", 1) ) {
+        row_kernel = mandleRowSSE2;
+        column_kernel = mandleColumnSSE2;
+        count_kernel = mandleCountSSE2;
+        row_kernel_name = "sse2";
+    }
+#endif
+    LOG("Using '%s' row kernel\n", row_kernel_name);
+}
+
+/**
+ * Get the fastest row kernel supported by the CPU
+ */
+MANDLE_ROW_KERNEL getMandleRowKernel() {
+    // Function local statics are initialized once, even with several OpenMP threads
+    static bool selected = (selectRowKernel(), true);
+    (void) selected;
+    return row_kernel;
+}
+
+/**
+ * Get the column kernel matching getMandleRowKernel
+ */
+MANDLE_COLUMN_KERNEL getMandleColumnKernel() {
+    getMandleRowKernel();
+    return column_kernel;
+}
+
+/**
+ * Get the count kernel matching getMandleRowKernel
+ */
+MANDLE_COUNT_KERNEL getMandleCountKernel() {
+    getMandleRowKernel();
+    return count_kernel;
+}
+
+/**
+ * Replace the kernels returned by the getters, NULL kernels go back to the ones picked for the CPU
+ */
+void setMandleKernels(MANDLE_ROW_KERNEL row, MANDLE_COLUMN_KERNEL column, MANDLE_COUNT_KERNEL count, const char* name) {
+    // Run the one time selection first, so it does not overwrite our kernels later on
+    getMandleRowKernel();
+    if ( row != NULL && column != NULL && count != NULL ) {
+        row_kernel = row;
+        column_kernel = column;
+        count_kernel = count;
+        row_kernel_name = name;
+        LOG("Using '%s' row kernel\n", row_kernel_name);
+    } else {
+        selectRowKernel();
+    }
+}
+
+/**
+ * Name of the row kernel returned by getMandleRowKernel
+ */
+const char* getMandleRowKernelName() {
+    getMandleRowKernel();
+    return row_kernel_name;
+}
\ No newline at end of file
@@ -0,0 +1,94 @@
+/**
+ * Mandlebort implementation over MPI and OpenMP
+ *
+ * Copyright (c) 2012, Moritz Wundke
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the owner nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Moritz Wundke BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+#ifndef MANDLE_SIMD_H
+#define MANDLE_SIMD_H
+
+/** Our own includes */
+#include "mandle_utils.h"
+
+// Use the vectorized row kernels on x86 targets
+#ifndef WITH_SIMD
+	#if defined(__x86_64__) || defined(__i386__)
+		#define WITH_SIMD 1
+	#else
+		#define WITH_SIMD 0
+	#endif
+#endif
+
+/** Number of columns handed to a row kernel per call, a multiple of every lane group */
+#define SIMD_BLOCK	64
+
+/**
+ * Row kernel: compute 'num_cols' points of a row starting at column 'first_col'
+ * and store 0 or 1 for each of them in 'data'
+ */
+typedef void (*MANDLE_ROW_KERNEL)(char *data, int first_col, int num_cols, int row, double scale_real, double scale_imag, int iters, int height, double real_min, double imag_min);
+
+/**
+ * Column kernel: compute 'num_rows' points of column 'col' starting at row 'first_row'
+ * and store 0 or 1 for each of them in 'data', 'stride' chars apart
+ */
+typedef void (*MANDLE_COLUMN_KERNEL)(char *data, int stride, int col, int first_row, int num_rows, double scale_real, double scale_imag, int iters, int height, double real_min, double imag_min);
+
+/**
+ * Count kernel: compute 'num_cols' points of a row starting at column 'first_col'
+ * and store their escape count into 'counts', 'count_bytes' per count (see mandle_counts.h)
+ */
+typedef void (*MANDLE_COUNT_KERNEL)(unsigned char *counts, int count_bytes, int first_col, int num_cols, int row, double scale_real, double scale_imag, int iters, int height, double real_min, double imag_min);
+
+/**
+ * Get the fastest row kernel supported by the CPU. The kernel is selected once, the
+ * MANDLE_SIMD environment variable (scalar, sse2, avx2 or avx512) can force a lower one.
+ */
+MANDLE_ROW_KERNEL getMandleRowKernel();
+
+/**
+ * Get the column kernel matching getMandleRowKernel
+ */
+MANDLE_COLUMN_KERNEL getMandleColumnKernel();
+
+/**
+ * Get the count kernel matching getMandleRowKernel
+ */
+MANDLE_COUNT_KERNEL getMandleCountKernel();
+
+/**
+ * Replace the kernels returned by the getters, used by render modes with their own iteration
+ * (see mandle_perturb.h). NULL kernels go back to the ones picked for the CPU.
+ */
+void setMandleKernels(MANDLE_ROW_KERNEL row, MANDLE_COLUMN_KERNEL column, MANDLE_COUNT_KERNEL count, const char* name);
+
+/**
+ * Name of the row kernel returned by getMandleRowKernel
+ */
+const char* getMandleRowKernelName();
+
+#endif // MANDLE_SIMD_H
\ No newline at end of file
@@ -0,0 +1,105 @@
+/**
+ * Mandlebort implementation over MPI and OpenMP
+ *
+ * Copyright (c) 2012, Moritz Wundke
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the owner nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Moritz Wundke BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+/** STD includes */
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+/** Our own includes */
+#include "mandle_stream.h"
+
+/**
+ * Create and map the file
+ */
+STREAM_FILE* streamOpen(const char* filename, const char* header, long long data_size, bool temporary) {
+    int fd = open(filename, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if ( fd < 0 ) {
+        ERROR("Failed to create '%s': %s\n", filename, strerror(errno));
+        return NULL;
+    }
+    if ( temporary ) {
+        unlink(filename);
+    }
+
+    long long header_size = strlen(header);
+    long long map_size = header_size + data_size;
+    void* map = MAP_FAILED;
+    if ( ftruncate(fd, (off_t) map_size) == 0 ) {
+        map = mmap(NULL, (size_t) map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    if ( map == MAP_FAILED ) {
+        ERROR("Failed to map %lld bytes of '%s': %s\n", map_size, filename, strerror(errno));
+        close(fd);
+        return NULL;
+    }
+
+    STREAM_FILE* stream = (STREAM_FILE*)malloc(sizeof(*stream));
+    stream->fd = fd;
+    stream->map = (unsigned char*) map;
+    stream->map_size = map_size;
+    stream->data_offset = header_size;
+    stream->dirty = 0;
+    memcpy(stream->map, header, header_size);
+    return stream;
+}
+
+/**
+ * The data of the file
+ */
+unsigned char* streamData(STREAM_FILE* stream) {
+    return stream->map + stream->data_offset;
+}
+
+/**
+ * Account for written bytes, writing the dirty pages back and dropping them once there are enough
+ */
+void streamWrote(STREAM_FILE* stream, long long bytes) {
+    stream->dirty += bytes;
+    if ( stream->dirty < (long long) STREAM_WORKING_SET << 20 )
+        return;
+    if ( msync(stream->map, (size_t) stream->map_size, MS_SYNC) != 0 || madvise(stream->map, (size_t) stream->map_size, MADV_DONTNEED) != 0 ) {
+        ERROR("Failed to flush a mapped file: %s\n", strerror(errno));
+    }
+    stream->dirty = 0;
+}
+
+/**
+ * Unmap and close the file
+ */
+void streamClose(STREAM_FILE* stream) {
+    if ( stream == NULL )
+        return;
+    munmap(stream->map, (size_t) stream->map_size);
+    close(stream->fd);
+    free(stream);
+}
\ No newline at end of file
@@ -0,0 +1,81 @@
+/**
+ * Mandlebort implementation over MPI and OpenMP
+ *
+ * Copyright (c) 2012, Moritz Wundke
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the owner nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Moritz Wundke BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+#ifndef MANDLE_STREAM_H
+#define MANDLE_STREAM_H
+
+/** Our own includes */
+#include "mandle_utils.h"
+
+// Write the image through a memory mapped file instead of holding it in memory, for images larger than the memory
+#ifndef WITH_STREAM
+	#define WITH_STREAM 0
+#endif
+
+/** Megabytes written to a mapped file before they are flushed to disk and dropped from memory */
+#ifndef STREAM_WORKING_SET
+	#define STREAM_WORKING_SET	256
+#endif
+
+/**
+ * A file mapped as a whole, a text header followed by 'data_size' bytes of data starting
+ * as zeros. Pages are written in any order, once STREAM_WORKING_SET megabytes were written
+ * they are synced and dropped, so the resident part of the file stays bounded.
+ */
+typedef struct {
+    int fd;
+    unsigned char* map;
+    long long map_size;
+    long long data_offset;   // Size of the header
+    long long dirty;         // Bytes written since the last flush
+} STREAM_FILE;
+
+/**
+ * Create 'filename' with 'header' in front of 'data_size' bytes and map it. A 'temporary' file is
+ * removed right away and lives until it is closed. Returns NULL on failure.
+ */
+STREAM_FILE* streamOpen(const char* filename, const char* header, long long data_size, bool temporary);
+
+/**
+ * The data of the file, after the header
+ */
+unsigned char* streamData(STREAM_FILE* stream);
+
+/**
+ * Account for 'bytes' written to the data, flushes them once the working set is full
+ */
+void streamWrote(STREAM_FILE* stream, long long bytes);
+
+/**
+ * Unmap and close the file
+ */
+void streamClose(STREAM_FILE* stream);
+
+#endif // MANDLE_STREAM_H
\ No newline at end of file
@@ -0,0 +1,313 @@
+/**
+ * Mandlebort implementation over MPI and OpenMP
+ *
+ * Copyright (c) 2012, Moritz Wundke
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the owner nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Moritz Wundke BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+/** Our main header */
+#include "mandle_threads.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+/**
+ * Tiles a thread still has to do, packed as begin << 32 | end so the owner and the thieves
+ * can claim tiles with a single compare and swap. Every range lives on its own cache line.
+ */
+struct alignas(64) TILE_RANGE {
+    std::atomic<unsigned long long> range;
+};
+
+static inline unsigned long long packRange(unsigned int begin, unsigned int end) {
+    return ((unsigned long long) begin << 32) | end;
+}
+
+/**
+ * Take the first tile of our own range
+ */
+static bool takeTile(TILE_RANGE *own, int *tile) {
+    unsigned long long cur = own->range.load();
+    while ( true ) {
+        unsigned int begin = (unsigned int) (cur >> 32);
+        unsigned int end = (unsigned int) cur;
+        if ( begin >= end )
+            return false;
+        if ( own->range.compare_exchange_weak(cur, packRange(begin + 1, end)) ) {
+            *tile = begin;
+            return true;
+        }
+    }
+}
+
+/**
+ * Move the upper half of the victim's range into our own, empty, range
+ */
+static bool stealTiles(TILE_RANGE *victim, TILE_RANGE *own) {
+    unsigned long long cur = victim->range.load();
+    while ( true ) {
+        unsigned int begin = (unsigned int) (cur >> 32);
+        unsigned int end = (unsigned int) cur;
+        if ( begin >= end )
+            return false;
+        unsigned int mid = begin + (end - begin) / 2;
+        if ( victim->range.compare_exchange_weak(cur, packRange(begin, mid)) ) {
+            own->range.store(packRange(mid, end));
+            return true;
+        }
+    }
+}
+
+/**
+ * Run 'work' for the items 0 .. num_items-1 on 'num_threads' work stealing threads
+ */
+template <typename WORK>
+static void runWorkStealing(int num_threads, int num_items, WORK work) {
+    // Hand out contiguous ranges of items in order, stealing evens out the expensive ones
+    TILE_RANGE *ranges = new TILE_RANGE[num_threads];
+    for (int t = 0; t < num_threads; ++t) {
+        ranges[t].range.store(packRange((long long) num_items * t / num_threads, (long long) num_items * (t + 1) / num_threads));
+    }
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_threads; ++t) {
+        threads.push_back(std::thread([=]() {
+            int item;
+            while ( true ) {
+                if ( takeTile(&ranges[t], &item) ) {
+                    work(item);
+                    continue;
+                }
+
+                // Our range is empty, we are done once there is nothing left to steal
+                bool stolen = false;
+                for (int v = 1; v < num_threads && !stolen; ++v) {
+                    stolen = stealTiles(&ranges[(t + v) % num_threads], &ranges[t]);
+                }
+                if ( !stolen )
+                    break;
+            }
+        }));
+    }
+    for (size_t t = 0; t < threads.size(); ++t) {
+        threads[t].join();
+    }
+    delete[] ranges;
+}
+
+/**
+ * Render the whole image with 'num_threads' work stealing threads
+ */
+void renderThreads(char *data, int num_threads, int width, int height, double real_min, double real_max, double imag_min, double imag_max, int iters) {
+    double scale_real = (double) (real_max - real_min) / (double) width;
+    double scale_imag = (double) (imag_max - imag_min) / (double) height;
+    int tile_cols = (width + THREAD_TILE - 1) / THREAD_TILE;
+    int tile_rows = (height + THREAD_TILE - 1) / THREAD_TILE;
+    MANDLE_ROW_KERNEL kernel = getMandleRowKernel();
+
+    runWorkStealing(num_threads, tile_cols * tile_rows, [=](int tile) {
+        int first_row = (tile / tile_cols) * THREAD_TILE;
+        int first_col = (tile % tile_cols) * THREAD_TILE;
+        int last_row = (height - first_row < THREAD_TILE) ? height : first_row + THREAD_TILE;
+        int num_cols = (width - first_col < THREAD_TILE) ? width - first_col : THREAD_TILE;
+        for (int row = first_row; row < last_row; ++row) {
+            kernel(data + (long long) row * width + first_col, first_col, num_cols, row, scale_real, scale_imag, iters, height, real_min, imag_min);
+        }
+    });
+}
+
+/**
+ * Render the whole image like renderThreads and keep the points that did not escape
+ */
+RESUME_STATE* renderThreadsResumable(char *data, int num_threads, int width, int height, double real_min, double real_max, double imag_min, double imag_max, int iters) {
+    double scale_real = (double) (real_max - real_min) / (double) width;
+    double scale_imag = (double) (imag_max - imag_min) / (double) height;
+    int tile_cols = (width + THREAD_TILE - 1) / THREAD_TILE;
+    int tile_rows = (height + THREAD_TILE - 1) / THREAD_TILE;
+    int num_tiles = tile_cols * tile_rows;
+
+    // Every tile collects its points on its own, they are joined in tile order at the end
+    std::vector< std::vector<unsigned int> > tile_index(num_tiles);
+    std::vector< std::vector<double> > tile_z(num_tiles);
+    std::vector<unsigned int>* index_ptr = tile_index.data();
+    std::vector<double>* z_ptr = tile_z.data();
+    runWorkStealing(num_threads, num_tiles, [=](int tile) {
+        unsigned int row_index[THREAD_TILE];
+        double row_z[2*THREAD_TILE];
+        int first_row = (tile / tile_cols) * THREAD_TILE;
+        int first_col = (tile % tile_cols) * THREAD_TILE;
+        int last_row = (height - first_row < THREAD_TILE) ? height : first_row + THREAD_TILE;
+        int num_cols = (width - first_col < THREAD_TILE) ? width - first_col : THREAD_TILE;
+        for (int row = first_row; row < last_row; ++row) {
+            int num = resumeStartRow(data + (long long) row * width + first_col, row_index, row_z, first_col, num_cols, row, width, scale_real, scale_imag, iters, height, real_min, imag_min);
+            index_ptr[tile].insert(index_ptr[tile].end(), row_index, row_index + num);
+            z_ptr[tile].insert(z_ptr[tile].end(), row_z, row_z + 2*num);
+        }
+    });
+
+    long long num_points = 0;
+    for (int tile = 0; tile < num_tiles; ++tile) {
+        num_points += tile_index[tile].size();
+    }
+    RESUME_STATE* state = resumeCreate(width, height, real_min, real_max, imag_min, imag_max, iters, num_points);
+    long long offset = 0;
+    for (int tile = 0; tile < num_tiles; ++tile) {
+        memcpy(state->index + offset, tile_index[tile].data(), tile_index[tile].size() * sizeof(*state->index));
+        memcpy(state->z + 2*offset, tile_z[tile].data(), tile_z[tile].size() * sizeof(*state->z));
+        offset += tile_index[tile].size();
+    }
+    return state;
+}
+
+/**
+ * Continue the points of a state up to 'iters' iterations, all other points of the image are 0
+ */
+void resumeThreads(char *data, RESUME_STATE *state, int num_threads, int iters) {
+    int width = state->width;
+    int height = state->height;
+    double real_min = state->real_min;
+    double imag_min = state->imag_min;
+    double scale_real = (double) (state->real_max - state->real_min) / (double) width;
+    double scale_imag = (double) (state->imag_max - state->imag_min) / (double) height;
+    int iters_done = state->iters;
+    long long num_points = state->num_points;
+    int num_chunks = (int) ((num_points + RESUME_CHUNK - 1) / RESUME_CHUNK);
+    unsigned int* index = state->index;
+    double* z = state->z;
+
+    // Every chunk keeps its remaining points at its front
+    memset(data, 0, (long long) width * height * sizeof(*data));
+    std::vector<long long> kept(num_chunks);
+    long long* kept_ptr = kept.data();
+    runWorkStealing(num_threads, num_chunks, [=](int chunk) {
+        long long first = (long long) chunk * RESUME_CHUNK;
+        long long num = (num_points - first < RESUME_CHUNK) ? num_points - first : RESUME_CHUNK;
+        kept_ptr[chunk] = resumeContinue(data, index + first, z + 2*first, num, width, scale_real, scale_imag, iters_done, iters, height, real_min, imag_min);
+    });
+
+    long long offset = 0;
+    for (int chunk = 0; chunk < num_chunks; ++chunk) {
+        long long first = (long long) chunk * RESUME_CHUNK;
+        memmove(index + offset, index + first, kept[chunk] * sizeof(*index));
+        memmove(z + 2*offset, z + 2*first, 2 * kept[chunk] * sizeof(*z));
+        offset += kept[chunk];
+    }
+    state->num_points = offset;
+    state->iters = iters;
+}
+
+/**
+ * Main entry point
+ */
+int main (int argc, char *argv[]) {
+    int iterations;
+    int num_threads = std::thread::hardware_concurrency();
+    double real_min = -SIZE;
+    double real_max = SIZE;
+    double imag_min = -SIZE;
+    double imag_max = SIZE;
+    int width = X_PIX;
+    int height = Y_PIX;
+
+    // Sanity checks
+    if ( argc < 2 ) {
+        ERROR("Usage: %s iterations [threads sizeX sizeY [stateFile]] %d\n", argv[0], argc);
+        exit(EXIT_FAILURE);
+    }
+
+    // Get data from commandline
+    iterations = atoi(argv[1]);
+    if (argc > 2)
+        num_threads = atoi(argv[2]);
+    if (argc > 4) {
+        width = atof(argv[3]);
+        height = atof(argv[4]);
+    }
+    if ( num_threads < 1 )
+        num_threads = 1;
+    const char* state_file = (argc > 5) ? argv[5] : NULL;
+
+    // All threads write straight into the image
+    char* mandleData = (char*) malloc((long long) width * height * sizeof(char));
+    if ( mandleData == NULL ) {
+        ERROR("Failed to allocate a %dx%d image\n", width, height);
+        exit(EXIT_FAILURE);
+    }
+
+    // Iterate in the cheapest precision that still resolves the pixels
+    int precision = choosePrecision(fmin((real_max - real_min) / width, (imag_max - imag_min) / height), SIZE, PRECISION_DD);
+    setPrecision(precision);
+
+    // With a state file a render continues the points a render with fewer iterations stopped at and leaves
+    // the state for the next one. The state is in double, so it starts over if that does not resolve the view.
+    RESUME_STATE* state = NULL;
+    if ( state_file != NULL && precision > PRECISION_DOUBLE ) {
+        ERROR("The view needs '%s', rendering without state\n", getPrecisionName(precision));
+        state_file = NULL;
+    }
+    if ( state_file != NULL && (long long) width * height > UINT_MAX ) {
+        ERROR("The image is too large for a state file, rendering without state\n");
+        state_file = NULL;
+    }
+    if ( state_file != NULL ) {
+        state = resumeLoad(state_file, width, height, real_min, real_max, imag_min, imag_max);
+        if ( state != NULL && state->iters >= iterations ) {
+            LOG("State is of %d iterations, starting over\n", state->iters);
+            resumeFree(state);
+            state = NULL;
+        }
+    }
+
+    double start_time = GetTime();
+    if ( state != NULL ) {
+        LOG("Continuing %lld points from %d iterations\n", state->num_points, state->iters);
+        resumeThreads(mandleData, state, num_threads, iterations);
+    } else if ( state_file != NULL ) {
+        state = renderThreadsResumable(mandleData, num_threads, width, height, real_min, real_max, imag_min, imag_max, iterations);
+    } else {
+        renderThreads(mandleData, num_threads, width, height, real_min, real_max, imag_min, imag_max, iterations);
+    }
+    double end_time = GetTime();
+
+    if ( state != NULL ) {
+        resumeSave(state, state_file);
+        resumeFree(state);
+    }
+
+    // Same columns as the MPI only version
+    FILE* output;
+    output = fopen ( "output.csv" , "a+" );
+    fprintf(output, "%s,%d,%lld,%g\n", "Threads-WorkStealing", num_threads, (long long) width * height, end_time - start_time);
+    fclose (output);
+
+#if WITH_PBM
+    createPBMFile("out.pbm", mandleData, width, height);
+#endif
+    free(mandleData);
+
+    return EXIT_SUCCESS;
+}
\ No newline at end of file
@@ -0,0 +1,69 @@
+/**
+ * Mandlebort implementation over MPI and OpenMP
+ *
+ * Copyright (c) 2012, Moritz Wundke
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the owner nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Moritz Wundke BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+#ifndef MANDLE_THREADS_H
+#define MANDLE_THREADS_H
+
+/** STD includes */
+#include <math.h>
+#include <string.h>
+#include <limits.h>
+
+/** Our own includes */
+#include "mandle_utils.h"
+#include "mandle_simd.h"
+#include "mandle_precision.h"
+#include "mandle_resume.h"
+#include "mandle_pbm.h"
+
+/** Edge length of the square tiles the threads work on */
+#ifndef THREAD_TILE
+	#define THREAD_TILE	64
+#endif
+
+/**
+ * Render the whole image into 'data', 'width' values per row, with 'num_threads' threads.
+ * Every thread starts with a contiguous range of tiles and steals half of the range of
+ * another thread once its own range is empty.
+ */
+void renderThreads(char *data, int num_threads, int width, int height, double real_min, double real_max, double imag_min, double imag_max, int iters);
+
+/**
+ * Render the whole image like renderThreads, in double, and return the state of the points that did not escape
+ */
+RESUME_STATE* renderThreadsResumable(char *data, int num_threads, int width, int height, double real_min, double real_max, double imag_min, double imag_max, int iters);
+
+/**
+ * Continue the points of 'state' up to 'iters' iterations into the image 'data', the state is updated
+ * to the points that still did not escape
+ */
+void resumeThreads(char *data, RESUME_STATE *state, int num_threads, int iters);
+
+#endif // MANDLE_THREADS_H
\ No newline at end of file
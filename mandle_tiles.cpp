@@ -0,0 +1,119 @@
+/**
+ * Mandlebort implementation over MPI and OpenMP
+ *
+ * Copyright (c) 2012, Moritz Wundke
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the owner nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Moritz Wundke BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+/** Our own includes */
+#include "mandle_tiles.h"
+
+/**
+ * Spread the lower 32 bits of a value to the even bits of the result
+ */
+static unsigned long long spreadBits(unsigned long long v) {
+    v &= 0xFFFFFFFFULL;
+    v = (v | (v << 16)) & 0x0000FFFF0000FFFFULL;
+    v = (v | (v << 8))  & 0x00FF00FF00FF00FFULL;
+    v = (v | (v << 4))  & 0x0F0F0F0F0F0F0F0FULL;
+    v = (v | (v << 2))  & 0x3333333333333333ULL;
+    v = (v | (v << 1))  & 0x5555555555555555ULL;
+    return v;
+}
+
+/** Morton code of a tile, used to sort the tiles along the curve */
+typedef struct {
+    unsigned long long code;
+    int tile;
+} TILE_KEY;
+
+static int compareKeys(const void* a, const void* b) {
+    unsigned long long ka = ((const TILE_KEY*) a)->code;
+    unsigned long long kb = ((const TILE_KEY*) b)->code;
+    return (ka < kb) ? -1 : (ka > kb) ? 1 : 0;
+}
+
+/**
+ * Create the layout, a tile size of 0 selects the row decomposition
+ */
+TILE_LAYOUT* tileLayoutCreate(int width, int height, int tile_width, int tile_height) {
+    TILE_LAYOUT* layout = (TILE_LAYOUT*) malloc(sizeof(*layout));
+    if ( tile_width <= 0 || tile_height <= 0 ) {
+        tile_width = width;
+        tile_height = 1;
+    }
+    // Whole bytes of the packed rows, unless the tile covers the whole row anyway
+    tile_width = (tile_width + 7) & ~7;
+    layout->width = width;
+    layout->height = height;
+    layout->tile_width = (tile_width < width) ? tile_width : width;
+    layout->tile_height = (tile_height < height) ? tile_height : height;
+    layout->tile_cols = (width + layout->tile_width - 1) / layout->tile_width;
+    layout->tile_rows = (height + layout->tile_height - 1) / layout->tile_height;
+    layout->num_tiles = layout->tile_cols * layout->tile_rows;
+    layout->order = (int*) malloc((long long) layout->num_tiles * sizeof(*layout->order));
+
+    if ( layout->tile_cols == 1 ) {
+        // A single column of tiles, the curve just runs down
+        for (int i = 0; i < layout->num_tiles; ++i) {
+            layout->order[i] = i;
+        }
+    } else {
+        // Sort the tiles by their Morton code, the curve skips the codes outside of the image
+        TILE_KEY* keys = (TILE_KEY*) malloc((long long) layout->num_tiles * sizeof(*keys));
+        for (int i = 0; i < layout->num_tiles; ++i) {
+            keys[i].code = spreadBits(i % layout->tile_cols) | (spreadBits(i / layout->tile_cols) << 1);
+            keys[i].tile = i;
+        }
+        qsort(keys, layout->num_tiles, sizeof(*keys), compareKeys);
+        for (int i = 0; i < layout->num_tiles; ++i) {
+            layout->order[i] = keys[i].tile;
+        }
+        free(keys);
+    }
+    return layout;
+}
+
+/**
+ * Get the position and size of the tile at position 'item' of the curve
+ */
+void tileLayoutGet(const TILE_LAYOUT* layout, int item, int* first_col, int* first_row, int* num_cols, int* num_rows) {
+    int tile = layout->order[item];
+    *first_col = (tile % layout->tile_cols) * layout->tile_width;
+    *first_row = (tile / layout->tile_cols) * layout->tile_height;
+    *num_cols = (layout->width - *first_col < layout->tile_width) ? layout->width - *first_col : layout->tile_width;
+    *num_rows = (layout->height - *first_row < layout->tile_height) ? layout->height - *first_row : layout->tile_height;
+}
+
+/**
+ * Free the layout
+ */
+void tileLayoutFree(TILE_LAYOUT* layout) {
+    if ( layout == NULL )
+        return;
+    free(layout->order);
+    free(layout);
+}
\ No newline at end of file
@@ -0,0 +1,69 @@
+/**
+ * Mandlebort implementation over MPI and OpenMP
+ *
+ * Copyright (c) 2012, Moritz Wundke
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the owner nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Moritz Wundke BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+#ifndef MANDLE_TILES_H
+#define MANDLE_TILES_H
+
+/** Our own includes */
+#include "mandle_utils.h"
+
+/**
+ * Decomposition of the image into tiles of 'tile_width' x 'tile_height' points, numbered
+ * along a Morton (Z-order) curve so consecutive tiles are close to each other. The tile
+ * width is a multiple of 8 so every tile starts at a new byte of a packed row. A layout
+ * of 'width' x 1 tiles is the plain row decomposition, with tile i being row i.
+ */
+typedef struct {
+    int width;
+    int height;
+    int tile_width;
+    int tile_height;
+    int tile_cols;      // Tiles per row of tiles
+    int tile_rows;      // Rows of tiles
+    int num_tiles;
+    int* order;         // Tile number (tile_row * tile_cols + tile_col) of each position on the curve
+} TILE_LAYOUT;
+
+/**
+ * Create the layout, a tile size of 0 selects the row decomposition
+ */
+TILE_LAYOUT* tileLayoutCreate(int width, int height, int tile_width, int tile_height);
+
+/**
+ * Get the position and size of the tile at position 'item' of the curve
+ */
+void tileLayoutGet(const TILE_LAYOUT* layout, int item, int* first_col, int* first_row, int* num_cols, int* num_rows);
+
+/**
+ * Free the layout
+ */
+void tileLayoutFree(TILE_LAYOUT* layout);
+
+#endif // MANDLE_TILES_H
\ No newline at end of file
@@ -30,6 +30,9 @@
 
 /** Our own includes */
 #include "mandle_utils.h"
+#include "mandle_simd.h"
+
+#include <math.h>
 
 /** Get current time */
 double GetTime() {
@@ -38,35 +41,18 @@ double GetTime() {
     return t.tv_sec + t.tv_usec / 1000000.0;
 }
 
-#if WITH_PBM   
 /**
- * Generate a plain PBM file.
- *
- * filename: filename to be written to
- * data: matrix of all data
+ * Closed form test for the main cardioid and the period-2 bulb, points inside never escape
  */
-void createPBMFile(const char* filename, char *data, int width, int height)
-{
-	// Create file
-	FILE* pbmFile;
-	pbmFile = fopen ( filename , "w" );
-
-	// Write data to the PBM file
-	int i, j;
-	fprintf(pbmFile, "P1\n");
-	fprintf(pbmFile, "%d %d\n", width, height); 
-	for (i = 0; i < height; i++) 
-	{
-		for (j = 0; j < width; j++) {
-			fprintf(pbmFile, "%d", data[(i*height)+j]);
-		}
-		fprintf(pbmFile, "\n"); 
-	}
-
-	// Close file
-	fclose (pbmFile);
+bool inMainCardioidOrBulb(double real, double imag) {
+    const double x = real - 0.25;
+    const double imag_sq = imag * imag;
+    const double q = x * x + imag_sq;
+    if ( q * (q + x) <= 0.25 * imag_sq )
+        return true;
+    const double x_bulb = real + 1.0;
+    return x_bulb * x_bulb + imag_sq <= 0.0625;
 }
-#endif
 
 /**
  * Compute the mandlebrot set and return 0 or 1 for a given location
@@ -78,6 +64,14 @@ char computeMandle(int row, int column, double scale_real, double scale_imag, in
     // Do the mandlebort magic
     c.real = real_min + ((double) column * scale_real);
     c.imag = imag_min + ((double) (height-1-row) * scale_imag);
+    if ( inMainCardioidOrBulb(c.real, c.imag) ) {
+        return 1;
+    }
+#if WITH_PERIODICITY
+    // Orbit point we compare against, moved forward after 1, 2, 4, ... iterations
+    COMPLEX check = z;
+    long long check_at = 1;
+#endif
     int k = 0;
     double lengthsq, temp;
     do  {
@@ -86,6 +80,17 @@ char computeMandle(int row, int column, double scale_real, double scale_imag, in
         z.real = temp;
         lengthsq = z.real*z.real + z.imag*z.imag;
         ++k;
+#if WITH_PERIODICITY
+        if ( lengthsq < SIZE_SQ ) {
+            if ( fabs(z.real - check.real) < PERIODICITY_EPS && fabs(z.imag - check.imag) < PERIODICITY_EPS ) {
+                return 1;
+            }
+            if ( k == check_at ) {
+                check = z;
+                check_at <<= 1;
+            }
+        }
+#endif
     } while (lengthsq < SIZE_SQ && k < iters);
     if (k == iters) {
         return 1;
@@ -94,36 +99,89 @@ char computeMandle(int row, int column, double scale_real, double scale_imag, in
 }
 
 /**
- * Compute the mandlebrot set for a given location and store the data in a pre allocated array
+ * Number of iterations until the point escapes, 'iters' if it does not escape
  */
-void computeMandleColum(long *data, int width, int row, double scale_real, double scale_imag, int iters, int height, double real_min, double imag_min) {
-	// Set the row id for the data set
-    data[0] = row;
+int computeMandleIterations(double real, double imag, int iters) {
+    if ( inMainCardioidOrBulb(real, imag) ) {
+        return iters;
+    }
+    double z_real = 0, z_imag = 0, temp;
+    int k = 0;
+    while ( z_real*z_real + z_imag*z_imag < SIZE_SQ && k < iters ) {
+        temp = z_real*z_real - z_imag*z_imag + real;
+        z_imag = 2.0*z_real*z_imag + imag;
+        z_real = temp;
+        ++k;
+    }
+    return k;
+}
 
-    // Get the color data for each column
-    int j;
-#if WITH_OMP
-    int tid;
-    #pragma omp parallel shared(data,width,row,scale_real,scale_imag,iters,height,real_min,imag_min) private(j,tid)
-#endif
-    {
 #if WITH_OMP
-        tid = omp_get_thread_num();
-#ifdef OMP_CHUNK
-        #pragma omp parallel for schedule(OMP_MODE, OMP_CHUNK)
-#else
-        #pragma omp parallel for schedule(OMP_MODE)
-#endif
+/**
+ * Tasks a taskloop over 'num_items' items is split into by OMP_SCHEDULE
+ */
+int ompNumTasks(int num_items) {
+    omp_sched_t kind;
+    int chunk;
+    omp_get_schedule(&kind, &chunk);
+    if ( (kind & ~omp_sched_monotonic) == omp_sched_static && chunk <= 0 ) {
+        chunk = (num_items + omp_get_num_threads() - 1) / omp_get_num_threads();
+    }
+    chunk = (chunk < 1) ? 1 : chunk;
+    int num_tasks = (num_items + chunk - 1) / chunk;
+    return (num_tasks < 1) ? 1 : num_tasks;
+}
 #endif
-        for (j = 0; j < width; ++j) {
-            data[j+1] = computeMandle(row, j, scale_real, scale_imag, iters, height, real_min, imag_min);
+
+/**
+ * Compute the columns [first_col, first_col+num_cols) of 'num_rows' rows starting at 'first_row', 'row_step'
+ * rows apart, into consecutive rows of 'stride' values of 'data'
+ */
+static void computeMandleArea(char *data, int stride, int first_col, int num_cols, int first_row, int row_step, int num_rows, double scale_real, double scale_imag, int iters, int height, double real_min, double imag_min) {
+    // The row kernel handles a block of columns at once
+    MANDLE_ROW_KERNEL kernel = getMandleRowKernel();
+    int tile_rows = (num_rows + OMP_TILE_ROWS - 1) / OMP_TILE_ROWS;
+    int tile_cols = (num_cols + OMP_TILE_COLS - 1) / OMP_TILE_COLS;
+    int num_tiles = tile_rows * tile_cols;
+
+    // The tiles are tasks of the team the worker keeps for its whole assignment, no region per call
 #if WITH_OMP
-            LOG("Thread %d: row:%d col:%d)\n",tid,row,j);
+    #pragma omp taskloop num_tasks(ompNumTasks(num_tiles))
 #endif
+    for (int tile = 0; tile < num_tiles; ++tile) {
+        int tile_row = tile / tile_cols;
+        int col = (tile % tile_cols) * OMP_TILE_COLS;
+        int cols = (num_cols - col < OMP_TILE_COLS) ? num_cols - col : OMP_TILE_COLS;
+        int last = ((tile_row+1) * OMP_TILE_ROWS < num_rows) ? (tile_row+1) * OMP_TILE_ROWS : num_rows;
+        for (int i = tile_row * OMP_TILE_ROWS; i < last; ++i) {
+            kernel(data + (long long) i * stride + col, first_col + col, cols, first_row + i * row_step, scale_real, scale_imag, iters, height, real_min, imag_min);
         }
     }
 }
 
+/**
+ * Compute 'num_rows' rows starting at 'first_row', 'row_step' rows apart, and store 0 or 1 for each
+ * column in consecutive rows of 'width' values of a pre allocated array
+ */
+void computeMandleRows(char *data, int width, int first_row, int row_step, int num_rows, double scale_real, double scale_imag, int iters, int height, double real_min, double imag_min) {
+    computeMandleArea(data, width, 0, width, first_row, row_step, num_rows, scale_real, scale_imag, iters, height, real_min, imag_min);
+}
+
+/**
+ * Compute a tile of 'num_cols' x 'num_rows' points starting at (first_col, first_row) and store 0 or 1
+ * for each point in consecutive rows of 'num_cols' values of a pre allocated array
+ */
+void computeMandleTile(char *data, int first_col, int first_row, int num_cols, int num_rows, double scale_real, double scale_imag, int iters, int height, double real_min, double imag_min) {
+    computeMandleArea(data, num_cols, first_col, num_cols, first_row, 1, num_rows, scale_real, scale_imag, iters, height, real_min, imag_min);
+}
+
+/**
+ * Compute the mandlebrot set for a given row and store 0 or 1 for each column in a pre allocated array
+ */
+void computeMandleRow(char *data, int width, int row, double scale_real, double scale_imag, int iters, int height, double real_min, double imag_min) {
+    computeMandleRows(data, width, row, 1, 1, scale_real, scale_imag, iters, height, real_min, imag_min);
+}
+
 // X11 values
 #if WITH_X11
 
@@ -207,6 +265,13 @@ void drawPoint(int x, int y) {
 	XDrawPoint (display, win, gc, x, y);
 }
 
+/**
+ * Clear the whole window to the background color
+ */
+void clearX11() {
+	XClearWindow (display, win);
+}
+
 /**
  * Flush X11 display and sleep for some seconds
  */
@@ -56,19 +56,14 @@ using namespace std;
 
 #if WITH_OMP
 	#include <omp.h>
-	
-	// Set the right mode for OMP
-	#ifndef SET_OMP_MODE
-		#define OMP_MODE static
-	#else
-		#if SET_OMP_MODE == 1
-			#define OMP_MODE dynamic
-		#elif SET_OMP_MODE == 2
-			#define OMP_MODE guided
-		#else
-			#define OMP_MODE static
-		#endif
-	#endif
+#endif
+
+// Tiles of rows x columns the OpenMP team shares out as tasks, OMP_SCHEDULE sets how many tiles a task gets
+#ifndef OMP_TILE_ROWS
+	#define OMP_TILE_ROWS	4
+#endif
+#ifndef OMP_TILE_COLS
+	#define OMP_TILE_COLS	64
 #endif
 
 #ifndef WITH_BENCHMARK
@@ -101,6 +96,16 @@ using namespace std;
 	#endif
 #endif
 
+// Brent style cycle detection in the iteration loop, stops early on periodic orbits
+#ifndef WITH_PERIODICITY
+	#define WITH_PERIODICITY 0
+#endif
+
+/** Distance at which two orbit points are considered equal by the cycle detection */
+#ifndef PERIODICITY_EPS
+	#define PERIODICITY_EPS	1e-13
+#endif
+
 // Logging
 #ifdef DEBUG
 	#define LOG(args...) fprintf(stdout, args);
@@ -129,15 +134,10 @@ typedef struct {
 /** Get current time */
 double GetTime();
 
-#if WITH_PBM
 /**
- * Generate a plain PBM file.
- *
- * filename: filename to be written to
- * data: matrix of all data
+ * Closed form test for the main cardioid and the period-2 bulb, points inside never escape
  */
-void createPBMFile(const char* filename, char *data, int width, int height);
-#endif
+bool inMainCardioidOrBulb(double real, double imag);
 
 /**
  * Compute the mandlebrot set and return 0 or 1 for a given location
@@ -145,9 +145,35 @@ void createPBMFile(const char* filename, char *data, int width, int height);
 char computeMandle(int row, int column, double scale_real, double scale_imag, int iters, int height, double real_min, double imag_min);
 
 /**
- * Compute the mandlebrot set for a given location and store the data in a pre allocated array
+ * Number of iterations until the point escapes, 'iters' if it does not escape
  */
-void computeMandleColum(long *data, int width, int row, double scale_real, double scale_imag, int iters, int height, double real_min, double imag_min);
+int computeMandleIterations(double real, double imag, int iters);
+
+#if WITH_OMP
+/**
+ * Tasks a taskloop over 'num_items' items is split into by OMP_SCHEDULE, one per thread of the team
+ * for static and chunks of its chunk size (1 if not given) otherwise
+ */
+int ompNumTasks(int num_items);
+#endif
+
+/**
+ * Compute 'num_rows' rows starting at 'first_row', 'row_step' rows apart, and store 0 or 1 for each
+ * column in consecutive rows of 'width' values of a pre allocated array. With OpenMP the tiles are tasks
+ * of the team of the calling thread (see worker_proc), they are done when the call returns.
+ */
+void computeMandleRows(char *data, int width, int first_row, int row_step, int num_rows, double scale_real, double scale_imag, int iters, int height, double real_min, double imag_min);
+
+/**
+ * Compute a tile of 'num_cols' x 'num_rows' points starting at (first_col, first_row) and store 0 or 1
+ * for each point in consecutive rows of 'num_cols' values of a pre allocated array
+ */
+void computeMandleTile(char *data, int first_col, int first_row, int num_cols, int num_rows, double scale_real, double scale_imag, int iters, int height, double real_min, double imag_min);
+
+/**
+ * Compute the mandlebrot set for a given row and store 0 or 1 for each column in a pre allocated array
+ */
+void computeMandleRow(char *data, int width, int row, double scale_real, double scale_imag, int iters, int height, double real_min, double imag_min);
 
 #if WITH_X11
 
@@ -165,6 +191,11 @@ void initX11(const char* window_title, unsigned int width, unsigned int height,
  */
 void drawPoint(int x, int y);
 
+/**
+ * Clear the whole window to the background color
+ */
+void clearX11();
+
 /**
  * Flush X11 display and sleep for some seconds
  */
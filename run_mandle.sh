@@ -1,5 +1,8 @@
 #!/bin/sh
-# Just run the mpi static example
+# Just run the mpi example
+# Usage: run_mandle.sh processes iterations [strategy sizeX sizeY [tileX tileY [centerReal centerImag radius]]]
 date
 echo "process starting"
-mpirun -np $1 ./bin/mandle.o $2 $3 $4 $5 $6
\ No newline at end of file
+NP=$1
+shift
+mpirun -np $NP ./bin/mandle.o "$@"
\ No newline at end of file
@@ -3,4 +3,5 @@
 date
 echo "process starting"
 export OMP_NUM_THREADS=$1
-mpirun -np $2 ./bin/mandle_hybrid_dynamic.o $3 $4 $5 $6 $7
\ No newline at end of file
+export OMP_SCHEDULE=dynamic
+mpirun -np $2 ./bin/mandle_hybrid.o $3 $4 $5 $6 $7
\ No newline at end of file
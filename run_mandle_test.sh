@@ -13,6 +13,14 @@ echo "Starting static strategy"
 ./run_mandle.sh 8 100 0 $DIMENSION $DIMENSION
 ./run_mandle.sh 16 100 0 $DIMENSION $DIMENSION
 
+echo "Starting static strategy with collective assembly"
+./run_mandle.sh 8 100 5 $DIMENSION $DIMENSION
+./run_mandle.sh 16 100 5 $DIMENSION $DIMENSION
+
+echo "Starting static strategy with cost model partitioning"
+./run_mandle.sh 8 100 6 $DIMENSION $DIMENSION
+./run_mandle.sh 16 100 6 $DIMENSION $DIMENSION
+
 echo "Starting static strategy with round-robin"
 ./run_mandle.sh 8 100 1 $DIMENSION $DIMENSION
 ./run_mandle.sh 16 100 1 $DIMENSION $DIMENSION
@@ -21,6 +29,22 @@ echo "Starting dynamic strategy"
 ./run_mandle.sh 8 100 2 $DIMENSION $DIMENSION
 ./run_mandle.sh 16 100 2 $DIMENSION $DIMENSION
 
+echo "Starting dynamic Mariani-Silver strategy"
+./run_mandle.sh 8 100 3 $DIMENSION $DIMENSION
+./run_mandle.sh 16 100 3 $DIMENSION $DIMENSION
+
+echo "Starting static and dynamic strategies with 64x64 tiles in Morton order"
+./run_mandle.sh 16 100 0 $DIMENSION $DIMENSION 64 64
+./run_mandle.sh 16 100 2 $DIMENSION $DIMENSION 64 64
+
+echo "Starting masterless RMA strategy"
+./run_mandle.sh 8 100 4 $DIMENSION $DIMENSION
+./run_mandle.sh 16 100 4 $DIMENSION $DIMENSION
+
+echo "Starting shared memory work stealing threads"
+./run_mandle_threads.sh 100 8 $DIMENSION $DIMENSION
+./run_mandle_threads.sh 100 16 $DIMENSION $DIMENSION
+
 # Copy MPI csv to a different location
 cp output.csv $OUTPUT/output_mpi.csv
 
@@ -0,0 +1,5 @@
+#!/bin/sh
+# Run the shared memory version, no MPI needed
+date
+echo "process starting"
+./bin/mandle_threads.o $1 $2 $3 $4 $5
\ No newline at end of file